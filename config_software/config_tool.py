@@ -6,7 +6,9 @@ GUI application for configuring the joystick converter device.
 """
 
 import sys
+import json
 import time
+import threading
 import serial
 import serial.tools.list_ports
 from datetime import datetime
@@ -76,6 +78,199 @@ class MacroEditorDialog(QDialog):
         }
 
 
+class TelemetryDecoder:
+    """Decoder for the firmware's binary input stream (see firmware/telemetry.h)
+
+    Frames and text reply lines share the serial port; frames start with a
+    sync byte that never occurs in text.
+    """
+
+    SYNC = 0xA5
+    FRAME_GAMEPAD = 0x01
+    FRAME_KEYBOARD = 0x02
+    FRAME_DISCONNECT = 0x03
+
+    # Gamepad fields in mask bit order: (name, encoding)
+    GAMEPAD_FIELDS = [
+        ("buttons", "u16"),
+        ("left_x", "axis"), ("left_y", "axis"),
+        ("right_x", "axis"), ("right_y", "axis"),
+        ("left_trigger", "u8"), ("right_trigger", "u8"),
+        ("dpad_x", "s8"), ("dpad_y", "s8"),
+    ]
+
+    def __init__(self):
+        self.reset()
+
+    def reset(self):
+        """Forget all state (call when the stream is (re)started)"""
+        self.buffer = bytearray()
+        self.text = bytearray()
+        self.time_us = 0
+        self.gamepads = {}
+        self.keyboards = {}
+        self.bad_frames = 0
+
+    @staticmethod
+    def _varint(data, pos):
+        value = 0
+        shift = 0
+        while True:
+            byte = data[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value, pos
+
+    @staticmethod
+    def _blank_gamepad():
+        return {name: 0 for name, _ in TelemetryDecoder.GAMEPAD_FIELDS}
+
+    def feed(self, data):
+        """Decode received bytes
+
+        Returns a list of events:
+        ("gamepad", device, time_us, state), ("keyboard", device, time_us, state),
+        ("disconnect", device, time_us) and ("text", line).
+        """
+        self.buffer.extend(data)
+        events = []
+        pos = 0
+        buf = self.buffer
+
+        while pos < len(buf):
+            if buf[pos] != self.SYNC:
+                byte = buf[pos]
+                pos += 1
+                if byte == 0x0A:
+                    events.append(("text", self.text.decode('utf-8', errors='ignore').strip()))
+                    self.text.clear()
+                else:
+                    self.text.append(byte)
+                continue
+
+            if len(buf) - pos < 3:
+                break
+            length = buf[pos + 2]
+            if len(buf) - pos < 4 + length:
+                break
+
+            frame_type = buf[pos + 1]
+            payload = bytes(buf[pos + 3:pos + 3 + length])
+            checksum = (frame_type + length + sum(payload)) & 0xFF
+            if checksum != buf[pos + 3 + length] or length < 2:
+                # Not a frame after all, resynchronize on the next sync byte
+                self.bad_frames += 1
+                pos += 1
+                continue
+
+            pos += 4 + length
+            event = self._decode(frame_type, payload)
+            if event:
+                events.append(event)
+
+        del buf[:pos]
+        return events
+
+    def _decode(self, frame_type, payload):
+        try:
+            device = payload[0]
+            delta_us, i = self._varint(payload, 1)
+            self.time_us += delta_us
+
+            if frame_type == self.FRAME_GAMEPAD:
+                state = self.gamepads.setdefault(device, self._blank_gamepad())
+                mask = payload[i] | (payload[i + 1] << 8)
+                i += 2
+                for bit, (name, encoding) in enumerate(self.GAMEPAD_FIELDS):
+                    if not mask & (1 << bit):
+                        continue
+                    if encoding == "u16":
+                        state[name] = payload[i] | (payload[i + 1] << 8)
+                        i += 2
+                    elif encoding == "axis":
+                        zigzag, i = self._varint(payload, i)
+                        state[name] += (zigzag >> 1) ^ -(zigzag & 1)
+                    elif encoding == "u8":
+                        state[name] = payload[i]
+                        i += 1
+                    else:
+                        state[name] = payload[i] - 256 if payload[i] > 127 else payload[i]
+                        i += 1
+                return ("gamepad", device, self.time_us, dict(state))
+
+            if frame_type == self.FRAME_KEYBOARD:
+                num_keys = payload[i + 1]
+                state = {
+                    "modifiers": payload[i],
+                    "keys": list(payload[i + 2:i + 2 + num_keys]),
+                }
+                self.keyboards[device] = state
+                return ("keyboard", device, self.time_us, dict(state))
+
+            if frame_type == self.FRAME_DISCONNECT:
+                self.gamepads.pop(device, None)
+                self.keyboards.pop(device, None)
+                return ("disconnect", device, self.time_us)
+        except IndexError:
+            self.bad_frames += 1
+        return None
+
+
+class TelemetryReader(threading.Thread):
+    """Background reader for the input stream; keeps the latest state per device"""
+
+    def __init__(self, serial_port):
+        super().__init__(daemon=True)
+        self.serial_port = serial_port
+        self.decoder = TelemetryDecoder()
+        self.lock = threading.Lock()
+        self.stop_event = threading.Event()
+        self.latest_gamepad = {}
+        self.frames = 0
+        self.text_lines = []
+
+    def run(self):
+        while not self.stop_event.is_set():
+            try:
+                data = self.serial_port.read(max(1, self.serial_port.in_waiting))
+            except Exception:
+                break
+            if not data:
+                continue
+            events = self.decoder.feed(data)
+            with self.lock:
+                for event in events:
+                    if event[0] == "gamepad":
+                        self.latest_gamepad[event[1]] = event[3]
+                        self.frames += 1
+                    elif event[0] == "disconnect":
+                        self.latest_gamepad.pop(event[1], None)
+                    elif event[0] == "text" and event[1]:
+                        self.text_lines.append(event[1])
+                        del self.text_lines[:-16]
+
+    def stop(self):
+        self.stop_event.set()
+        self.join(timeout=2)
+
+    def take_line(self, prefix):
+        """Remove and return the first reply line starting with prefix, or None"""
+        with self.lock:
+            for i, line in enumerate(self.text_lines):
+                if line.startswith(prefix):
+                    return self.text_lines.pop(i)
+        return None
+
+    def snapshot(self):
+        """Get the latest gamepad state of the first device and the frame count"""
+        with self.lock:
+            if not self.latest_gamepad:
+                return None, self.frames
+            return self.latest_gamepad[min(self.latest_gamepad)], self.frames
+
+
 class ConfigTool(QMainWindow):
     """Main configuration window"""
     
@@ -86,6 +281,9 @@ class ConfigTool(QMainWindow):
         self.macros = []
         self.debug_mode_active = False
         self.last_gamepad_state = None
+        self.telemetry_reader = None
+        self.telemetry_frames = 0
+        self.telemetry_rate_time = 0.0
         
         self.init_ui()
         self.refresh_ports()
@@ -95,10 +293,10 @@ class ConfigTool(QMainWindow):
         self.port_refresh_timer.timeout.connect(self.refresh_ports)
         self.port_refresh_timer.start(2000)  # Refresh every 2 seconds
         
-        # Debug mode polling timer
+        # Debug display refresh; input arrives through the telemetry stream
         self.debug_timer = QTimer()
         self.debug_timer.timeout.connect(self.poll_debug_data)
-        self.debug_timer.setInterval(50)  # Poll every 50ms for responsive input
+        self.debug_timer.setInterval(30)
     
     def init_ui(self):
         """Initialize user interface"""
@@ -254,6 +452,33 @@ class ConfigTool(QMainWindow):
         # Create debug display
         self.init_debug_display(debug_layout)
         
+        # Input-to-output latency
+        latency_group = QGroupBox("Input Latency")
+        latency_layout = QVBoxLayout()
+        
+        latency_control_layout = QHBoxLayout()
+        self.latency_get_btn = QPushButton("Get Latency")
+        self.latency_get_btn.clicked.connect(self.get_latency_stats)
+        latency_control_layout.addWidget(self.latency_get_btn)
+        
+        self.latency_reset_btn = QPushButton("Reset")
+        self.latency_reset_btn.clicked.connect(self.reset_latency_stats)
+        latency_control_layout.addWidget(self.latency_reset_btn)
+        
+        self.latency_label = QLabel("No samples")
+        latency_control_layout.addWidget(self.latency_label)
+        latency_control_layout.addStretch()
+        latency_layout.addLayout(latency_control_layout)
+        
+        self.latency_hist_text = QPlainTextEdit()
+        self.latency_hist_text.setReadOnly(True)
+        self.latency_hist_text.setFont(QFont("Courier New", 9))
+        self.latency_hist_text.setMaximumHeight(140)
+        latency_layout.addWidget(self.latency_hist_text)
+        
+        latency_group.setLayout(latency_layout)
+        debug_layout.addWidget(latency_group)
+        
         self.tab_widget.addTab(debug_tab, "Debug Mode")
         
         # Device Logs Tab
@@ -326,6 +551,89 @@ class ConfigTool(QMainWindow):
         logs_layout.addWidget(log_display_group)
         
         self.tab_widget.addTab(logs_tab, "Device Logs")
+        
+        # Diagnostics Tab
+        prof_tab = QWidget()
+        prof_layout = QVBoxLayout(prof_tab)
+        
+        prof_control_group = QGroupBox("Task Profile")
+        prof_control_layout = QHBoxLayout()
+        
+        self.prof_refresh_btn = QPushButton("Refresh")
+        self.prof_refresh_btn.clicked.connect(self.refresh_profile)
+        prof_control_layout.addWidget(self.prof_refresh_btn)
+        
+        self.prof_reset_btn = QPushButton("Reset")
+        self.prof_reset_btn.clicked.connect(self.reset_profile)
+        prof_control_layout.addWidget(self.prof_reset_btn)
+        
+        self.prof_trace_start_btn = QPushButton("Start Trace")
+        self.prof_trace_start_btn.clicked.connect(self.start_profile_trace)
+        prof_control_layout.addWidget(self.prof_trace_start_btn)
+        
+        self.prof_trace_export_btn = QPushButton("Export Trace")
+        self.prof_trace_export_btn.clicked.connect(self.export_profile_trace)
+        prof_control_layout.addWidget(self.prof_trace_export_btn)
+        
+        self.prof_status_label = QLabel("")
+        prof_control_layout.addWidget(self.prof_status_label)
+        prof_control_layout.addStretch()
+        
+        prof_control_group.setLayout(prof_control_layout)
+        prof_layout.addWidget(prof_control_group)
+        
+        self.prof_table = QTableWidget()
+        self.prof_table.setColumnCount(6)
+        self.prof_table.setHorizontalHeaderLabels([
+            "Task", "Calls", "Avg (us)", "Max (us)", "Overruns", "Budget (us)"
+        ])
+        prof_layout.addWidget(self.prof_table)
+        
+        # Pipeline counters (STATS)
+        counters_group = QGroupBox("Pipeline Counters")
+        counters_layout = QVBoxLayout()
+        
+        counters_control_layout = QHBoxLayout()
+        self.counters_refresh_btn = QPushButton("Refresh")
+        self.counters_refresh_btn.clicked.connect(lambda: self.refresh_counters(False))
+        counters_control_layout.addWidget(self.counters_refresh_btn)
+        
+        self.counters_reset_btn = QPushButton("Read && Reset")
+        self.counters_reset_btn.clicked.connect(lambda: self.refresh_counters(True))
+        counters_control_layout.addWidget(self.counters_reset_btn)
+        counters_control_layout.addStretch()
+        counters_layout.addLayout(counters_control_layout)
+        
+        self.counters_table = QTableWidget()
+        self.counters_table.setColumnCount(2)
+        self.counters_table.setHorizontalHeaderLabels(["Counter", "Value"])
+        counters_layout.addWidget(self.counters_table)
+        
+        counters_group.setLayout(counters_layout)
+        prof_layout.addWidget(counters_group)
+        
+        # Pipeline benchmark (BENCH)
+        bench_group = QGroupBox("Pipeline Benchmark")
+        bench_layout = QHBoxLayout()
+        
+        bench_layout.addWidget(QLabel("Reports:"))
+        self.bench_reports_spin = QSpinBox()
+        self.bench_reports_spin.setRange(1, 100000)
+        self.bench_reports_spin.setValue(10000)
+        bench_layout.addWidget(self.bench_reports_spin)
+        
+        self.bench_run_btn = QPushButton("Run")
+        self.bench_run_btn.clicked.connect(self.run_bench)
+        bench_layout.addWidget(self.bench_run_btn)
+        
+        self.bench_result_label = QLabel("Not run")
+        bench_layout.addWidget(self.bench_result_label)
+        bench_layout.addStretch()
+        
+        bench_group.setLayout(bench_layout)
+        prof_layout.addWidget(bench_group)
+        
+        self.tab_widget.addTab(prof_tab, "Diagnostics")
     
     def init_debug_display(self, parent_layout):
         """Initialize the debug display widgets"""
@@ -465,8 +773,13 @@ class ConfigTool(QMainWindow):
         if self.debug_mode_active:
             # Start debug mode
             try:
-                # Send debug mode command to device
+                # Enter debug mode and have the device push input at 1 kHz
                 self.serial_port.write(b"DEBUG_START\n")
+                self.serial_port.write(b"STREAM_START 1000\n")
+                self.telemetry_reader = TelemetryReader(self.serial_port)
+                self.telemetry_reader.start()
+                self.telemetry_frames = 0
+                self.telemetry_rate_time = time.monotonic()
                 self.debug_timer.start()
                 self.debug_start_btn.setText("Stop Debug Mode")
                 self.debug_status_label.setText("Status: Active")
@@ -477,6 +790,7 @@ class ConfigTool(QMainWindow):
         else:
             # Stop debug mode
             try:
+                self.stop_telemetry()
                 self.serial_port.write(b"DEBUG_STOP\n")
                 self.debug_timer.stop()
                 self.debug_start_btn.setText("Start Debug Mode")
@@ -486,48 +800,126 @@ class ConfigTool(QMainWindow):
             except Exception as e:
                 QMessageBox.warning(self, "Warning", f"Failed to stop debug mode: {e}")
     
+    def stop_telemetry(self):
+        """Stop the input stream and its reader thread"""
+        if self.telemetry_reader:
+            self.telemetry_reader.stop()
+            self.telemetry_reader = None
+            if self.serial_port and self.serial_port.is_open:
+                self.serial_port.write(b"STREAM_STOP\n")
+                # Drop the remaining frames and the STREAM_STOPPED reply
+                time.sleep(0.05)
+                self.serial_port.reset_input_buffer()
+    
     def poll_debug_data(self):
-        """Poll for debug data from device"""
+        """Show the latest streamed input state"""
+        if not self.telemetry_reader:
+            return
+        
+        state, frames = self.telemetry_reader.snapshot()
+        if state:
+            self.update_debug_display(state["buttons"], state["left_x"], state["left_y"],
+                                      state["right_x"], state["right_y"],
+                                      state["left_trigger"], state["right_trigger"],
+                                      state["dpad_x"], state["dpad_y"])
+        
+        # Frame rate over the last second
+        now = time.monotonic()
+        if now - self.telemetry_rate_time >= 1.0:
+            rate = (frames - self.telemetry_frames) / (now - self.telemetry_rate_time)
+            self.debug_status_label.setText(f"Status: Active ({rate:.0f} updates/s)")
+            self.telemetry_frames = frames
+            self.telemetry_rate_time = now
+    
+    def query_device(self, command, prefix, timeout=1.0):
+        """Send a command and return its reply line, or None on timeout
+        
+        While the input stream runs, the reply is taken from the stream reader.
+        """
+        if self.telemetry_reader:
+            self.serial_port.write(command.encode() + b"\n")
+            start_time = time.time()
+            while time.time() - start_time < timeout:
+                line = self.telemetry_reader.take_line(prefix)
+                if line:
+                    return line
+                QApplication.processEvents()
+                time.sleep(0.01)
+            return None
+        
+        self.serial_port.reset_input_buffer()
+        self.serial_port.write(command.encode() + b"\n")
+        start_time = time.time()
+        while time.time() - start_time < timeout:
+            if self.serial_port.in_waiting > 0:
+                line = self.serial_port.readline().decode('utf-8', errors='ignore').strip()
+                if line.startswith(prefix):
+                    return line
+            else:
+                QApplication.processEvents()
+                time.sleep(0.01)
+        return None
+    
+    def get_latency_stats(self):
+        """Fetch the input-to-output latency histogram from the device"""
         if not self.serial_port or not self.serial_port.is_open:
+            QMessageBox.warning(self, "Error", "Not connected to device")
             return
         
         try:
-            # Request debug data
-            self.serial_port.write(b"DEBUG_GET\n")
+            response = self.query_device("LAT_STATS", "LAT_STATS:")
+            if not response:
+                self.statusBar().showMessage("No response from device")
+                return
             
-            # Process pending Qt events to keep GUI responsive
-            QApplication.processEvents()
+            # Parse: LAT_STATS:count=N,min=..,avg=..,p50=..,p99=..,max=..,hist=c0/c1/...
+            parts = {}
+            for item in response[10:].split(','):
+                if '=' in item:
+                    key, val = item.split('=', 1)
+                    parts[key] = val
             
-            # Read available data (non-blocking check)
-            if self.serial_port.in_waiting > 0:
-                line = self.serial_port.readline().decode('utf-8', errors='ignore').strip()
-                if line.startswith("DEBUG:"):
-                    self.parse_debug_data(line[6:])
+            count = int(parts.get('count', '0'))
+            if count == 0:
+                self.latency_label.setText("No samples")
+                self.latency_hist_text.clear()
+                return
+            
+            self.latency_label.setText(
+                f"{count} samples: min {parts.get('min')} us, avg {parts.get('avg')} us, "
+                f"p50 {parts.get('p50')} us, p99 {parts.get('p99')} us, max {parts.get('max')} us")
+            
+            # Bucket i holds [2^i, 2^(i+1)) us; bucket 0 everything below 2 us
+            buckets = [int(c) for c in parts.get('hist', '').split('/') if c.isdigit()]
+            peak = max(buckets) if buckets else 0
+            lines = []
+            for i, bucket in enumerate(buckets):
+                if bucket == 0:
+                    continue
+                low = 0 if i == 0 else 1 << i
+                label = f">= {low} us" if i == len(buckets) - 1 else f"{low}-{(2 << i) - 1} us"
+                bar = '#' * max(1, bucket * 40 // peak)
+                lines.append(f"{label:>18} {bucket:>8} {bar}")
+            self.latency_hist_text.setPlainText('\n'.join(lines))
+            self.statusBar().showMessage("Latency stats updated")
         except Exception as e:
-            # Silently ignore errors during polling to avoid spam
-            pass
+            QMessageBox.warning(self, "Warning", f"Failed to get latency stats: {e}")
     
-    def parse_debug_data(self, data):
-        """Parse debug data string and update display"""
+    def reset_latency_stats(self):
+        """Clear the device's latency histogram"""
+        if not self.serial_port or not self.serial_port.is_open:
+            QMessageBox.warning(self, "Error", "Not connected to device")
+            return
+        
         try:
-            # Expected format: "buttons,lx,ly,rx,ry,lt,rt,dx,dy"
-            parts = data.split(',')
-            if len(parts) >= 9:
-                buttons = int(parts[0])
-                left_x = int(parts[1])
-                left_y = int(parts[2])
-                right_x = int(parts[3])
-                right_y = int(parts[4])
-                left_trigger = int(parts[5])
-                right_trigger = int(parts[6])
-                dpad_x = int(parts[7])
-                dpad_y = int(parts[8])
-                
-                self.update_debug_display(buttons, left_x, left_y, right_x, right_y,
-                                         left_trigger, right_trigger, dpad_x, dpad_y)
+            if self.query_device("LAT_STATS_RESET", "LAT_STATS_RESET"):
+                self.latency_label.setText("No samples")
+                self.latency_hist_text.clear()
+                self.statusBar().showMessage("Latency stats reset")
+            else:
+                self.statusBar().showMessage("No response from device")
         except Exception as e:
-            # Ignore parse errors
-            pass
+            QMessageBox.warning(self, "Warning", f"Failed to reset latency stats: {e}")
     
     def update_debug_display(self, buttons, left_x, left_y, right_x, right_y,
                             left_trigger, right_trigger, dpad_x, dpad_y):
@@ -655,6 +1047,7 @@ class ConfigTool(QMainWindow):
         if self.debug_mode_active:
             self.debug_mode_active = False
             self.debug_timer.stop()
+            self.stop_telemetry()
             self.reset_debug_display()
         
         if self.serial_port:
@@ -735,6 +1128,10 @@ class ConfigTool(QMainWindow):
         if not self.serial_port or not self.serial_port.is_open:
             QMessageBox.warning(self, "Error", "Not connected to device")
             return
+        if self.telemetry_reader:
+            # The stream reader keeps only the last few text lines
+            QMessageBox.warning(self, "Error", "Stop debug mode first")
+            return
         
         try:
             # Clear any pending data
@@ -804,27 +1201,15 @@ class ConfigTool(QMainWindow):
             return
         
         try:
-            self.serial_port.write(b"LOG_CLEAR\n")
+            response = self.query_device("LOG_CLEAR", "LOG_CLEARED")
+            if response is None:
+                self.statusBar().showMessage("No response from device")
+                return
             
-            # Wait for response with event processing
-            start_time = time.time()
-            while self.serial_port.in_waiting == 0:
-                QApplication.processEvents()
-                if time.time() - start_time > 1.0:
-                    self.statusBar().showMessage("No response from device")
-                    return
-                time.sleep(0.01)
-            
-            # Read response (data is available from the loop above)
-            if self.serial_port.in_waiting > 0:
-                response = self.serial_port.readline().decode('utf-8', errors='ignore').strip()
-                if response == "LOG_CLEARED":
-                    self.log_text.clear()
-                    self.log_count_label.setText("Entries: 0")
-                    self.log_overflow_label.setText("Overflow: No")
-                    self.statusBar().showMessage("Logs cleared")
-                else:
-                    self.statusBar().showMessage(f"Unexpected response: {response}")
+            self.log_text.clear()
+            self.log_count_label.setText("Entries: 0")
+            self.log_overflow_label.setText("Overflow: No")
+            self.statusBar().showMessage("Logs cleared")
         except Exception as e:
             QMessageBox.critical(self, "Error", f"Failed to clear logs: {e}")
     
@@ -863,26 +1248,15 @@ class ConfigTool(QMainWindow):
             return
         
         try:
-            command = f"LOG_LEVEL {index}\n"
-            self.serial_port.write(command.encode())
-            
-            # Wait for response with event processing
-            start_time = time.time()
-            while self.serial_port.in_waiting == 0:
-                QApplication.processEvents()
-                if time.time() - start_time > 1.0:
-                    self.statusBar().showMessage("No response from device")
-                    return
-                time.sleep(0.01)
-            
-            # Read response (data is available from the loop above)
-            if self.serial_port.in_waiting > 0:
-                response = self.serial_port.readline().decode('utf-8', errors='ignore').strip()
-                if response.startswith("LOG_LEVEL_SET:"):
-                    level_names = ["DEBUG", "INFO", "WARN", "ERROR"]
-                    self.statusBar().showMessage(f"Log level set to {level_names[index]}")
-                else:
-                    self.statusBar().showMessage(f"Failed to set log level: {response}")
+            # LOG_LEVEL_SET or LOG_LEVEL_ERROR
+            response = self.query_device(f"LOG_LEVEL {index}", "LOG_LEVEL_")
+            if response is None:
+                self.statusBar().showMessage("No response from device")
+            elif response.startswith("LOG_LEVEL_SET:"):
+                level_names = ["DEBUG", "INFO", "WARN", "ERROR"]
+                self.statusBar().showMessage(f"Log level set to {level_names[index]}")
+            else:
+                self.statusBar().showMessage(f"Failed to set log level: {response}")
         except Exception as e:
             QMessageBox.warning(self, "Warning", f"Failed to set log level: {e}")
     
@@ -893,44 +1267,284 @@ class ConfigTool(QMainWindow):
             return
         
         try:
-            self.serial_port.reset_input_buffer()
-            self.serial_port.write(b"LOG_STATUS\n")
+            response = self.query_device("LOG_STATUS", "LOG_STATUS:")
+            if response is None:
+                self.statusBar().showMessage("No response from device")
+                return
             
-            # Wait for response with event processing
-            start_time = time.time()
-            while self.serial_port.in_waiting == 0:
+            # Parse: LOG_STATUS:level=X,count=Y,overflow=Z
+            status_str = response[11:]
+            parts = {}
+            for item in status_str.split(','):
+                if '=' in item:
+                    key_val = item.split('=', 1)  # Split only on first '='
+                    if len(key_val) == 2:
+                        parts[key_val[0]] = key_val[1]
+            
+            count = int(parts.get('count', '0'))
+            overflow = parts.get('overflow', '0') == '1'
+            level = int(parts.get('level', '1'))
+            
+            self.log_count_label.setText(f"Entries: {count}")
+            self.log_overflow_label.setText(f"Overflow: {'Yes' if overflow else 'No'}")
+            self.log_level_combo.setCurrentIndex(level)
+            
+            self.statusBar().showMessage("Log status updated")
+        except Exception as e:
+            QMessageBox.warning(self, "Warning", f"Failed to get log status: {e}")
+    
+    def read_reply_block(self, command, end_line, timeout=3.0):
+        """Send a command with a multi-line reply and collect it up to end_line
+        
+        Returns the lines before end_line, or None on timeout. Reads the port
+        directly, so the input stream must be stopped (see profiler_ready).
+        """
+        if self.telemetry_reader:
+            return None
+        
+        self.serial_port.reset_input_buffer()
+        self.serial_port.write(command.encode() + b"\n")
+        
+        lines = []
+        last_data_time = time.time()
+        while time.time() - last_data_time < timeout:
+            if self.serial_port.in_waiting > 0:
+                line = self.serial_port.readline().decode('utf-8', errors='ignore').strip()
+                last_data_time = time.time()
+                if line == end_line:
+                    return lines
+                if line:
+                    lines.append(line)
+            else:
                 QApplication.processEvents()
-                if time.time() - start_time > 1.0:
-                    self.statusBar().showMessage("No response from device")
-                    return
                 time.sleep(0.01)
+        return None
+    
+    def profiler_ready(self):
+        """Check the port can take a profiler request"""
+        if not self.serial_port or not self.serial_port.is_open:
+            QMessageBox.warning(self, "Error", "Not connected to device")
+            return False
+        if self.telemetry_reader:
+            QMessageBox.warning(self, "Error", "Stop debug mode first")
+            return False
+        return True
+    
+    def fetch_profile(self):
+        """Read the PROF reply
+        
+        Returns (header dict, list of task dicts) or None.
+        """
+        lines = self.read_reply_block("PROF", "PROF_END")
+        if lines is None:
+            return None
+        
+        header = {}
+        tasks = []
+        for line in lines:
+            if line.startswith("PROF:"):
+                # PROF:tasks=N,cycle_hz=HZ,trace=COUNT/SIZE
+                for item in line[5:].split(','):
+                    if '=' in item:
+                        key, val = item.split('=', 1)
+                        header[key] = val
+            elif line.startswith("PROF_TASK:"):
+                # PROF_TASK:id,name,calls=..,avg=..,max=..,overruns=..,budget_us=..
+                fields = line[10:].split(',')
+                if len(fields) < 2:
+                    continue
+                task = {'id': int(fields[0]), 'name': fields[1]}
+                for item in fields[2:]:
+                    if '=' in item:
+                        key, val = item.split('=', 1)
+                        task[key] = int(val)
+                tasks.append(task)
+        return header, tasks
+    
+    def refresh_profile(self):
+        """Show per-task run time"""
+        if not self.profiler_ready():
+            return
+        
+        try:
+            result = self.fetch_profile()
+            if result is None:
+                self.statusBar().showMessage("No response from device")
+                return
+            header, tasks = result
+            cycles_per_us = int(header.get('cycle_hz', '1000000')) / 1e6
             
-            # Read response (data is available from the loop above)
-            if self.serial_port.in_waiting > 0:
-                response = self.serial_port.readline().decode('utf-8', errors='ignore').strip()
-                if response.startswith("LOG_STATUS:"):
-                    # Parse: LOG_STATUS:level=X,count=Y,overflow=Z
-                    status_str = response[11:]
-                    parts = {}
-                    for item in status_str.split(','):
-                        if '=' in item:
-                            key_val = item.split('=', 1)  # Split only on first '='
-                            if len(key_val) == 2:
-                                parts[key_val[0]] = key_val[1]
-                    
-                    count = int(parts.get('count', '0'))
-                    overflow = parts.get('overflow', '0') == '1'
-                    level = int(parts.get('level', '1'))
-                    
-                    self.log_count_label.setText(f"Entries: {count}")
-                    self.log_overflow_label.setText(f"Overflow: {'Yes' if overflow else 'No'}")
-                    self.log_level_combo.setCurrentIndex(level)
-                    
-                    self.statusBar().showMessage("Log status updated")
-                else:
-                    self.statusBar().showMessage(f"Unexpected response: {response}")
+            self.prof_table.setRowCount(len(tasks))
+            for row, task in enumerate(tasks):
+                values = [
+                    task['name'],
+                    str(task.get('calls', 0)),
+                    f"{task.get('avg', 0) / cycles_per_us:.1f}",
+                    f"{task.get('max', 0) / cycles_per_us:.1f}",
+                    str(task.get('overruns', 0)),
+                    str(task.get('budget_us', 0)),
+                ]
+                for col, value in enumerate(values):
+                    self.prof_table.setItem(row, col, QTableWidgetItem(value))
+            
+            self.prof_status_label.setText(f"Trace: {header.get('trace', '0/0')} runs captured")
+            self.statusBar().showMessage("Task profile updated")
         except Exception as e:
-            QMessageBox.warning(self, "Warning", f"Failed to get log status: {e}")
+            QMessageBox.warning(self, "Warning", f"Failed to read task profile: {e}")
+    
+    # Shown for the STATS counter names
+    COUNTER_LABELS = {
+        "rx": "Input reports received",
+        "rx_decoded": "Input reports decoded",
+        "rx_undecoded": "Input reports ignored (short / no input fields)",
+        "rx_dropped": "Input events dropped (queue full)",
+        "rearm_failed": "Report re-arm failures",
+        "tx": "HID reports sent",
+        "tx_suppressed": "HID reports suppressed (unchanged)",
+        "tx_dropped": "HID reports dropped (overwritten)",
+        "tx_disabled": "HID reports for a disabled output type",
+        "macro_starts": "Macros started",
+        "macro_rejected": "Macro starts rejected",
+        "reply_dropped": "Command replies dropped (serial port stalled)",
+    }
+    
+    def refresh_counters(self, reset):
+        """Show the pipeline counters, optionally clearing them"""
+        if not self.profiler_ready():
+            return
+        
+        try:
+            response = self.query_device("STATS RESET" if reset else "STATS", "STATS:")
+            if not response:
+                self.statusBar().showMessage("No response from device")
+                return
+            
+            # STATS:name=value,...
+            counters = [item.split('=', 1) for item in response[6:].split(',') if '=' in item]
+            self.counters_table.setRowCount(len(counters))
+            for row, (name, value) in enumerate(counters):
+                self.counters_table.setItem(row, 0, QTableWidgetItem(self.COUNTER_LABELS.get(name, name)))
+                self.counters_table.setItem(row, 1, QTableWidgetItem(value))
+            self.statusBar().showMessage("Counters reset" if reset else "Counters updated")
+        except Exception as e:
+            QMessageBox.warning(self, "Warning", f"Failed to read counters: {e}")
+    
+    def run_bench(self):
+        """Time the remapping pipeline on the device with synthetic input"""
+        if not self.profiler_ready():
+            return
+        
+        try:
+            reports = self.bench_reports_spin.value()
+            response = self.query_device(f"BENCH {reports}", "BENCH", timeout=5.0)
+            if not response:
+                self.statusBar().showMessage("No response from device")
+                return
+            if response.startswith("BENCH_ERROR:"):
+                self.bench_result_label.setText(f"Failed: {response[12:]}")
+                return
+            
+            # BENCH:reports=N,rate=N,avg_cycles=N,max_cycles=N,macros=N,cycle_hz=HZ
+            result = dict(item.split('=', 1) for item in response[6:].split(',') if '=' in item)
+            cycles_per_us = int(result.get('cycle_hz', '1000000')) / 1e6
+            self.bench_result_label.setText(
+                f"{int(result.get('rate', '0')):,} reports/s, "
+                f"avg {int(result.get('avg_cycles', '0')) / cycles_per_us:.2f} us, "
+                f"max {int(result.get('max_cycles', '0')) / cycles_per_us:.2f} us, "
+                f"{result.get('macros', '0')} macros")
+            self.statusBar().showMessage("Benchmark complete")
+        except Exception as e:
+            QMessageBox.warning(self, "Warning", f"Failed to run benchmark: {e}")
+    
+    def reset_profile(self):
+        """Clear the device's task statistics"""
+        if not self.profiler_ready():
+            return
+        
+        try:
+            if self.query_device("PROF_RESET", "PROF_RESET"):
+                self.prof_table.setRowCount(0)
+                self.statusBar().showMessage("Task profile reset")
+            else:
+                self.statusBar().showMessage("No response from device")
+        except Exception as e:
+            QMessageBox.warning(self, "Warning", f"Failed to reset task profile: {e}")
+    
+    def start_profile_trace(self):
+        """Capture the next task runs on the device"""
+        if not self.profiler_ready():
+            return
+        
+        try:
+            response = self.query_device("PROF_TRACE_START", "PROF_TRACE_STARTED:")
+            if response:
+                self.prof_status_label.setText(f"Trace: capturing {response[19:]} runs")
+                self.statusBar().showMessage("Trace started")
+            else:
+                self.statusBar().showMessage("No response from device")
+        except Exception as e:
+            QMessageBox.warning(self, "Warning", f"Failed to start trace: {e}")
+    
+    def export_profile_trace(self):
+        """Save the captured trace as Chrome trace-event JSON (chrome://tracing, Perfetto)"""
+        if not self.profiler_ready():
+            return
+        
+        try:
+            result = self.fetch_profile()
+            lines = self.read_reply_block("PROF_TRACE_GET", "PROF_TRACE_END") if result else None
+            if result is None or lines is None:
+                self.statusBar().showMessage("No response from device")
+                return
+            
+            header, tasks = result
+            names = {task['id']: task['name'] for task in tasks}
+            cycle_hz = int(header.get('cycle_hz', '1000000'))
+            for line in lines:
+                if line.startswith("PROF_TRACE:"):
+                    for item in line[11:].split(','):
+                        if item.startswith("cycle_hz="):
+                            cycle_hz = int(item[9:])
+            
+            # T:<task>,<start_us>,<cycles>
+            events = []
+            for line in lines:
+                if not line.startswith("T:"):
+                    continue
+                task_id, start_us, cycles = (int(v) for v in line[2:].split(','))
+                events.append({
+                    "name": names.get(task_id, f"task {task_id}"),
+                    "ph": "X",
+                    "ts": start_us,
+                    "dur": cycles * 1e6 / cycle_hz,
+                    "pid": 0,
+                    "tid": 0,
+                })
+            
+            if not events:
+                QMessageBox.information(self, "Export Trace",
+                                        "No trace captured. Click 'Start Trace' first.")
+                return
+            
+            timestamp = datetime.now().strftime("%Y%m%d_%H%M%S")
+            filename, _ = QFileDialog.getSaveFileName(
+                self,
+                "Export Trace",
+                f"joystick_converter_trace_{timestamp}.json",
+                "Chrome Trace (*.json);;All Files (*)"
+            )
+            if filename:
+                with open(filename, 'w', encoding='utf-8') as f:
+                    json.dump({
+                        "traceEvents": events + [{
+                            "name": "thread_name", "ph": "M", "pid": 0, "tid": 0,
+                            "args": {"name": "core 0 scheduler"},
+                        }],
+                        "displayTimeUnit": "ns",
+                    }, f)
+                self.statusBar().showMessage(f"Exported {len(events)} task runs to {filename}")
+        except Exception as e:
+            QMessageBox.warning(self, "Warning", f"Failed to export trace: {e}")
     
     def closeEvent(self, event):
         """Handle window close"""
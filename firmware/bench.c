@@ -0,0 +1,99 @@
+/**
+ * Pipeline Self-Benchmark Implementation
+ */
+
+#include "bench.h"
+#include <string.h>
+#include "usb_host.h"
+#include "remapping.h"
+#include "macro.h"
+#include "hal.h"
+
+static uint32_t bench_rand_state;
+
+static uint32_t bench_rand(void) {
+    // xorshift32
+    uint32_t x = bench_rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bench_rand_state = x;
+    return x;
+}
+
+/**
+ * Build the next synthetic input: one or two button edges, sweeping sticks
+ */
+static void bench_next_state(gamepad_state_t *state, uint32_t n) {
+    uint32_t r = bench_rand();
+    state->buttons ^= (uint16_t)(1u << (r & 0x0F));
+    if (r & 0x100) {
+        state->buttons ^= (uint16_t)(1u << ((r >> 4) & 0x0F));
+    }
+
+    int16_t sweep = (int16_t)((n * 257u) & 0xFFFF);
+    state->left_x = sweep;
+    state->left_y = (int16_t)-sweep;
+    state->right_x = (int16_t)(sweep / 2);
+    state->right_y = (int16_t)(-sweep / 2);
+    state->left_trigger = (uint8_t)n;
+    state->right_trigger = (uint8_t)(255 - (n & 0xFF));
+    state->dpad_x = (int8_t)((r >> 9) % 3) - 1;
+    state->dpad_y = (int8_t)((r >> 11) % 3) - 1;
+}
+
+bool bench_run(uint32_t reports, bench_result_t *result) {
+    if (!result || reports == 0 || reports > BENCH_MAX_REPORTS) {
+        return false;
+    }
+
+    // Feed from a slot no controller uses, so live input stays untouched
+    uint8_t connected = usb_host_get_connected_devices();
+    uint8_t slot = 0;
+    while (slot < USB_HOST_MAX_DEVICES && (connected & (1u << slot))) {
+        slot++;
+    }
+    if (slot >= USB_HOST_MAX_DEVICES) {
+        return false;
+    }
+
+    memset(result, 0, sizeof(*result));
+    bench_rand_state = 0x12345678u;
+
+    gamepad_state_t state;
+    memset(&state, 0, sizeof(state));
+    uint8_t macros_running = macro_running_slots();
+    uint64_t cycles_total = 0;
+
+    for (uint32_t n = 0; n < reports; n++) {
+        bench_next_state(&state, n);
+
+        uint32_t start = hal_cycle_count();
+        remapping_process_input(slot, &state, 0);
+        uint32_t cycles = hal_cycle_count() - start;
+
+        cycles_total += cycles;
+        if (cycles > result->cycles_max) {
+            result->cycles_max = cycles;
+        }
+
+        // Stop macros the benchmark started so the next trigger starts
+        // one again and none of them ever runs
+        uint8_t started = macro_running_slots() & (uint8_t)~macros_running;
+        if (started) {
+            macro_stop(started);
+            result->macro_triggers += (uint32_t)__builtin_popcount(started);
+        }
+    }
+
+    // Release everything the synthetic device held
+    remapping_remove_device(slot);
+    macro_stop(macro_running_slots() & (uint8_t)~macros_running);
+
+    result->reports = reports;
+    result->cycles_avg = (uint32_t)(cycles_total / reports);
+    if (cycles_total > 0) {
+        result->reports_per_sec = (uint32_t)((uint64_t)reports * hal_cycle_hz() / cycles_total);
+    }
+    return true;
+}
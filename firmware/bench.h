@@ -0,0 +1,44 @@
+/**
+ * Pipeline Self-Benchmark
+ *
+ * Measures how many input reports per second the remapping pipeline can
+ * take with the current configuration, on the device itself. Synthetic
+ * gamepad states (random button edges, sweeping sticks and triggers) are
+ * fed through remapping_process_input() from an unused device slot, so
+ * every mapping and macro trigger of the active profile is exercised.
+ *
+ * Nothing reaches the USB host: the benchmark runs to completion inside
+ * one task call, so output_task() never sees the intermediate output, and
+ * the synthetic device is removed (releasing everything it held) and any
+ * macro it started is stopped before bench_run() returns.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BENCH_DEFAULT_REPORTS 10000
+#define BENCH_MAX_REPORTS     100000
+
+// Benchmark result; cycles are hal_cycle_count() ticks per report
+typedef struct {
+    uint32_t reports;          // Reports processed
+    uint32_t reports_per_sec;  // Throughput ceiling
+    uint32_t cycles_avg;       // Mean cost of one report
+    uint32_t cycles_max;       // Worst report
+    uint32_t macro_triggers;   // Macros started by the mappings
+} bench_result_t;
+
+/**
+ * Run the benchmark
+ * Blocks for the whole run (about 0.1 s per 10000 reports on the RP2350).
+ * @param reports Number of synthetic reports (1 to BENCH_MAX_REPORTS)
+ * @param result Pointer to store the result
+ * @return true on success, false on invalid count or if every device slot
+ *         is in use
+ */
+bool bench_run(uint32_t reports, bench_result_t *result);
+
+#endif // BENCH_H
@@ -0,0 +1,209 @@
+/**
+ * Command Channel Implementation
+ */
+
+#include "command.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tusb.h"
+#include "sched.h"
+#include "counters.h"
+
+#if (COMMAND_REPLY_QUEUE_SIZE & (COMMAND_REPLY_QUEUE_SIZE - 1)) != 0
+#error "COMMAND_REPLY_QUEUE_SIZE must be a power of two"
+#endif
+
+#define COMMAND_REPLY_QUEUE_MASK (COMMAND_REPLY_QUEUE_SIZE - 1)
+
+static const command_t *command_table = NULL;
+static uint16_t command_count = 0;
+
+// Line being received; a line that overflows is dropped up to its newline
+static char line_buffer[COMMAND_LINE_SIZE];
+static uint16_t line_pos = 0;
+static bool line_overflow = false;
+
+// Reply line being assembled by command_printf; sent once it is complete
+static char reply_line[CFG_TUD_CDC_TX_BUFSIZE];
+static uint16_t reply_len = 0;
+
+// Reply text waiting for room in the CDC TX FIFO; head and tail are
+// free-running byte positions
+static char reply_queue[COMMAND_REPLY_QUEUE_SIZE];
+static uint32_t reply_head = 0;  // Next byte to queue
+static uint32_t reply_tail = 0;  // Next byte to send
+
+bool command_init(const command_t *table, uint16_t count) {
+    for (uint16_t i = 1; i < count; i++) {
+        if (strcmp(table[i - 1].name, table[i].name) >= 0) {
+            return false;
+        }
+    }
+
+    command_table = table;
+    command_count = count;
+    line_pos = 0;
+    line_overflow = false;
+    return true;
+}
+
+static int command_compare(const void *key, const void *entry) {
+    return strcmp((const char *)key, ((const command_t *)entry)->name);
+}
+
+/**
+ * Split a line into name and arguments and run its handler
+ */
+static void command_dispatch(char *line) {
+    char *args = strchr(line, ' ');
+    if (args) {
+        *args++ = '\0';
+    } else {
+        args = line + strlen(line);
+    }
+
+    const command_t *cmd = bsearch(line, command_table, command_count,
+                                   sizeof(command_t), command_compare);
+    if (cmd) {
+        cmd->handler(args);
+    }
+}
+
+/**
+ * Add received bytes to the line buffer, dispatching each complete line
+ */
+static void command_receive(const uint8_t *data, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t c = data[i];
+
+        if (c == '\n' || c == '\r') {
+            if (line_pos > 0 && !line_overflow) {
+                line_buffer[line_pos] = '\0';
+                command_dispatch(line_buffer);
+            }
+            line_pos = 0;
+            line_overflow = false;
+        } else if (c > 127) {
+            // Not a text command, discard the line
+            line_overflow = true;
+        } else if (line_pos < COMMAND_LINE_SIZE - 1) {
+            // Only add printable characters
+            if (c >= 32 && c < 127) {
+                line_buffer[line_pos++] = (char)c;
+            }
+        } else {
+            line_overflow = true;
+        }
+    }
+}
+
+void command_task(void) {
+    uint8_t buf[CFG_TUD_CDC_EP_BUFSIZE];
+    uint32_t len;
+
+    while ((len = tud_cdc_read(buf, sizeof(buf))) > 0) {
+        command_receive(buf, len);
+    }
+
+    command_reply_drain();
+    tud_cdc_write_flush();
+}
+
+/**
+ * Send reply text, or queue it behind earlier text until the CDC FIFO has
+ * room; text that does not fit in the queue either is dropped whole
+ */
+static void command_send(const char *data, uint32_t len) {
+    if (reply_head == reply_tail && tud_cdc_write_available() >= len) {
+        tud_cdc_write(data, len);
+        return;
+    }
+    if (len > COMMAND_REPLY_QUEUE_SIZE - (reply_head - reply_tail)) {
+        counters_inc(COUNTER_REPLY_DROPPED);
+        return;
+    }
+
+    uint32_t offset = reply_head & COMMAND_REPLY_QUEUE_MASK;
+    uint32_t first = COMMAND_REPLY_QUEUE_SIZE - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(&reply_queue[offset], data, first);
+    memcpy(reply_queue, data + first, len - first);
+    reply_head += len;
+}
+
+void command_reply_drain(void) {
+    while (reply_head != reply_tail) {
+        uint32_t offset = reply_tail & COMMAND_REPLY_QUEUE_MASK;
+        uint32_t len = reply_head - reply_tail;
+        if (len > COMMAND_REPLY_QUEUE_SIZE - offset) {
+            len = COMMAND_REPLY_QUEUE_SIZE - offset;  // Rest follows after the wrap
+        }
+        uint32_t written = tud_cdc_write(&reply_queue[offset], len);
+        reply_tail += written;
+        if (written < len) {
+            break;
+        }
+    }
+}
+
+uint32_t command_reply_queued(void) {
+    return reply_head - reply_tail;
+}
+
+bool command_reply_pending(void) {
+    return reply_head != reply_tail && tud_cdc_write_available() > 0;
+}
+
+void command_printf(const char *format, ...) {
+    char buf[COMMAND_LINE_SIZE * 2];
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    if (len <= 0) {
+        return;
+    }
+    if ((uint32_t)len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+
+    // Replies built from several calls go out as one line
+    if (reply_len + (uint32_t)len > sizeof(reply_line)) {
+        command_send(reply_line, reply_len);
+        reply_len = 0;
+    }
+    memcpy(&reply_line[reply_len], buf, (size_t)len);
+    reply_len = (uint16_t)(reply_len + len);
+    if (reply_line[reply_len - 1] == '\n') {
+        command_send(reply_line, reply_len);
+        reply_len = 0;
+    }
+}
+
+uint32_t command_write(const char *data, uint32_t len) {
+    return tud_cdc_write(data, len);
+}
+
+uint32_t command_write_space(void) {
+    return tud_cdc_write_available();
+}
+
+void command_flush(void) {
+    tud_cdc_write_flush();
+}
+
+//--------------------------------------------------------------------
+// TinyUSB callbacks
+//--------------------------------------------------------------------
+
+// Invoked from tud_task when CDC data arrives
+void tud_cdc_rx_cb(uint8_t itf) {
+    (void)itf;
+    sched_signal(SCHED_EVENT_SERIAL_RX);
+}
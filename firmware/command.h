@@ -0,0 +1,99 @@
+/**
+ * Command Channel
+ *
+ * Line-based command interface on the USB CDC serial port used by the
+ * configuration tool. Received data is read from the CDC FIFO in bulk
+ * when TinyUSB reports it (tud_cdc_rx_cb), split into lines of the form
+ * "NAME [args]" and dispatched through a table sorted by name. Replies are
+ * queued in the CDC TX FIFO and flushed once per batch of commands; lines
+ * that do not fit wait in a RAM queue, which the reply_stream task drains
+ * as the host reads, so a handler never waits on the host.
+ */
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Longest command line, including the terminator; longer lines are discarded
+#define COMMAND_LINE_SIZE 128
+
+// Reply text held while the CDC TX FIFO is full (must be a power of two)
+#define COMMAND_REPLY_QUEUE_SIZE 2048
+
+/**
+ * Command handler
+ * @param args Text after the command name and a single space ("" if none)
+ */
+typedef void (*command_handler_t)(const char *args);
+
+// Command table entry
+typedef struct {
+    const char *name;
+    command_handler_t handler;
+} command_t;
+
+/**
+ * Install the command table
+ * @param table Commands, sorted by name in strcmp order (must stay valid)
+ * @param count Number of commands
+ * @return true on success, false if the table is not sorted
+ */
+bool command_init(const command_t *table, uint16_t count);
+
+/**
+ * Read all received data, run the complete commands and flush the replies
+ * Runs on SCHED_EVENT_SERIAL_RX, which tud_cdc_rx_cb signals.
+ */
+void command_task(void);
+
+/**
+ * Queue a formatted reply
+ * Text is collected until it ends a line, so a reply built from several
+ * calls goes out whole. Lines the TX FIFO has no room for are queued (see
+ * command_reply_drain()); a line that does not fit in the queue either is
+ * dropped whole and counted as reply_dropped (counters.h).
+ * @param format Printf-style format string
+ */
+void command_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * Move queued reply text into the TX FIFO as far as it has room
+ */
+void command_reply_drain(void);
+
+/**
+ * Get the amount of queued reply text
+ * Raw data (command_write) must wait until this is 0, or it would land
+ * ahead of replies already given.
+ * @return Bytes waiting for the TX FIFO
+ */
+uint32_t command_reply_queued(void);
+
+/**
+ * Check if queued reply text can make progress
+ * @return true if text is queued and the TX FIFO has room
+ */
+bool command_reply_pending(void);
+
+/**
+ * Queue raw reply data
+ * @param data Data to send
+ * @param len Number of bytes
+ * @return Number of bytes queued (less than len if the TX FIFO is full)
+ */
+uint32_t command_write(const char *data, uint32_t len);
+
+/**
+ * Get free space in the TX FIFO
+ * @return Bytes that command_write can queue without truncating
+ */
+uint32_t command_write_space(void);
+
+/**
+ * Start sending queued replies
+ */
+void command_flush(void);
+
+#endif // COMMAND_H
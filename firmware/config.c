@@ -5,24 +5,52 @@
 #include "config.h"
 #include <stdio.h>
 #include <string.h>
-#include "pico/stdlib.h"
-#include "pico/platform.h"
-#include "hardware/flash.h"
-#include "hardware/sync.h"
+#include "hal.h"
 
 #define CONFIG_MAGIC 0x4A435446  // "JCTF" - Joystick Converter Config
 
 // Flash storage offset (use last sector of flash)
-// Note: Actual offset should be calculated based on flash size
-#define CONFIG_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define CONFIG_FLASH_OFFSET (hal_flash_size() - HAL_FLASH_SECTOR_SIZE)
 
 static config_t current_config;
 
+// Direct-indexed dispatch table: button bit -> first mapping for that bit
+static const button_mapping_t *button_dispatch[CONFIG_NUM_BUTTONS];
+static uint16_t mapped_buttons = 0;
+
+// Check whether a source button value is exactly one bit
+static bool is_single_button(uint16_t source_button) {
+    return source_button != 0 && (source_button & (source_button - 1)) == 0;
+}
+
+void config_rebuild_dispatch(void) {
+    memset(button_dispatch, 0, sizeof(button_dispatch));
+    mapped_buttons = 0;
+    
+    if (current_config.num_mappings > MAX_BUTTON_MAPPINGS) {
+        current_config.num_mappings = MAX_BUTTON_MAPPINGS;
+    }
+    
+    // The first mapping for a button wins, matching config_find_mapping
+    for (uint8_t i = 0; i < current_config.num_mappings; i++) {
+        const button_mapping_t *mapping = &current_config.mappings[i];
+        if (!is_single_button(mapping->source_button)) {
+            continue;
+        }
+        
+        uint8_t bit = (uint8_t)__builtin_ctz(mapping->source_button);
+        if (!button_dispatch[bit]) {
+            button_dispatch[bit] = mapping;
+            mapped_buttons |= mapping->source_button;
+        }
+    }
+}
+
 bool config_load(void) {
     printf("Config: Loading from flash...\n");
     
     // Read configuration from flash
-    const uint8_t *flash_data = (const uint8_t *)(XIP_BASE + CONFIG_FLASH_OFFSET);
+    const uint8_t *flash_data = hal_flash_read(CONFIG_FLASH_OFFSET);
     memcpy(&current_config, flash_data, sizeof(config_t));
     
     // Validate magic number and version
@@ -36,6 +64,8 @@ bool config_load(void) {
         return false;
     }
     
+    config_rebuild_dispatch();
+    
     printf("Config: Loaded %d mappings\n", current_config.num_mappings);
     return true;
 }
@@ -47,18 +77,17 @@ bool config_save(void) {
     current_config.magic = CONFIG_MAGIC;
     current_config.version = CONFIG_VERSION;
     
-    // Disable interrupts during flash write
-    uint32_t ints = save_and_disable_interrupts();
-    
     // Erase sector
-    flash_range_erase(CONFIG_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    if (!hal_flash_erase(CONFIG_FLASH_OFFSET, HAL_FLASH_SECTOR_SIZE)) {
+        printf("Config: Flash erase failed\n");
+        return false;
+    }
     
     // Write configuration
-    flash_range_program(CONFIG_FLASH_OFFSET, (const uint8_t*)&current_config, 
-                        sizeof(config_t));
-    
-    // Restore interrupts
-    restore_interrupts(ints);
+    if (!hal_flash_program(CONFIG_FLASH_OFFSET, &current_config, sizeof(config_t))) {
+        printf("Config: Flash program failed\n");
+        return false;
+    }
     
     printf("Config: Saved successfully\n");
     return true;
@@ -72,6 +101,7 @@ void config_set_defaults(void) {
     current_config.version = CONFIG_VERSION;
     current_config.output_type = OUTPUT_TYPE_GAMEPAD;
     current_config.num_mappings = 0;
+    config_rebuild_dispatch();
     
     // Add some default passthrough mappings
     // These just pass buttons through without modification
@@ -96,6 +126,7 @@ bool config_add_mapping(uint16_t source_button, mapping_type_t type,
     mapping->macro_id = macro_id;
     
     current_config.num_mappings++;
+    config_rebuild_dispatch();
     
     printf("Config: Added mapping for button 0x%04X\n", source_button);
     return true;
@@ -104,10 +135,15 @@ bool config_add_mapping(uint16_t source_button, mapping_type_t type,
 void config_clear_mappings(void) {
     current_config.num_mappings = 0;
     memset(current_config.mappings, 0, sizeof(current_config.mappings));
+    config_rebuild_dispatch();
     printf("Config: Cleared all mappings\n");
 }
 
 button_mapping_t* config_find_mapping(uint16_t source_button) {
+    if (is_single_button(source_button)) {
+        return (button_mapping_t *)button_dispatch[__builtin_ctz(source_button)];
+    }
+    
     for (uint8_t i = 0; i < current_config.num_mappings; i++) {
         if (current_config.mappings[i].source_button == source_button) {
             return &current_config.mappings[i];
@@ -115,3 +151,14 @@ button_mapping_t* config_find_mapping(uint16_t source_button) {
     }
     return NULL;
 }
+
+const button_mapping_t* config_get_button_mapping(uint8_t bit) {
+    if (bit >= CONFIG_NUM_BUTTONS) {
+        return NULL;
+    }
+    return button_dispatch[bit];
+}
+
+uint16_t config_get_mapped_buttons(void) {
+    return mapped_buttons;
+}
@@ -13,7 +13,9 @@
 
 #define CONFIG_VERSION 1
 #define MAX_BUTTON_MAPPINGS 32
-#define MAX_MACRO_STEPS 128
+
+// Number of source buttons in the gamepad button bitmap
+#define CONFIG_NUM_BUTTONS 16
 
 // Button mapping types
 typedef enum {
@@ -88,4 +90,26 @@ void config_clear_mappings(void);
  */
 button_mapping_t* config_find_mapping(uint16_t source_button);
 
+/**
+ * Look up the mapping for a single button bit
+ * Reads the dispatch table compiled from the mapping list, so the cost
+ * does not depend on the number of mappings.
+ * @param bit Button bit index (0 to CONFIG_NUM_BUTTONS - 1)
+ * @return Pointer to mapping, or NULL if the button is unmapped
+ */
+const button_mapping_t* config_get_button_mapping(uint8_t bit);
+
+/**
+ * Get the set of buttons that have a mapping
+ * @return Bitmap of mapped source buttons
+ */
+uint16_t config_get_mapped_buttons(void);
+
+/**
+ * Rebuild the button dispatch table
+ * Called automatically by the config functions; must be called after
+ * editing the mapping list directly through config_get().
+ */
+void config_rebuild_dispatch(void);
+
 #endif // CONFIG_H
@@ -0,0 +1,213 @@
+/**
+ * UART Console Implementation
+ */
+
+#include "console.h"
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/stdio/driver.h"
+#include "pico/critical_section.h"
+#include "hardware/uart.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/gpio.h"
+
+#if (CONSOLE_BUFFER_SIZE & (CONSOLE_BUFFER_SIZE - 1)) != 0
+#error "CONSOLE_BUFFER_SIZE must be a power of two"
+#endif
+
+#define CONSOLE_BUFFER_MASK (CONSOLE_BUFFER_SIZE - 1)
+
+// UART1 on GPIO4/GPIO5: GPIO0/GPIO1 carry the PIO-USB host port's D+/D-
+#define CONSOLE_UART     uart1
+#define CONSOLE_UART_IRQ UART1_IRQ
+#define CONSOLE_TX_PIN   4
+#define CONSOLE_RX_PIN   5
+
+// Output ring; head and tail are free-running byte positions
+static uint8_t console_buffer[CONSOLE_BUFFER_SIZE];
+static volatile uint32_t console_head = 0;  // Next byte to write
+static volatile uint32_t console_tail = 0;  // Next byte to send
+static volatile uint32_t dma_len = 0;       // Bytes in the running transfer, 0 when idle
+
+static int dma_chan = -1;
+static critical_section_t console_lock;
+static console_stats_t console_stats = {0};
+
+static void (*chars_available_callback)(void *) = NULL;
+static void *chars_available_param = NULL;
+
+/**
+ * Start a transfer of the next contiguous run of queued bytes
+ * Called with console_lock held.
+ */
+static void console_kick_locked(void) {
+    if (dma_len != 0 || console_head == console_tail) {
+        return;
+    }
+
+    uint32_t offset = console_tail & CONSOLE_BUFFER_MASK;
+    uint32_t len = console_head - console_tail;
+    if (len > CONSOLE_BUFFER_SIZE - offset) {
+        len = CONSOLE_BUFFER_SIZE - offset;  // Rest follows after the wrap
+    }
+
+    dma_len = len;
+    dma_channel_transfer_from_buffer_now((uint)dma_chan, &console_buffer[offset], len);
+}
+
+/**
+ * DMA completion: release the sent bytes and continue with the next run
+ */
+static void console_dma_irq(void) {
+    // The DMA interrupt is shared with other channels
+    if (!dma_channel_get_irq0_status((uint)dma_chan)) {
+        return;
+    }
+    dma_channel_acknowledge_irq0((uint)dma_chan);
+
+    critical_section_enter_blocking(&console_lock);
+    console_tail += dma_len;
+    dma_len = 0;
+    console_kick_locked();
+    critical_section_exit(&console_lock);
+}
+
+static void console_uart_irq(void) {
+    // The RX interrupt stays asserted until the FIFO is read; in_chars re-enables it
+    uart_set_irq_enables(CONSOLE_UART, false, false);
+    if (chars_available_callback) {
+        chars_available_callback(chars_available_param);
+    }
+}
+
+static void console_out_chars(const char *buf, int len) {
+    if (len <= 0) {
+        return;
+    }
+
+    critical_section_enter_blocking(&console_lock);
+
+    uint32_t n = (uint32_t)len;
+    if (n > CONSOLE_BUFFER_SIZE - (console_head - console_tail)) {
+        // Drop the whole write rather than emit a torn line
+        console_stats.dropped += n;
+        critical_section_exit(&console_lock);
+        return;
+    }
+
+    uint32_t offset = console_head & CONSOLE_BUFFER_MASK;
+    uint32_t first = CONSOLE_BUFFER_SIZE - offset;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(&console_buffer[offset], buf, first);
+    memcpy(console_buffer, buf + first, n - first);
+    console_head += n;
+    console_stats.written += n;
+
+    console_kick_locked();
+    critical_section_exit(&console_lock);
+}
+
+static void console_out_flush(void) {
+    // Explicit flush (e.g. before a reset) waits for the ring to drain
+    while (console_head != console_tail) {
+        tight_loop_contents();
+    }
+    while (uart_get_hw(CONSOLE_UART)->fr & UART_UARTFR_BUSY_BITS) {
+        tight_loop_contents();
+    }
+}
+
+static int console_in_chars(char *buf, int len) {
+    int n = 0;
+    while (n < len && uart_is_readable(CONSOLE_UART)) {
+        buf[n++] = (char)uart_getc(CONSOLE_UART);
+    }
+    if (chars_available_callback) {
+        uart_set_irq_enables(CONSOLE_UART, true, false);
+    }
+    return n ? n : PICO_ERROR_NO_DATA;
+}
+
+static void console_set_chars_available_callback(void (*fn)(void *), void *param) {
+    chars_available_callback = fn;
+    chars_available_param = param;
+    uart_set_irq_enables(CONSOLE_UART, fn != NULL, false);
+    irq_set_enabled(CONSOLE_UART_IRQ, fn != NULL);
+}
+
+static stdio_driver_t console_driver = {
+    .out_chars = console_out_chars,
+    .out_flush = console_out_flush,
+    .in_chars = console_in_chars,
+    .set_chars_available_callback = console_set_chars_available_callback,
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+    .crlf_enabled = PICO_STDIO_DEFAULT_CRLF,
+#endif
+};
+
+bool console_init(uint32_t reserved_dma_channel) {
+    // Hold the reserved channel while picking one, so it stays free for
+    // its owner's hard claim
+    bool reserved_free = !dma_channel_is_claimed(reserved_dma_channel);
+    if (reserved_free) {
+        dma_channel_claim(reserved_dma_channel);
+    }
+    dma_chan = dma_claim_unused_channel(false);
+    if (reserved_free) {
+        dma_channel_unclaim(reserved_dma_channel);
+    }
+    if (dma_chan < 0) {
+        return false;
+    }
+
+    critical_section_init(&console_lock);
+
+    uart_init(CONSOLE_UART, CONSOLE_BAUD_RATE);
+    gpio_set_function(CONSOLE_TX_PIN, GPIO_FUNC_UART);
+    gpio_set_function(CONSOLE_RX_PIN, GPIO_FUNC_UART);
+    irq_set_exclusive_handler(CONSOLE_UART_IRQ, console_uart_irq);
+
+    // Byte-wide transfers from the ring into the UART data register, paced by TX DREQ
+    dma_channel_config cfg = dma_channel_get_default_config((uint)dma_chan);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, uart_get_dreq(CONSOLE_UART, true));
+    dma_channel_configure((uint)dma_chan, &cfg, &uart_get_hw(CONSOLE_UART)->dr, NULL, 0, false);
+
+    dma_channel_set_irq0_enabled((uint)dma_chan, true);
+    irq_add_shared_handler(DMA_IRQ_0, console_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    stdio_set_driver_enabled(&console_driver, true);
+    return true;
+}
+
+uint32_t console_write_space(void) {
+    return CONSOLE_BUFFER_SIZE - (console_head - console_tail);
+}
+
+void console_get_stats(console_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    if (dma_chan < 0) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    critical_section_enter_blocking(&console_lock);
+    *stats = console_stats;
+    critical_section_exit(&console_lock);
+}
+
+void console_reset_stats(void) {
+    if (dma_chan < 0) {
+        return;
+    }
+    critical_section_enter_blocking(&console_lock);
+    memset(&console_stats, 0, sizeof(console_stats));
+    critical_section_exit(&console_lock);
+}
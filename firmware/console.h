@@ -0,0 +1,55 @@
+/**
+ * UART Console
+ *
+ * stdio driver for the debug UART (UART1, TX on GPIO4, RX on GPIO5; GPIO0
+ * and GPIO1 belong to the PIO-USB host port). Output is appended to a
+ * RAM ring and sent to the UART by DMA in the background, so printf costs
+ * a copy instead of waiting on the UART FIFO. When the ring is full the
+ * write is dropped and counted rather than blocking. Input is read from
+ * the UART RX FIFO.
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Output ring size in bytes (must be a power of two)
+#define CONSOLE_BUFFER_SIZE 4096
+
+#define CONSOLE_BAUD_RATE 115200
+
+// Output statistics
+typedef struct {
+    uint32_t written;  // Bytes queued for the UART
+    uint32_t dropped;  // Bytes dropped because the ring was full
+} console_stats_t;
+
+/**
+ * Initialize the UART, claim a DMA channel and install the stdio driver
+ * @param reserved_dma_channel Channel another module claims later (the
+ *        PIO-USB host), never taken by the console
+ * @return true on success, false if no DMA channel is free
+ */
+bool console_init(uint32_t reserved_dma_channel);
+
+/**
+ * Get free space in the output ring
+ * Callers producing bulk output use this to wait instead of losing data.
+ * @return Bytes that can be written without dropping
+ */
+uint32_t console_write_space(void);
+
+/**
+ * Get output statistics
+ * @param stats Pointer to store statistics
+ */
+void console_get_stats(console_stats_t *stats);
+
+/**
+ * Reset output statistics
+ */
+void console_reset_stats(void);
+
+#endif // CONSOLE_H
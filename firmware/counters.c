@@ -0,0 +1,39 @@
+/**
+ * Pipeline Counters Implementation
+ */
+
+#include "counters.h"
+#include <stddef.h>
+
+uint32_t counters_block[COUNTER_COUNT];
+
+static const char *const counter_names[COUNTER_COUNT] = {
+    [COUNTER_REPORTS_RECEIVED]  = "rx",
+    [COUNTER_REPORTS_DECODED]   = "rx_decoded",
+    [COUNTER_REPORTS_UNDECODED] = "rx_undecoded",
+    [COUNTER_REPORTS_DROPPED]   = "rx_dropped",
+    [COUNTER_REARM_FAILED]      = "rearm_failed",
+    [COUNTER_HID_SENT]          = "tx",
+    [COUNTER_HID_SUPPRESSED]    = "tx_suppressed",
+    [COUNTER_HID_DROPPED]       = "tx_dropped",
+    [COUNTER_HID_DISABLED]      = "tx_disabled",
+    [COUNTER_MACRO_STARTS]      = "macro_starts",
+    [COUNTER_MACRO_REJECTED]    = "macro_rejected",
+    [COUNTER_REPLY_DROPPED]     = "reply_dropped",
+};
+
+void counters_snapshot(counters_t *out, bool reset) {
+    if (!out) {
+        return;
+    }
+
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        out->values[i] = reset
+            ? __atomic_exchange_n(&counters_block[i], 0u, __ATOMIC_RELAXED)
+            : __atomic_load_n(&counters_block[i], __ATOMIC_RELAXED);
+    }
+}
+
+const char* counters_name(counter_id_t id) {
+    return (id < COUNTER_COUNT) ? counter_names[id] : "?";
+}
@@ -0,0 +1,73 @@
+/**
+ * Pipeline Counters
+ *
+ * One block of event counters that every stage of the input-to-output
+ * pipeline increments, so silent losses (short reports, full queues,
+ * overwritten reports, rejected macros) show up in the field through the
+ * STATS command. Counters are incremented atomically and may be bumped from
+ * either core; a snapshot reads each counter atomically, and a snapshot
+ * with reset clears each one in the same atomic step, so no event is lost
+ * between reading and clearing.
+ */
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    // Input (core 1)
+    COUNTER_REPORTS_RECEIVED,   // Input reports from a known device
+    COUNTER_REPORTS_DECODED,    // Reports turned into an input event
+    COUNTER_REPORTS_UNDECODED,  // Reports too short or without input fields
+    COUNTER_REPORTS_DROPPED,    // Input events lost to a full event ring
+    COUNTER_REARM_FAILED,       // tuh_hid_receive_report() refused; device goes quiet
+
+    // Output (core 0)
+    COUNTER_HID_SENT,           // HID reports handed to the endpoint
+    COUNTER_HID_SUPPRESSED,     // Reports identical to what the host has
+    COUNTER_HID_DROPPED,        // Pending reports overwritten before they were sent
+    COUNTER_HID_DISABLED,       // Reports for an output type that is not enabled
+
+    // Macros (core 0)
+    COUNTER_MACRO_STARTS,       // Macros started
+    COUNTER_MACRO_REJECTED,     // Starts refused (all slots busy, unknown ID)
+
+    // Command channel (core 0)
+    COUNTER_REPLY_DROPPED,      // Reply lines dropped because the CDC FIFO stayed full
+
+    COUNTER_COUNT
+} counter_id_t;
+
+// Counter values, indexed by counter_id_t
+typedef struct {
+    uint32_t values[COUNTER_COUNT];
+} counters_t;
+
+extern uint32_t counters_block[COUNTER_COUNT];
+
+/**
+ * Count one event
+ * Safe from either core and from interrupt handlers.
+ * @param id Counter
+ */
+static inline void counters_inc(counter_id_t id) {
+    __atomic_fetch_add(&counters_block[id], 1u, __ATOMIC_RELAXED);
+}
+
+/**
+ * Read all counters
+ * @param out Pointer to store the values
+ * @param reset true to clear each counter as it is read
+ */
+void counters_snapshot(counters_t *out, bool reset);
+
+/**
+ * Get the name of a counter (as used by the STATS command)
+ * @param id Counter
+ * @return Short lowercase name
+ */
+const char* counters_name(counter_id_t id);
+
+#endif // COUNTERS_H
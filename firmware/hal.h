@@ -0,0 +1,101 @@
+/**
+ * Hardware Abstraction Layer
+ *
+ * Platform services used by the portable firmware modules (time base,
+ * cycle counter, low-power waiting, the second core and flash storage).
+ * The firmware implements this on top of the Pico SDK (hal_pico.c); the
+ * host build provides a Linux stand-in (host/hal_host.c) so the input
+ * pipeline can run without a board.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Flash geometry (matches the RP2350 QSPI flash)
+#define HAL_FLASH_SECTOR_SIZE 4096u
+#define HAL_FLASH_PAGE_SIZE   256u
+
+/**
+ * Get time since boot in milliseconds
+ * @return Milliseconds since boot
+ */
+uint32_t hal_time_ms(void);
+
+/**
+ * Get time since boot in microseconds
+ * @return Microseconds since boot
+ */
+uint64_t hal_time_us(void);
+
+/**
+ * Read the free-running cycle counter of the calling core
+ * Use differences only; the counter wraps.
+ * @return Counter value in units of 1/hal_cycle_hz() seconds
+ */
+uint32_t hal_cycle_count(void);
+
+/**
+ * Get the cycle counter frequency
+ * @return Counter ticks per second
+ */
+uint32_t hal_cycle_hz(void);
+
+/**
+ * Set the wake-up event so a pending or following hal_wait_for_event
+ * returns immediately
+ * Safe to call from interrupt handlers and from either core.
+ */
+void hal_signal_event(void);
+
+/**
+ * Sleep until an interrupt, a signaled event or a deadline
+ * May return early; callers re-check their wake conditions.
+ * @param deadline_us Absolute wake-up time in us, or UINT64_MAX for none
+ */
+void hal_wait_for_event(uint64_t deadline_us);
+
+/**
+ * Start a function on the second core
+ * @param entry Function to run; it should not return
+ * @return true if started, false if the platform has no second core (the
+ *         caller then runs that work on the main core instead)
+ */
+bool hal_core1_launch(void (*entry)(void));
+
+/**
+ * Get total flash size
+ * @return Flash size in bytes
+ */
+uint32_t hal_flash_size(void);
+
+/**
+ * Get a read-only, memory-mapped view of flash
+ * @param offset Byte offset from the start of flash
+ * @return Pointer to flash contents at offset
+ */
+const uint8_t* hal_flash_read(uint32_t offset);
+
+/**
+ * Erase a range of flash
+ * Core 1 is paused while flash is busy.
+ * @param offset Byte offset (must be sector aligned)
+ * @param len Number of bytes (multiple of HAL_FLASH_SECTOR_SIZE)
+ * @return true on success, false on invalid range
+ */
+bool hal_flash_erase(uint32_t offset, uint32_t len);
+
+/**
+ * Program a previously erased range of flash
+ * Core 1 is paused while flash is busy.
+ * The final page is padded with 0xFF if len is not page aligned.
+ * @param offset Byte offset (must be page aligned)
+ * @param data Data to write
+ * @param len Number of bytes
+ * @return true on success, false on invalid range
+ */
+bool hal_flash_program(uint32_t offset, const void *data, uint32_t len);
+
+#endif // HAL_H
@@ -0,0 +1,130 @@
+/**
+ * Hardware Abstraction Layer - Pico SDK Implementation
+ */
+
+#include "hal.h"
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
+#if defined(__ARM_ARCH_8M_MAIN__)
+#include "hardware/structs/m33.h"
+#endif
+
+// Flash operation passed to flash_safe_execute
+typedef struct {
+    uint32_t offset;
+    const uint8_t *data;
+    uint32_t len;
+} flash_op_t;
+
+static void (*core1_entry)(void) = NULL;
+
+uint32_t hal_time_ms(void) {
+    return to_ms_since_boot(get_absolute_time());
+}
+
+uint64_t hal_time_us(void) {
+    return time_us_64();
+}
+
+uint32_t hal_cycle_count(void) {
+#if defined(__ARM_ARCH_8M_MAIN__)
+    // DWT cycle counter; each core has its own, enabled on first use
+    if (!(m33_hw->dwt_ctrl & M33_DWT_CTRL_CYCCNTENA_BITS)) {
+        m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+        m33_hw->dwt_cyccnt = 0;
+        m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+    }
+    return m33_hw->dwt_cyccnt;
+#else
+    return time_us_32();
+#endif
+}
+
+uint32_t hal_cycle_hz(void) {
+#if defined(__ARM_ARCH_8M_MAIN__)
+    return clock_get_hz(clk_sys);
+#else
+    return 1000000;
+#endif
+}
+
+void hal_signal_event(void) {
+    __sev();
+}
+
+void hal_wait_for_event(uint64_t deadline_us) {
+    if (deadline_us == UINT64_MAX) {
+        __wfe();
+    } else if (deadline_us > time_us_64()) {
+        // Arms a timer alarm so the WFE ends at the deadline
+        best_effort_wfe_or_timeout(from_us_since_boot(deadline_us));
+    }
+}
+
+/**
+ * Core 1 start-up: allow core 0 to pause this core around flash writes
+ */
+static void core1_trampoline(void) {
+    multicore_lockout_victim_init();
+    core1_entry();
+}
+
+bool hal_core1_launch(void (*entry)(void)) {
+    core1_entry = entry;
+    multicore_launch_core1(core1_trampoline);
+    return true;
+}
+
+uint32_t hal_flash_size(void) {
+    return PICO_FLASH_SIZE_BYTES;
+}
+
+const uint8_t* hal_flash_read(uint32_t offset) {
+    return (const uint8_t *)(XIP_BASE + offset);
+}
+
+static void flash_erase_locked(void *param) {
+    const flash_op_t *op = (const flash_op_t *)param;
+    flash_range_erase(op->offset, op->len);
+}
+
+static void flash_program_locked(void *param) {
+    const flash_op_t *op = (const flash_op_t *)param;
+
+    // flash_range_program only accepts whole pages
+    uint32_t full_len = op->len - (op->len % FLASH_PAGE_SIZE);
+    if (full_len > 0) {
+        flash_range_program(op->offset, op->data, full_len);
+    }
+    if (full_len < op->len) {
+        uint8_t page[FLASH_PAGE_SIZE];
+        memset(page, 0xFF, sizeof(page));
+        memcpy(page, op->data + full_len, op->len - full_len);
+        flash_range_program(op->offset + full_len, page, FLASH_PAGE_SIZE);
+    }
+}
+
+bool hal_flash_erase(uint32_t offset, uint32_t len) {
+    if ((offset % FLASH_SECTOR_SIZE) != 0 || (len % FLASH_SECTOR_SIZE) != 0 ||
+        offset + len > PICO_FLASH_SIZE_BYTES) {
+        return false;
+    }
+
+    // Runs with interrupts disabled and core 1 paused (it executes from flash)
+    flash_op_t op = {offset, NULL, len};
+    return flash_safe_execute(flash_erase_locked, &op, UINT32_MAX) == PICO_OK;
+}
+
+bool hal_flash_program(uint32_t offset, const void *data, uint32_t len) {
+    if ((offset % FLASH_PAGE_SIZE) != 0 || offset + len > PICO_FLASH_SIZE_BYTES) {
+        return false;
+    }
+
+    flash_op_t op = {offset, (const uint8_t *)data, len};
+    return flash_safe_execute(flash_program_locked, &op, UINT32_MAX) == PICO_OK;
+}
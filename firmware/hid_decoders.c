@@ -0,0 +1,128 @@
+/**
+ * Specialized HID Report Decoders Implementation
+ *
+ * Each decoder is straight-line code: fixed offsets, shifts and small
+ * lookup tables, with a single length/report ID check up front.
+ */
+
+#include "hid_decoders.h"
+
+// PlayStation report IDs and minimum lengths
+#define DS4_REPORT_ID         0x01
+#define DS4_REPORT_MIN_LEN    10
+#define DS_REPORT_ID          0x01
+#define DS_REPORT_MIN_LEN     11
+
+// Switch Pro standard full report
+#define SWITCH_REPORT_ID      0x30
+#define SWITCH_REPORT_MIN_LEN 12
+
+// PlayStation face buttons (Square, Cross, Circle, Triangle in bits 0-3)
+// to JC buttons by position
+static const uint8_t ps_face_buttons[16] = {
+    0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15
+};
+
+// Hat switch (0 = north, clockwise, 8-15 = centered) to d-pad
+static const int8_t hat_dpad_x[16] = {0, 1, 1, 1, 0, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+static const int8_t hat_dpad_y[16] = {-1, -1, 0, 1, 1, 1, 0, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+
+// Unsigned 8-bit axis (0-255, centered at 128) to int16
+static inline int16_t axis_u8(uint8_t value) {
+    return (int16_t)(value * 257 - 32768);
+}
+
+// Unsigned 12-bit axis (0-4095, centered at 2048) to int16
+static inline int16_t axis_u12(uint16_t value) {
+    return (int16_t)(((int32_t)value - 2048) * 16);
+}
+
+/**
+ * Decode the layout shared by DualShock 4 and DualSense
+ * @param sticks Offset of the left stick X byte
+ * @param triggers Offset of the L2 trigger byte
+ * @param buttons Offset of the hat/face button byte
+ */
+static inline void decode_playstation(const uint8_t *r, uint8_t sticks, uint8_t triggers,
+                                      uint8_t buttons, gamepad_state_t *state) {
+    uint8_t hat_face = r[buttons];
+    uint8_t shoulders = r[buttons + 1];
+    uint8_t system = r[buttons + 2];
+
+    state->left_x = axis_u8(r[sticks]);
+    state->left_y = axis_u8(r[sticks + 1]);
+    state->right_x = axis_u8(r[sticks + 2]);
+    state->right_y = axis_u8(r[sticks + 3]);
+    state->left_trigger = r[triggers];
+    state->right_trigger = r[triggers + 1];
+
+    // L1/R1 -> LB/RB, Share/Options -> BACK/START, L3/R3 -> LS/RS,
+    // PS/touchpad -> HOME/MISC (digital L2/R2 are covered by the triggers)
+    state->buttons = (uint16_t)(ps_face_buttons[hat_face >> 4] |
+                                ((shoulders & 0x03) << 4) |
+                                ((shoulders & 0xF0) << 2) |
+                                ((system & 0x03) << 10));
+
+    state->dpad_x = hat_dpad_x[hat_face & 0x0F];
+    state->dpad_y = hat_dpad_y[hat_face & 0x0F];
+}
+
+bool hid_decode_ds4(const uint8_t *report, uint16_t len, gamepad_state_t *state) {
+    if (len < DS4_REPORT_MIN_LEN || report[0] != DS4_REPORT_ID) {
+        return false;
+    }
+
+    // 1-4 sticks, 5 hat/face, 6 shoulders/menu, 7 PS/touchpad, 8-9 triggers
+    decode_playstation(report, 1, 8, 5, state);
+    return true;
+}
+
+bool hid_decode_dualsense(const uint8_t *report, uint16_t len, gamepad_state_t *state) {
+    if (len < DS_REPORT_MIN_LEN || report[0] != DS_REPORT_ID) {
+        return false;
+    }
+
+    // 1-4 sticks, 5-6 triggers, 8 hat/face, 9 shoulders/menu, 10 PS/touchpad
+    decode_playstation(report, 1, 5, 8, state);
+    return true;
+}
+
+bool hid_decode_switch_pro(const uint8_t *report, uint16_t len, gamepad_state_t *state) {
+    if (len < SWITCH_REPORT_MIN_LEN || report[0] != SWITCH_REPORT_ID) {
+        return false;
+    }
+
+    // 3: Y X B A SR SL R ZR, 4: - + RS LS Home Capture, 5: Down Up Right Left SR SL L ZL
+    uint8_t right = report[3];
+    uint8_t shared = report[4];
+    uint8_t left = report[5];
+
+    state->buttons = (uint16_t)(((right >> 2) & 0x03) |   // B, A -> A, B
+                                ((right & 0x03) << 2) |   // Y, X -> X, Y
+                                ((left & 0x40) >> 2) |    // L -> LB
+                                ((right & 0x40) >> 1) |   // R -> RB
+                                ((shared & 0x03) << 6) |  // -, + -> BACK, START
+                                ((shared & 0x08) << 5) |  // LS
+                                ((shared & 0x04) << 7) |  // RS
+                                ((shared & 0x30) << 6));  // Home, Capture -> HOME, MISC
+
+    // ZL/ZR are digital
+    state->left_trigger = (uint8_t)((left >> 7) * 255);
+    state->right_trigger = (uint8_t)((right >> 7) * 255);
+
+    state->dpad_x = (int8_t)(((left >> 2) & 1) - ((left >> 3) & 1));
+    state->dpad_y = (int8_t)((left & 1) - ((left >> 1) & 1));
+
+    // Packed 12-bit sticks; Nintendo Y grows upwards, HID Y downwards.
+    // Factory stick calibration is not applied.
+    uint16_t lx = (uint16_t)(report[6] | ((report[7] & 0x0F) << 8));
+    uint16_t ly = (uint16_t)((report[7] >> 4) | (report[8] << 4));
+    uint16_t rx = (uint16_t)(report[9] | ((report[10] & 0x0F) << 8));
+    uint16_t ry = (uint16_t)((report[10] >> 4) | (report[11] << 4));
+
+    state->left_x = axis_u12(lx);
+    state->left_y = axis_u12((uint16_t)(4095 - ly));
+    state->right_x = axis_u12(rx);
+    state->right_y = axis_u12((uint16_t)(4095 - ry));
+    return true;
+}
@@ -0,0 +1,44 @@
+/**
+ * Specialized HID Report Decoders
+ *
+ * Hand-written decoders for high-volume controllers. They map the vendor
+ * report layout straight into gamepad_state_t with fixed byte offsets and
+ * shifts, instead of going through the generic descriptor table.
+ *
+ * Face buttons are mapped by position: JC_BUTTON_A is the bottom button
+ * (Cross, Nintendo B), JC_BUTTON_B the right one, and so on.
+ */
+
+#ifndef HID_DECODERS_H
+#define HID_DECODERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "usb_host.h"
+
+/**
+ * Report decoder
+ * @param report Report data, starting with the report ID
+ * @param len Report length in bytes
+ * @param state Gamepad state to fill
+ * @return true if the report was decoded, false if it is not an input report
+ */
+typedef bool (*hid_decode_fn_t)(const uint8_t *report, uint16_t len, gamepad_state_t *state);
+
+/**
+ * DualShock 4 (USB report 0x01)
+ */
+bool hid_decode_ds4(const uint8_t *report, uint16_t len, gamepad_state_t *state);
+
+/**
+ * DualSense (USB report 0x01)
+ */
+bool hid_decode_dualsense(const uint8_t *report, uint16_t len, gamepad_state_t *state);
+
+/**
+ * Switch Pro Controller (standard full report 0x30)
+ * The controller only sends 0x30 reports once switched to full report mode.
+ */
+bool hid_decode_switch_pro(const uint8_t *report, uint16_t len, gamepad_state_t *state);
+
+#endif // HID_DECODERS_H
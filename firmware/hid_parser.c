@@ -0,0 +1,514 @@
+/**
+ * HID Report Descriptor Parser Implementation
+ */
+
+#include "hid_parser.h"
+#include <string.h>
+
+// HID usage pages
+#define HID_PAGE_GENERIC_DESKTOP 0x01
+#define HID_PAGE_SIMULATION      0x02
+#define HID_PAGE_BUTTON          0x09
+
+// Generic Desktop usages
+#define HID_USAGE_JOYSTICK   0x04
+#define HID_USAGE_GAMEPAD    0x05
+#define HID_USAGE_MULTI_AXIS 0x08
+#define HID_USAGE_X          0x30
+#define HID_USAGE_Y          0x31
+#define HID_USAGE_Z          0x32
+#define HID_USAGE_RX         0x33
+#define HID_USAGE_RY         0x34
+#define HID_USAGE_RZ         0x35
+#define HID_USAGE_HAT_SWITCH 0x39
+
+// Simulation usages
+#define HID_USAGE_ACCELERATOR 0xC4
+#define HID_USAGE_BRAKE       0xC5
+
+// Short item tags (prefix with the size bits masked off)
+#define HID_ITEM_INPUT          0x80
+#define HID_ITEM_OUTPUT         0x90
+#define HID_ITEM_FEATURE        0xB0
+#define HID_ITEM_COLLECTION     0xA0
+#define HID_ITEM_END_COLLECTION 0xC0
+#define HID_ITEM_USAGE_PAGE     0x04
+#define HID_ITEM_LOGICAL_MIN    0x14
+#define HID_ITEM_LOGICAL_MAX    0x24
+#define HID_ITEM_REPORT_SIZE    0x74
+#define HID_ITEM_REPORT_ID      0x84
+#define HID_ITEM_REPORT_COUNT   0x94
+#define HID_ITEM_PUSH           0xA4
+#define HID_ITEM_POP            0xB4
+#define HID_ITEM_USAGE          0x08
+#define HID_ITEM_USAGE_MIN      0x18
+#define HID_ITEM_USAGE_MAX      0x28
+#define HID_ITEM_LONG           0xFE
+
+// Main item data bits
+#define HID_MAIN_CONSTANT (1u << 0)
+#define HID_MAIN_VARIABLE (1u << 1)
+
+#define HID_COLLECTION_APPLICATION 0x01
+
+#define HID_PARSER_MAX_USAGES  16
+#define HID_PARSER_MAX_REPORTS 8
+#define HID_PARSER_STACK_DEPTH 4
+
+// Output ranges
+#define AXIS_OUT_MIN    (-32768)
+#define AXIS_OUT_MAX    32767
+#define TRIGGER_OUT_MAX 255
+
+// Global item state
+typedef struct {
+    uint16_t usage_page;
+    int32_t logical_min;
+    int32_t logical_max;
+    uint32_t logical_max_unsigned;  // For descriptors that omit the sign byte
+    uint8_t report_size;
+    uint8_t report_id;
+    uint16_t report_count;
+} hid_globals_t;
+
+// Local item state (reset after every main item)
+typedef struct {
+    uint32_t usages[HID_PARSER_MAX_USAGES];  // Page << 16 | id
+    uint8_t num_usages;
+    uint32_t usage_min;
+    uint32_t usage_max;
+    bool has_range;
+} hid_locals_t;
+
+// Running input bit offset per report ID
+typedef struct {
+    uint8_t id;
+    uint16_t bits;
+} hid_report_offset_t;
+
+typedef struct {
+    hid_globals_t globals;
+    hid_globals_t stack[HID_PARSER_STACK_DEPTH];
+    uint8_t stack_depth;
+    hid_locals_t locals;
+    hid_report_offset_t reports[HID_PARSER_MAX_REPORTS];
+    uint8_t num_reports;
+    int8_t collection_depth;
+    int8_t gamepad_depth;           // Depth of the open gamepad collection, -1 if none
+    uint8_t targets_seen;           // Bitmask of hid_target_t already compiled
+    hid_decoder_t *decoder;
+} hid_parse_state_t;
+
+// Hat switch position (0 = north, clockwise) to d-pad direction
+static const int8_t hat_dpad_x[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+static const int8_t hat_dpad_y[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+static int32_t sign_extend(uint32_t value, uint8_t bits) {
+    if (bits == 0 || bits >= 32) {
+        return (int32_t)value;
+    }
+    uint32_t sign = 1u << (bits - 1);
+    return (int32_t)((value ^ sign) - sign);
+}
+
+static uint16_t* report_bits(hid_parse_state_t *ps, uint8_t id) {
+    for (uint8_t i = 0; i < ps->num_reports; i++) {
+        if (ps->reports[i].id == id) {
+            return &ps->reports[i].bits;
+        }
+    }
+    if (ps->num_reports >= HID_PARSER_MAX_REPORTS) {
+        return NULL;
+    }
+
+    // Reports with an ID start with the ID byte
+    hid_report_offset_t *report = &ps->reports[ps->num_reports++];
+    report->id = id;
+    report->bits = id ? 8 : 0;
+    return &report->bits;
+}
+
+/**
+ * Map a usage to a field target
+ * @return Target, or -1 if the usage is not used by the converter
+ */
+static int usage_target(uint32_t usage) {
+    uint16_t page = (uint16_t)(usage >> 16);
+    uint16_t id = (uint16_t)usage;
+
+    if (page == HID_PAGE_BUTTON) {
+        return (id >= 1 && id <= 16) ? HID_TARGET_BUTTONS : -1;
+    }
+
+    if (page == HID_PAGE_GENERIC_DESKTOP) {
+        switch (id) {
+            case HID_USAGE_X:          return HID_TARGET_LEFT_X;
+            case HID_USAGE_Y:          return HID_TARGET_LEFT_Y;
+            case HID_USAGE_Z:          return HID_TARGET_RIGHT_X;
+            case HID_USAGE_RZ:         return HID_TARGET_RIGHT_Y;
+            case HID_USAGE_RX:         return HID_TARGET_LEFT_TRIGGER;
+            case HID_USAGE_RY:         return HID_TARGET_RIGHT_TRIGGER;
+            case HID_USAGE_HAT_SWITCH: return HID_TARGET_HAT;
+            default:                   return -1;
+        }
+    }
+
+    if (page == HID_PAGE_SIMULATION) {
+        switch (id) {
+            case HID_USAGE_BRAKE:       return HID_TARGET_LEFT_TRIGGER;
+            case HID_USAGE_ACCELERATOR: return HID_TARGET_RIGHT_TRIGGER;
+            default:                    return -1;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Add one variable input field to the decoder
+ */
+static void add_field(hid_parse_state_t *ps, uint32_t usage, uint16_t bit_offset) {
+    const hid_globals_t *g = &ps->globals;
+    hid_decoder_t *decoder = ps->decoder;
+
+    int target = usage_target(usage);
+    if (target < 0 || g->report_size == 0 || g->report_size > 32) {
+        return;
+    }
+
+    if (target == HID_TARGET_BUTTONS) {
+        uint8_t index = (uint8_t)((usage & 0xFFFF) - 1);
+
+        // Extend the previous button field when the bits are contiguous
+        if (decoder->num_fields > 0 && g->report_size == 1) {
+            hid_field_t *prev = &decoder->fields[decoder->num_fields - 1];
+            if (prev->target == HID_TARGET_BUTTONS && prev->report_id == g->report_id &&
+                prev->bit_offset + prev->bit_size == bit_offset &&
+                prev->shift + prev->bit_size == index) {
+                prev->bit_size++;
+                return;
+            }
+        }
+        if (g->report_size != 1) {
+            return;
+        }
+    } else if (ps->targets_seen & (1u << target)) {
+        // First field for an axis wins
+        return;
+    }
+
+    if (decoder->num_fields >= HID_PARSER_MAX_FIELDS) {
+        return;
+    }
+
+    int32_t lmin = g->logical_min;
+    int32_t lmax = g->logical_max;
+    if (lmax < lmin) {
+        lmax = (int32_t)g->logical_max_unsigned;
+    }
+    if (target != HID_TARGET_BUTTONS && lmax <= lmin) {
+        return;
+    }
+
+    hid_field_t *field = &decoder->fields[decoder->num_fields++];
+    memset(field, 0, sizeof(*field));
+    field->bit_offset = bit_offset;
+    field->bit_size = g->report_size;
+    field->flags = (lmin < 0) ? HID_FIELD_SIGNED : 0;
+    field->report_id = g->report_id;
+    field->target = (uint8_t)target;
+    field->logical_min = lmin;
+    field->logical_max = lmax;
+
+    if (target == HID_TARGET_BUTTONS) {
+        field->shift = (uint8_t)((usage & 0xFFFF) - 1);
+    } else if (target != HID_TARGET_HAT) {
+        uint32_t out_range = (target == HID_TARGET_LEFT_TRIGGER || target == HID_TARGET_RIGHT_TRIGGER) ?
+                             TRIGGER_OUT_MAX : (uint32_t)(AXIS_OUT_MAX - AXIS_OUT_MIN);
+        uint64_t scale = ((uint64_t)out_range << 16) / (uint64_t)((int64_t)lmax - lmin);
+        field->scale = scale > UINT32_MAX ? UINT32_MAX : (uint32_t)scale;
+    }
+
+    if (target != HID_TARGET_BUTTONS) {
+        ps->targets_seen |= (uint8_t)(1u << target);
+    }
+    if (g->report_id) {
+        decoder->uses_report_ids = true;
+    }
+}
+
+static void handle_input(hid_parse_state_t *ps, uint32_t flags) {
+    const hid_globals_t *g = &ps->globals;
+    const hid_locals_t *l = &ps->locals;
+
+    uint16_t *bits = report_bits(ps, g->report_id);
+    if (!bits) {
+        return;
+    }
+    uint16_t base = *bits;
+    *bits = (uint16_t)(base + g->report_size * g->report_count);
+
+    // Padding, array inputs and anything outside a gamepad collection
+    if ((flags & HID_MAIN_CONSTANT) || !(flags & HID_MAIN_VARIABLE) || ps->gamepad_depth < 0) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < g->report_count; i++) {
+        uint32_t usage;
+        if (l->num_usages > 0) {
+            usage = l->usages[i < l->num_usages ? i : l->num_usages - 1];
+        } else if (l->has_range) {
+            usage = l->usage_min + i;
+            if (usage > l->usage_max) {
+                break;
+            }
+        } else {
+            break;
+        }
+        add_field(ps, usage, (uint16_t)(base + i * g->report_size));
+    }
+}
+
+static void handle_collection(hid_parse_state_t *ps, uint32_t type) {
+    const hid_locals_t *l = &ps->locals;
+
+    if (type == HID_COLLECTION_APPLICATION && ps->gamepad_depth < 0) {
+        uint32_t usage = l->num_usages > 0 ? l->usages[0] : (l->has_range ? l->usage_min : 0);
+        uint16_t page = (uint16_t)(usage >> 16);
+        uint16_t id = (uint16_t)usage;
+        if (page == HID_PAGE_GENERIC_DESKTOP &&
+            (id == HID_USAGE_JOYSTICK || id == HID_USAGE_GAMEPAD || id == HID_USAGE_MULTI_AXIS)) {
+            ps->gamepad_depth = ps->collection_depth;
+        }
+    }
+    ps->collection_depth++;
+}
+
+static void handle_end_collection(hid_parse_state_t *ps) {
+    if (ps->collection_depth > 0) {
+        ps->collection_depth--;
+    }
+    if (ps->collection_depth == ps->gamepad_depth) {
+        ps->gamepad_depth = -1;
+    }
+}
+
+static uint32_t local_usage(const hid_parse_state_t *ps, uint32_t data, uint8_t size) {
+    // Four-byte usages carry their own page
+    return (size == 4) ? data : ((uint32_t)ps->globals.usage_page << 16) | (data & 0xFFFF);
+}
+
+bool hid_parser_compile(const uint8_t *desc, uint16_t len, hid_decoder_t *decoder) {
+    if (!decoder) {
+        return false;
+    }
+    memset(decoder, 0, sizeof(*decoder));
+    if (!desc || len == 0) {
+        return false;
+    }
+
+    hid_parse_state_t ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.gamepad_depth = -1;
+    ps.decoder = decoder;
+
+    uint16_t pos = 0;
+    while (pos < len) {
+        uint8_t prefix = desc[pos++];
+
+        if (prefix == HID_ITEM_LONG) {
+            // Long items carry no data this parser uses
+            if (pos + 1 >= len) {
+                break;
+            }
+            pos = (uint16_t)(pos + 2 + desc[pos]);
+            continue;
+        }
+
+        uint8_t size = prefix & 0x03;
+        if (size == 3) {
+            size = 4;
+        }
+        if (pos + size > len) {
+            break;
+        }
+
+        uint32_t data = 0;
+        for (uint8_t i = 0; i < size; i++) {
+            data |= (uint32_t)desc[pos + i] << (8 * i);
+        }
+        int32_t sdata = sign_extend(data, (uint8_t)(size * 8));
+        pos = (uint16_t)(pos + size);
+
+        hid_globals_t *g = &ps.globals;
+        hid_locals_t *l = &ps.locals;
+
+        switch (prefix & 0xFC) {
+            // Main items
+            case HID_ITEM_INPUT:
+                handle_input(&ps, data);
+                memset(l, 0, sizeof(*l));
+                break;
+            case HID_ITEM_OUTPUT:
+            case HID_ITEM_FEATURE:
+                memset(l, 0, sizeof(*l));
+                break;
+            case HID_ITEM_COLLECTION:
+                handle_collection(&ps, data);
+                memset(l, 0, sizeof(*l));
+                break;
+            case HID_ITEM_END_COLLECTION:
+                handle_end_collection(&ps);
+                memset(l, 0, sizeof(*l));
+                break;
+
+            // Global items
+            case HID_ITEM_USAGE_PAGE:
+                g->usage_page = (uint16_t)data;
+                break;
+            case HID_ITEM_LOGICAL_MIN:
+                g->logical_min = sdata;
+                break;
+            case HID_ITEM_LOGICAL_MAX:
+                g->logical_max = sdata;
+                g->logical_max_unsigned = data;
+                break;
+            case HID_ITEM_REPORT_SIZE:
+                g->report_size = (uint8_t)data;
+                break;
+            case HID_ITEM_REPORT_ID:
+                g->report_id = (uint8_t)data;
+                break;
+            case HID_ITEM_REPORT_COUNT:
+                g->report_count = (uint16_t)data;
+                break;
+            case HID_ITEM_PUSH:
+                if (ps.stack_depth < HID_PARSER_STACK_DEPTH) {
+                    ps.stack[ps.stack_depth++] = *g;
+                }
+                break;
+            case HID_ITEM_POP:
+                if (ps.stack_depth > 0) {
+                    *g = ps.stack[--ps.stack_depth];
+                }
+                break;
+
+            // Local items
+            case HID_ITEM_USAGE:
+                if (l->num_usages < HID_PARSER_MAX_USAGES) {
+                    l->usages[l->num_usages++] = local_usage(&ps, data, size);
+                }
+                break;
+            case HID_ITEM_USAGE_MIN:
+                l->usage_min = local_usage(&ps, data, size);
+                l->has_range = true;
+                break;
+            case HID_ITEM_USAGE_MAX:
+                l->usage_max = local_usage(&ps, data, size);
+                l->has_range = true;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return decoder->num_fields > 0;
+}
+
+static uint32_t extract_bits(const uint8_t *report, uint16_t offset, uint8_t size) {
+    const uint8_t *p = report + (offset >> 3);
+    uint8_t shift = offset & 7;
+    uint8_t nbytes = (uint8_t)((shift + size + 7) >> 3);
+
+    uint64_t value = 0;
+    for (uint8_t i = 0; i < nbytes; i++) {
+        value |= (uint64_t)p[i] << (8 * i);
+    }
+    value >>= shift;
+    return (size >= 32) ? (uint32_t)value : (uint32_t)value & ((1u << size) - 1);
+}
+
+static int32_t scale_value(const hid_field_t *field, int32_t value, int32_t out_min, int32_t out_max) {
+    if (value < field->logical_min) {
+        value = field->logical_min;
+    } else if (value > field->logical_max) {
+        value = field->logical_max;
+    }
+
+    int64_t out = out_min + (((int64_t)value - field->logical_min) * field->scale >> 16);
+    return out > out_max ? out_max : (int32_t)out;
+}
+
+bool hid_parser_decode(const hid_decoder_t *decoder, const uint8_t *report, uint16_t len,
+                       gamepad_state_t *state) {
+    if (!decoder || !report || !state || len == 0) {
+        return false;
+    }
+
+    uint8_t report_id = decoder->uses_report_ids ? report[0] : 0;
+    uint32_t report_bits_len = (uint32_t)len * 8;
+    bool matched = false;
+
+    // Decode into the previous state: a device that splits its inputs over
+    // several report IDs only updates the fields of the ID it just sent
+
+    for (uint8_t i = 0; i < decoder->num_fields; i++) {
+        const hid_field_t *field = &decoder->fields[i];
+        if (field->report_id != report_id ||
+            (uint32_t)field->bit_offset + field->bit_size > report_bits_len) {
+            continue;
+        }
+        matched = true;
+
+        uint32_t raw = extract_bits(report, field->bit_offset, field->bit_size);
+        int32_t value = (field->flags & HID_FIELD_SIGNED) ? sign_extend(raw, field->bit_size) : (int32_t)raw;
+
+        switch (field->target) {
+            case HID_TARGET_BUTTONS: {
+                // Button fields are at most 16 one-bit usages wide
+                uint32_t mask = ((1u << field->bit_size) - 1) << field->shift;
+                state->buttons = (uint16_t)((state->buttons & ~mask) | ((raw << field->shift) & mask));
+                break;
+            }
+            case HID_TARGET_LEFT_X:
+                state->left_x = (int16_t)scale_value(field, value, AXIS_OUT_MIN, AXIS_OUT_MAX);
+                break;
+            case HID_TARGET_LEFT_Y:
+                state->left_y = (int16_t)scale_value(field, value, AXIS_OUT_MIN, AXIS_OUT_MAX);
+                break;
+            case HID_TARGET_RIGHT_X:
+                state->right_x = (int16_t)scale_value(field, value, AXIS_OUT_MIN, AXIS_OUT_MAX);
+                break;
+            case HID_TARGET_RIGHT_Y:
+                state->right_y = (int16_t)scale_value(field, value, AXIS_OUT_MIN, AXIS_OUT_MAX);
+                break;
+            case HID_TARGET_LEFT_TRIGGER:
+                state->left_trigger = (uint8_t)scale_value(field, value, 0, TRIGGER_OUT_MAX);
+                break;
+            case HID_TARGET_RIGHT_TRIGGER:
+                state->right_trigger = (uint8_t)scale_value(field, value, 0, TRIGGER_OUT_MAX);
+                break;
+            case HID_TARGET_HAT: {
+                // Values outside the logical range mean "centered"
+                state->dpad_x = 0;
+                state->dpad_y = 0;
+                int32_t position = value - field->logical_min;
+                if (position >= 0 && value <= field->logical_max) {
+                    if (field->logical_max - field->logical_min == 3) {
+                        position *= 2;  // Four-way hat
+                    }
+                    if (position < 8) {
+                        state->dpad_x = hat_dpad_x[position];
+                        state->dpad_y = hat_dpad_y[position];
+                    }
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return matched;
+}
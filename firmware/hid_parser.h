@@ -0,0 +1,79 @@
+/**
+ * HID Report Descriptor Parser
+ *
+ * Compiles a HID report descriptor once, at mount time, into a compact
+ * table of the input fields the converter uses (buttons, sticks, triggers
+ * and hat switch). Reports are then decoded by a single pass over that
+ * table, without walking the descriptor again.
+ */
+
+#ifndef HID_PARSER_H
+#define HID_PARSER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "usb_host.h"
+
+// Maximum number of compiled fields per device
+#define HID_PARSER_MAX_FIELDS 24
+
+// Field targets in gamepad_state_t
+typedef enum {
+    HID_TARGET_BUTTONS,        // Packed button bits
+    HID_TARGET_LEFT_X,
+    HID_TARGET_LEFT_Y,
+    HID_TARGET_RIGHT_X,
+    HID_TARGET_RIGHT_Y,
+    HID_TARGET_LEFT_TRIGGER,
+    HID_TARGET_RIGHT_TRIGGER,
+    HID_TARGET_HAT             // Hat switch -> dpad_x/dpad_y
+} hid_target_t;
+
+// Field flags
+#define HID_FIELD_SIGNED (1u << 0)  // Sign-extend the raw value
+
+// Compiled input field
+typedef struct {
+    uint16_t bit_offset;  // Offset in the report, including the report ID byte
+    uint8_t bit_size;     // 1-32 bits
+    uint8_t flags;        // HID_FIELD_*
+    uint8_t report_id;    // 0 if the device does not use report IDs
+    uint8_t target;       // hid_target_t
+    uint8_t shift;        // Buttons: index of the first button bit
+    int32_t logical_min;  // Logical range of the raw value
+    int32_t logical_max;
+    uint32_t scale;       // Axes/triggers: 16.16 factor from logical to output range
+} hid_field_t;
+
+// Compiled decoder for one device
+typedef struct {
+    hid_field_t fields[HID_PARSER_MAX_FIELDS];
+    uint8_t num_fields;
+    bool uses_report_ids;
+} hid_decoder_t;
+
+/**
+ * Compile a report descriptor
+ * Only fields inside a Joystick, Gamepad or Multi-axis application
+ * collection are used.
+ * @param desc Report descriptor
+ * @param len Descriptor length in bytes
+ * @param decoder Decoder to fill
+ * @return true if at least one usable field was found
+ */
+bool hid_parser_compile(const uint8_t *desc, uint16_t len, hid_decoder_t *decoder);
+
+/**
+ * Decode an input report with a compiled decoder
+ * Only the fields compiled for the report's ID are written; the rest of
+ * state keeps its previous value, so pass the last decoded state.
+ * @param decoder Compiled decoder
+ * @param report Report data (starting with the report ID if used)
+ * @param len Report length in bytes
+ * @param state Gamepad state to fill
+ * @return true if the report carried at least one compiled field
+ */
+bool hid_parser_decode(const hid_decoder_t *decoder, const uint8_t *report, uint16_t len,
+                       gamepad_state_t *state);
+
+#endif // HID_PARSER_H
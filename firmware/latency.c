@@ -0,0 +1,101 @@
+/**
+ * Input-to-Output Latency Measurement Implementation
+ */
+
+#include "latency.h"
+#include <string.h>
+
+static uint32_t buckets[LATENCY_BUCKETS];
+static uint32_t sample_count = 0;
+static uint32_t min_us = UINT32_MAX;
+static uint32_t max_us = 0;
+static uint64_t total_us = 0;
+
+static uint8_t bucket_index(uint32_t us) {
+    if (us < 2) {
+        return 0;
+    }
+    uint8_t index = (uint8_t)(31 - __builtin_clz(us));
+    return index < LATENCY_BUCKETS ? index : LATENCY_BUCKETS - 1;
+}
+
+void latency_record(uint64_t input_us, uint64_t now_us) {
+    if (input_us == 0 || now_us < input_us) {
+        return;
+    }
+
+    uint64_t elapsed = now_us - input_us;
+    uint32_t us = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+
+    buckets[bucket_index(us)]++;
+    sample_count++;
+    total_us += us;
+    if (us < min_us) {
+        min_us = us;
+    }
+    if (us > max_us) {
+        max_us = us;
+    }
+}
+
+/**
+ * Estimate a percentile by linear interpolation inside its bucket
+ * @param per_mille Percentile in 1/1000 (500 = median)
+ */
+static uint32_t percentile(uint32_t per_mille) {
+    // Rank of the sample, 1-based
+    uint32_t rank = (uint32_t)(((uint64_t)sample_count * per_mille + 999) / 1000);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint32_t below = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        if (below + buckets[i] < rank) {
+            below += buckets[i];
+            continue;
+        }
+
+        // Bucket range, narrowed to the samples actually seen
+        uint32_t low = (i == 0) ? 0 : (1u << i);
+        uint32_t high = (i == LATENCY_BUCKETS - 1) ? max_us : (2u << i) - 1;
+        if (low < min_us) {
+            low = min_us;
+        }
+        if (high > max_us) {
+            high = max_us;
+        }
+        if (high <= low) {
+            return low;
+        }
+        return low + (uint32_t)((uint64_t)(high - low) * (rank - below - 1) / buckets[i]);
+    }
+    return max_us;
+}
+
+void latency_get_stats(latency_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    memcpy(stats->buckets, buckets, sizeof(buckets));
+    stats->count = sample_count;
+    if (sample_count == 0) {
+        return;
+    }
+
+    stats->min_us = min_us;
+    stats->max_us = max_us;
+    stats->avg_us = (uint32_t)(total_us / sample_count);
+    stats->p50_us = percentile(500);
+    stats->p99_us = percentile(990);
+}
+
+void latency_reset_stats(void) {
+    memset(buckets, 0, sizeof(buckets));
+    sample_count = 0;
+    min_us = UINT32_MAX;
+    max_us = 0;
+    total_us = 0;
+}
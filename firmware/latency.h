@@ -0,0 +1,49 @@
+/**
+ * Input-to-Output Latency Measurement
+ *
+ * Collects the time from receiving an input report (tuh_hid_report_received_cb)
+ * to the completed transmission of the HID IN report it caused
+ * (tud_hid_report_complete_cb) in a log2 histogram: bucket 0 counts
+ * samples below 2 us, bucket n counts samples in [2^n, 2^(n+1)) us and the
+ * last bucket everything above. Percentiles are interpolated within their
+ * bucket, so they are estimates; min and max are exact.
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+// 2^20 us (about one second) and above share the last bucket
+#define LATENCY_BUCKETS 21
+
+// Latency summary
+typedef struct {
+    uint32_t count;                     // Samples recorded
+    uint32_t min_us;                    // Smallest sample (0 if none)
+    uint32_t max_us;                    // Largest sample
+    uint32_t avg_us;                    // Mean
+    uint32_t p50_us;                    // Median (estimate)
+    uint32_t p99_us;                    // 99th percentile (estimate)
+    uint32_t buckets[LATENCY_BUCKETS];  // Histogram
+} latency_stats_t;
+
+/**
+ * Record one input-to-output latency sample
+ * @param input_us When the input report was received
+ * @param now_us When its output report completed
+ */
+void latency_record(uint64_t input_us, uint64_t now_us);
+
+/**
+ * Get the latency summary
+ * @param stats Pointer to store statistics
+ */
+void latency_get_stats(latency_stats_t *stats);
+
+/**
+ * Clear all samples
+ */
+void latency_reset_stats(void);
+
+#endif // LATENCY_H
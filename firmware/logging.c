@@ -1,19 +1,43 @@
 /**
  * Logging Module Implementation
- * 
+ *
  * Ring buffer based logging system for device debugging.
+ *
+ * Entries are stored in binary: timestamp, level, the format string
+ * pointer and the raw argument values. Text is only produced when the
+ * logs are read out, so logging on the hot path costs a format scan and
+ * a few stores instead of a snprintf/vsnprintf pair.
+ *
+ * Record layout in the ring (byte-packed, may wrap):
+ *   [length:1][level:1][timestamp_ms:4][format:sizeof(char *)][arguments]
+ *
+ * Head and tail are free-running byte positions, masked on access. Whole
+ * records are dropped from the tail to make room, so the tail always
+ * points at a record header and log_count is exact.
  */
 
 #include "logging.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
-#include "pico/stdlib.h"
+#include <stddef.h>
+#include "hal.h"
+
+#if (LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) != 0
+#error "LOG_BUFFER_SIZE must be a power of two"
+#endif
+
+#define LOG_BUFFER_MASK (LOG_BUFFER_SIZE - 1)
+
+// Record header size and maximum argument payload
+#define LOG_RECORD_HEADER (2 + sizeof(uint32_t) + sizeof(const char *))
+#define LOG_MAX_ARG_BYTES 48
+#define LOG_RECORD_MAX    (LOG_RECORD_HEADER + LOG_MAX_ARG_BYTES)
 
 // Ring buffer for log storage
-static char log_buffer[LOG_BUFFER_SIZE];
-static uint16_t log_head = 0;  // Write position
-static uint16_t log_tail = 0;  // Read position
+static uint8_t log_buffer[LOG_BUFFER_SIZE];
+static uint32_t log_head = 0;  // Write position (free-running)
+static uint32_t log_tail = 0;  // Oldest record (free-running)
 static uint16_t log_count = 0; // Number of entries
 static bool log_overflow = false;
 static log_level_t current_log_level = LOG_LEVEL_DEBUG;
@@ -26,6 +50,101 @@ static const char *level_names[] = {
     "ERROR"
 };
 
+// Argument classes, decided by the conversion and length modifier
+typedef enum {
+    ARG_NONE,
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_PTR,
+    ARG_DOUBLE
+} arg_class_t;
+
+/**
+ * Parse one conversion specification
+ * @param p Points just past the '%'
+ * @param cls Set to the argument class (ARG_NONE for "%%")
+ * @return Pointer to the conversion character, or to the terminator
+ */
+static const char* parse_spec(const char *p, arg_class_t *cls) {
+    int longs = 0;
+
+    // Flags, width and precision ('*' is not supported)
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '.' ||
+           (*p >= '0' && *p <= '9')) {
+        p++;
+    }
+
+    // Length modifiers (h/hh promote to int, size_t/ptrdiff_t are long-sized)
+    while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 't' || *p == 'j') {
+        if (*p == 'l' || *p == 'z' || *p == 't') {
+            longs++;
+        } else if (*p == 'j') {
+            longs = 2;
+        }
+        p++;
+    }
+
+    switch (*p) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            *cls = longs >= 2 ? ARG_LLONG : (longs == 1 ? ARG_LONG : ARG_INT);
+            break;
+        case 's': case 'p':
+            *cls = ARG_PTR;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            *cls = ARG_DOUBLE;
+            break;
+        default:
+            *cls = ARG_NONE;
+            break;
+    }
+    return p;
+}
+
+// Storage size of an argument class
+static size_t arg_size(arg_class_t cls) {
+    switch (cls) {
+        case ARG_INT:    return sizeof(int);
+        case ARG_LONG:   return sizeof(long);
+        case ARG_LLONG:  return sizeof(long long);
+        case ARG_PTR:    return sizeof(const void *);
+        case ARG_DOUBLE: return sizeof(double);
+        default:         return 0;
+    }
+}
+
+/**
+ * Copy bytes into the ring at pos, wrapping as needed
+ */
+static void ring_write(uint32_t pos, const void *data, size_t len) {
+    size_t offset = pos & LOG_BUFFER_MASK;
+    size_t first = LOG_BUFFER_SIZE - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(&log_buffer[offset], data, first);
+    memcpy(log_buffer, (const uint8_t *)data + first, len - first);
+}
+
+/**
+ * Copy bytes out of the ring starting at pos, wrapping as needed
+ */
+static void ring_read(uint32_t pos, void *data, size_t len) {
+    size_t offset = pos & LOG_BUFFER_MASK;
+    size_t first = LOG_BUFFER_SIZE - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(data, &log_buffer[offset], first);
+    memcpy((uint8_t *)data + first, log_buffer, len - first);
+}
+
+// Length of the record at pos
+static inline uint8_t record_length(uint32_t pos) {
+    return log_buffer[pos & LOG_BUFFER_MASK];
+}
+
 void logging_init(void) {
     log_head = 0;
     log_tail = 0;
@@ -37,66 +156,198 @@ void logging_init(void) {
 
 void logging_log(log_level_t level, const char *format, ...) {
     // Check log level filter
-    if (level < current_log_level) {
+    if (level < current_log_level || !format) {
         return;
     }
-    
+
     // Validate level - ensure it's within bounds for level_names array
     if (level > LOG_LEVEL_ERROR) {
         level = LOG_LEVEL_ERROR;
     }
-    
-    // Format the log entry
-    char entry[LOG_ENTRY_MAX_LEN];
-    uint32_t timestamp = to_ms_since_boot(get_absolute_time());
-    
-    // Create header with timestamp and level (level is guaranteed valid here)
-    int header_len = snprintf(entry, sizeof(entry), "[%lu][%s] ", 
-                              (unsigned long)timestamp, level_names[level]);
-    
-    if (header_len < 0 || (size_t)header_len >= sizeof(entry)) {
-        return;
-    }
-    
-    // Format user message
-    va_list args;
-    va_start(args, format);
-    int msg_len = vsnprintf(entry + header_len, sizeof(entry) - header_len - 1, format, args);
-    va_end(args);
-    
-    if (msg_len < 0) {
-        return;
+
+    // Build the record; arguments are captured in format order
+    uint8_t record[LOG_RECORD_MAX];
+    uint8_t *args = &record[LOG_RECORD_HEADER];
+    size_t args_len = 0;
+
+    va_list ap;
+    va_start(ap, format);
+    for (const char *p = format; *p; p++) {
+        if (*p != '%') {
+            continue;
+        }
+
+        arg_class_t cls;
+        p = parse_spec(p + 1, &cls);
+        if (*p == '\0') {
+            break;
+        }
+
+        size_t size = arg_size(cls);
+        if (args_len + size > LOG_MAX_ARG_BYTES) {
+            break;  // Remaining arguments are dropped from the entry
+        }
+
+        switch (cls) {
+            case ARG_INT: {
+                int v = va_arg(ap, int);
+                memcpy(&args[args_len], &v, size);
+                break;
+            }
+            case ARG_LONG: {
+                long v = va_arg(ap, long);
+                memcpy(&args[args_len], &v, size);
+                break;
+            }
+            case ARG_LLONG: {
+                long long v = va_arg(ap, long long);
+                memcpy(&args[args_len], &v, size);
+                break;
+            }
+            case ARG_PTR: {
+                const void *v = va_arg(ap, const void *);
+                memcpy(&args[args_len], &v, size);
+                break;
+            }
+            case ARG_DOUBLE: {
+                double v = va_arg(ap, double);
+                memcpy(&args[args_len], &v, size);
+                break;
+            }
+            default:
+                break;
+        }
+        args_len += size;
     }
-    
-    // Calculate total length (cap to max entry length - 1 for newline)
-    size_t total_len = (size_t)header_len + (size_t)msg_len;
-    if (total_len >= sizeof(entry) - 1) {
-        total_len = sizeof(entry) - 2;
+    va_end(ap);
+
+    uint8_t record_len = (uint8_t)(LOG_RECORD_HEADER + args_len);
+    uint32_t timestamp = hal_time_ms();
+    record[0] = record_len;
+    record[1] = (uint8_t)level;
+    memcpy(&record[2], &timestamp, sizeof(timestamp));
+    memcpy(&record[2 + sizeof(timestamp)], &format, sizeof(format));
+
+    // Drop whole records from the tail until the new one fits
+    while (LOG_BUFFER_SIZE - (log_head - log_tail) < record_len) {
+        log_tail += record_length(log_tail);
+        log_count--;
+        log_overflow = true;
     }
-    
-    // Add newline
-    entry[total_len] = '\n';
-    entry[total_len + 1] = '\0';
-    total_len++;
-    
-    // Write to ring buffer
-    for (size_t i = 0; i < total_len; i++) {
-        log_buffer[log_head] = entry[i];
-        log_head = (log_head + 1) % LOG_BUFFER_SIZE;
-        
-        // Check for overflow
-        if (log_head == log_tail) {
-            // Buffer full, advance tail to make room
-            log_tail = (log_tail + 1) % LOG_BUFFER_SIZE;
-            log_overflow = true;
-            // Decrement count since we're losing an entry
-            if (log_count > 0) {
-                log_count--;
+
+    ring_write(log_head, record, record_len);
+    log_head += record_len;
+    log_count++;
+}
+
+/**
+ * Format one stored entry as "[timestamp][LEVEL] message\n"
+ * @param pos Ring position of the record
+ * @param out Output buffer (at least LOG_ENTRY_MAX_LEN bytes)
+ * @return Length of the formatted entry
+ */
+static size_t format_entry(uint32_t pos, char *out) {
+    uint8_t record[LOG_RECORD_MAX];
+    uint32_t timestamp;
+    const char *format;
+
+    ring_read(pos, record, record_length(pos));
+    memcpy(&timestamp, &record[2], sizeof(timestamp));
+    memcpy(&format, &record[2 + sizeof(timestamp)], sizeof(format));
+    const uint8_t *args = &record[LOG_RECORD_HEADER];
+    size_t args_len = record[0] - LOG_RECORD_HEADER;
+
+    const size_t cap = LOG_ENTRY_MAX_LEN - 1;  // Room for the newline
+    int n = snprintf(out, cap, "[%lu][%s] ", (unsigned long)timestamp,
+                     level_names[record[1] & 3]);
+    size_t len = (n > 0) ? (size_t)n : 0;
+    size_t arg_pos = 0;
+
+    // Rebuild the message one conversion at a time
+    for (const char *p = format; *p && len < cap - 1; p++) {
+        if (*p != '%') {
+            out[len++] = *p;
+            continue;
+        }
+
+        arg_class_t cls;
+        const char *start = p;
+        p = parse_spec(p + 1, &cls);
+        if (*p == '\0') {
+            break;
+        }
+        if (*p == '%') {
+            out[len++] = '%';
+            continue;
+        }
+
+        size_t size = arg_size(cls);
+        if (cls == ARG_NONE || arg_pos + size > args_len) {
+            break;  // Argument was not captured
+        }
+
+        char spec[16];
+        size_t spec_len = (size_t)(p - start) + 1;
+        if (spec_len >= sizeof(spec)) {
+            break;
+        }
+        memcpy(spec, start, spec_len);
+        spec[spec_len] = '\0';
+
+        const uint8_t *arg = &args[arg_pos];
+        arg_pos += size;
+
+        switch (cls) {
+            case ARG_INT: {
+                int v;
+                memcpy(&v, arg, sizeof(v));
+                n = snprintf(out + len, cap - len, spec, v);
+                break;
+            }
+            case ARG_LONG: {
+                long v;
+                memcpy(&v, arg, sizeof(v));
+                n = snprintf(out + len, cap - len, spec, v);
+                break;
+            }
+            case ARG_LLONG: {
+                long long v;
+                memcpy(&v, arg, sizeof(v));
+                n = snprintf(out + len, cap - len, spec, v);
+                break;
+            }
+            case ARG_PTR: {
+                const void *v;
+                memcpy(&v, arg, sizeof(v));
+                if (*p == 's') {
+                    n = snprintf(out + len, cap - len, spec, v ? (const char *)v : "(null)");
+                } else {
+                    n = snprintf(out + len, cap - len, spec, v);
+                }
+                break;
+            }
+            case ARG_DOUBLE: {
+                double v;
+                memcpy(&v, arg, sizeof(v));
+                n = snprintf(out + len, cap - len, spec, v);
+                break;
+            }
+            default:
+                n = 0;
+                break;
+        }
+
+        if (n > 0) {
+            len += (size_t)n;
+            if (len > cap - 1) {
+                len = cap - 1;
             }
         }
     }
-    
-    log_count++;
+
+    out[len++] = '\n';
+    out[len] = '\0';
+    return len;
 }
 
 void logging_set_level(log_level_t level) {
@@ -110,20 +361,54 @@ log_level_t logging_get_level(void) {
     return current_log_level;
 }
 
+void logging_cursor_init(log_cursor_t *cursor) {
+    cursor->pos = log_tail;
+    cursor->end = log_head;
+    cursor->offset = 0;
+}
+
+uint16_t logging_read(log_cursor_t *cursor, char *buffer, uint16_t buffer_size) {
+    uint16_t bytes_written = 0;
+    char entry[LOG_ENTRY_MAX_LEN];
+
+    // Entries overwritten since the last call are skipped; finish the
+    // interrupted line so the output stays line-oriented
+    if ((int32_t)(cursor->pos - log_tail) < 0) {
+        cursor->pos = log_tail;
+        if (cursor->offset > 0 && buffer_size > 0) {
+            buffer[bytes_written++] = '\n';
+        }
+        cursor->offset = 0;
+    }
+
+    while (bytes_written < buffer_size && (int32_t)(cursor->end - cursor->pos) > 0) {
+        size_t len = format_entry(cursor->pos, entry);
+        size_t chunk = len - cursor->offset;
+        if (chunk > (size_t)(buffer_size - bytes_written)) {
+            chunk = buffer_size - bytes_written;
+        }
+
+        memcpy(buffer + bytes_written, entry + cursor->offset, chunk);
+        bytes_written += (uint16_t)chunk;
+        cursor->offset += (uint8_t)chunk;
+
+        if (cursor->offset >= len) {
+            cursor->pos += record_length(cursor->pos);
+            cursor->offset = 0;
+        }
+    }
+
+    return bytes_written;
+}
+
 uint16_t logging_get_logs(char *buffer, uint16_t buffer_size) {
     if (!buffer || buffer_size == 0) {
         return 0;
     }
-    
-    uint16_t bytes_written = 0;
-    uint16_t read_pos = log_tail;
-    
-    // Copy all data from tail to head
-    while (read_pos != log_head && bytes_written < buffer_size - 1) {
-        buffer[bytes_written++] = log_buffer[read_pos];
-        read_pos = (read_pos + 1) % LOG_BUFFER_SIZE;
-    }
-    
+
+    log_cursor_t cursor;
+    logging_cursor_init(&cursor);
+    uint16_t bytes_written = logging_read(&cursor, buffer, buffer_size - 1);
     buffer[bytes_written] = '\0';
     return bytes_written;
 }
@@ -133,11 +418,10 @@ uint16_t logging_get_count(void) {
 }
 
 void logging_clear(void) {
-    log_head = 0;
-    log_tail = 0;
+    // Keep positions running so open cursors see the entries as dropped
+    log_tail = log_head;
     log_count = 0;
     log_overflow = false;
-    memset(log_buffer, 0, LOG_BUFFER_SIZE);
 }
 
 bool logging_has_overflow(void) {
@@ -3,6 +3,7 @@
  * 
  * Provides logging functionality with ring buffer storage.
  * Logs can be uploaded to the PC configuration tool for debugging.
+ * Entries are kept in binary form and formatted on readout.
  */
 
 #ifndef LOGGING_H
@@ -11,10 +12,10 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-// Maximum size of log buffer (in bytes)
+// Maximum size of log buffer (in bytes, binary entries, power of two)
 #define LOG_BUFFER_SIZE 4096
 
-// Maximum length of a single log entry
+// Maximum length of a single formatted log entry
 #define LOG_ENTRY_MAX_LEN 128
 
 // Log levels
@@ -32,6 +33,10 @@ void logging_init(void);
 
 /**
  * Log a message at the specified level
+ * Only the format pointer and argument values are stored; the text is
+ * formatted when the logs are read. The format string and any %s
+ * arguments must therefore stay valid (string literals or constant
+ * tables). '*' widths are not supported.
  * @param level Log level
  * @param format Printf-style format string
  * @param ... Format arguments
@@ -58,6 +63,30 @@ void logging_set_level(log_level_t level);
  */
 log_level_t logging_get_level(void);
 
+// Read position for streaming the log out in chunks
+typedef struct {
+    uint32_t pos;     // Ring position of the next entry
+    uint32_t end;     // Ring position where the dump stops
+    uint8_t offset;   // Bytes of the next entry already returned
+} log_cursor_t;
+
+/**
+ * Start a dump of every entry currently in the log
+ * Entries logged afterwards are not part of the dump.
+ * @param cursor Cursor to initialize
+ */
+void logging_cursor_init(log_cursor_t *cursor);
+
+/**
+ * Format the next part of a dump, resuming where the last call stopped
+ * Entries overwritten while the dump is in progress are skipped.
+ * @param cursor Dump cursor
+ * @param buffer Output buffer (not NUL-terminated)
+ * @param buffer_size Size of output buffer
+ * @return Number of bytes written, 0 when the dump is complete
+ */
+uint16_t logging_read(log_cursor_t *cursor, char *buffer, uint16_t buffer_size);
+
 /**
  * Get all logs as a formatted string
  * Caller must provide buffer for output
@@ -3,182 +3,711 @@
  */
 
 #include "macro.h"
-#include "usb_device.h"
-#include <stdio.h>
+#include "output.h"
+#include "sched.h"
+#include "trace.h"
 #include <string.h>
-#include "pico/stdlib.h"
+#include "hal.h"
+#include "counters.h"
+#include "macro_store.h"
 
-static macro_t macros[MAX_MACROS];
-static uint8_t num_macros = 0;
+// Maximum keys a macro can hold down at once
+#define MACRO_MAX_HELD_KEYS 6
 
-// Macro execution state
-static struct {
-    bool executing;
-    uint8_t current_macro_id;
-    uint8_t current_step;
-    uint32_t step_start_time;
-} macro_state = {0};
+// Instructions one slot may run without reaching a delay before it yields
+// until the next frame (keeps a loop without delays from stalling the core)
+#define MACRO_OPS_PER_RUN 64
 
-void macro_init(void) {
-    printf("Macro: Initializing\n");
-    num_macros = 0;
-    memset(macros, 0, sizeof(macros));
-    memset(&macro_state, 0, sizeof(macro_state));
+// Longest varint operand: 21 bits covers every delay and int16 move
+#define MACRO_VARINT_MAX 3
+
+// One open LOOP
+typedef struct {
+    uint16_t start;      // First instruction of the loop body
+    uint8_t remaining;   // Passes left, including the current one
+} macro_loop_t;
+
+// A mouse glide in progress (positions relative to its start)
+typedef struct {
+    bool active;
+    bool curved;        // Bezier through (cx, cy), else a straight line
+    uint8_t ease;       // macro_ease_t
+    int16_t cx, cy;
+    int16_t dx, dy;
+    int32_t sent_x;     // Position reached by the moves output so far
+    int32_t sent_y;
+    uint64_t start_us;
+    uint32_t duration_us;
+    uint64_t next_us;   // Next step
+} macro_glide_t;
+
+// Execution state of one running macro
+typedef struct {
+    bool active;
+    bool trigger_held;                       // Trigger button still down
+    bool waiting;                            // Paused in WAIT_RELEASE
+    uint8_t macro_id;
+    uint16_t trigger_button;                 // Input button that started it
+    uint16_t pc;                             // Next instruction
+    uint8_t loop_depth;
+    macro_loop_t loops[MACRO_LOOP_DEPTH];
+    uint64_t next_us;                        // When that instruction is due
+    uint64_t trigger_us;                     // Input that started it, until the first delay
+    uint8_t held_keys[MACRO_MAX_HELD_KEYS];  // Keys pressed by this macro
+    uint8_t num_held_keys;
+    uint8_t held_mouse_buttons;              // Mouse buttons pressed by this macro
+    macro_glide_t glide;
+} macro_slot_t;
+
+static macro_slot_t slots[MACRO_SLOTS];
+static macro_stats_t stats = {0};
+
+// Keys and mouse buttons changed by the instructions of one run of a slot
+typedef struct {
+    uint8_t keys[MACRO_MAX_HELD_KEYS * 2];
+    uint8_t num_keys;
+    uint8_t mouse_buttons;
+} macro_batch_t;
+
+// Fixed operand bytes and varint operands of each opcode
+static const uint8_t op_fixed_bytes[MACRO_OP_COUNT] = {
+    [MACRO_OP_KEY_DOWN]     = 1,
+    [MACRO_OP_KEY_UP]       = 1,
+    [MACRO_OP_BUTTON_DOWN]  = 1,
+    [MACRO_OP_BUTTON_UP]    = 1,
+    [MACRO_OP_LOOP]         = 1,
+    [MACRO_OP_JUMP_IF_HELD] = 2,
+    [MACRO_OP_MOUSE_PATH]   = 1,
+    [MACRO_OP_MOUSE_CURVE]  = 1,
+};
+static const uint8_t op_varints[MACRO_OP_COUNT] = {
+    [MACRO_OP_MOUSE_MOVE] = 2,
+    [MACRO_OP_DELAY]      = 1,
+    [MACRO_OP_DELAY_US]   = 1,
+    [MACRO_OP_MOUSE_PATH]  = 3,
+    [MACRO_OP_MOUSE_CURVE] = 5,
+};
+
+static uint32_t get_varint(const uint8_t **p) {
+    uint32_t value = 0;
+    for (uint8_t shift = 0; shift < 7 * MACRO_VARINT_MAX; shift += 7) {
+        uint8_t byte = *(*p)++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return value;
 }
 
-bool macro_execute(uint8_t macro_id) {
-    macro_t *macro = macro_get(macro_id);
-    if (!macro) {
-        printf("Macro: Macro %d not found\n", macro_id);
-        return false;
+static int16_t get_zigzag(const uint8_t **p) {
+    uint32_t value = get_varint(p);
+    int32_t delta = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    if (delta > INT16_MAX) {
+        return INT16_MAX;
+    }
+    return delta < INT16_MIN ? INT16_MIN : (int16_t)delta;
+}
+
+/**
+ * Get the size of the instruction at pc
+ * @return Size in bytes, or 0 for an unknown opcode or a truncated operand
+ */
+static uint16_t insn_size(const uint8_t *code, uint16_t pc, uint16_t len) {
+    uint8_t op = code[pc];
+    if (op >= MACRO_OP_COUNT) {
+        return 0;
     }
     
-    if (macro_state.executing) {
-        printf("Macro: Already executing macro %d, ignoring request for %d\n", 
-               macro_state.current_macro_id, macro_id);
+    uint16_t end = (uint16_t)(pc + 1 + op_fixed_bytes[op]);
+    for (uint8_t v = 0; v < op_varints[op]; v++) {
+        uint8_t bytes = 0;
+        do {
+            if (end >= len || ++bytes > MACRO_VARINT_MAX) {
+                return 0;
+            }
+        } while (code[end++] & 0x80);
+    }
+    return end <= len ? (uint16_t)(end - pc) : 0;
+}
+
+/**
+ * Check that LOOP/NEXT pair up within [from, to), so a jump across that
+ * range stays in the same loop body
+ */
+static bool same_loop_body(const uint8_t *code, uint16_t from, uint16_t to) {
+    int depth = 0;
+    for (uint16_t pc = from; pc < to; pc = (uint16_t)(pc + insn_size(code, pc, to))) {
+        if (code[pc] == MACRO_OP_LOOP) {
+            depth++;
+        } else if (code[pc] == MACRO_OP_NEXT && --depth < 0) {
+            return false;
+        }
+    }
+    return depth == 0;
+}
+
+bool macro_validate(const uint8_t *code, uint16_t len) {
+    if (!code || len == 0 || len > MACRO_MAX_SIZE) {
         return false;
     }
     
-    printf("Macro: Executing macro %d with %d steps\n", macro_id, macro->num_steps);
+    // Instruction boundaries, for checking jump targets
+    uint8_t starts[MACRO_MAX_SIZE / 8] = {0};
+    uint8_t depth = 0;
     
-    macro_state.executing = true;
-    macro_state.current_macro_id = macro_id;
-    macro_state.current_step = 0;
-    macro_state.step_start_time = to_ms_since_boot(get_absolute_time());
+    for (uint16_t pc = 0; pc < len; ) {
+        uint16_t size = insn_size(code, pc, len);
+        if (size == 0) {
+            return false;
+        }
+        starts[pc >> 3] |= (uint8_t)(1u << (pc & 7));
+        
+        if (code[pc] == MACRO_OP_LOOP) {
+            if (code[pc + 1] == 0 || depth >= MACRO_LOOP_DEPTH) {
+                return false;
+            }
+            depth++;
+        } else if (code[pc] == MACRO_OP_NEXT) {
+            if (depth == 0) {
+                return false;
+            }
+            depth--;
+        } else if (code[pc] == MACRO_OP_MOUSE_PATH || code[pc] == MACRO_OP_MOUSE_CURVE) {
+            if (code[pc + 1] >= MACRO_EASE_COUNT) {
+                return false;
+            }
+        }
+        pc = (uint16_t)(pc + size);
+    }
+    if (depth != 0) {
+        return false;
+    }
     
+    for (uint16_t pc = 0; pc < len; pc = (uint16_t)(pc + insn_size(code, pc, len))) {
+        if (code[pc] != MACRO_OP_JUMP_IF_HELD) {
+            continue;
+        }
+        
+        uint16_t target = (uint16_t)(code[pc + 1] | (code[pc + 2] << 8));
+        if (target >= len || !(starts[target >> 3] & (1u << (target & 7)))) {
+            return false;
+        }
+        if (!same_loop_body(code, target < pc ? target : pc, target < pc ? pc : target)) {
+            return false;
+        }
+    }
     return true;
 }
 
-void macro_task(void) {
-    if (!macro_state.executing) {
+/**
+ * Press a key on behalf of a macro
+ */
+static void macro_press_key(macro_slot_t *slot, macro_batch_t *batch, uint8_t keycode) {
+    if (keycode == 0 || slot->num_held_keys >= MACRO_MAX_HELD_KEYS) {
         return;
     }
+    output_key_press(keycode);
+    slot->held_keys[slot->num_held_keys++] = keycode;
+    if (batch->num_keys < sizeof(batch->keys)) {
+        batch->keys[batch->num_keys++] = keycode;
+    }
+}
+
+/**
+ * Release a key held by a macro
+ * @param keycode Key to release, or 0 to release all held keys
+ */
+static void macro_release_key(macro_slot_t *slot, macro_batch_t *batch, uint8_t keycode) {
+    for (int i = slot->num_held_keys - 1; i >= 0; i--) {
+        if (keycode != 0 && slot->held_keys[i] != keycode) {
+            continue;
+        }
+        
+        output_key_release(slot->held_keys[i]);
+        if (batch->num_keys < sizeof(batch->keys)) {
+            batch->keys[batch->num_keys++] = slot->held_keys[i];
+        }
+        memmove(&slot->held_keys[i], &slot->held_keys[i + 1],
+                slot->num_held_keys - i - 1);
+        slot->num_held_keys--;
+        
+        if (keycode != 0) {
+            break;
+        }
+    }
+}
+
+/**
+ * Press or release mouse buttons on behalf of a macro
+ * @param buttons Button mask; 0 on release means all held buttons
+ */
+static void macro_mouse_buttons(macro_slot_t *slot, macro_batch_t *batch,
+                                uint8_t buttons, bool pressed) {
+    if (pressed) {
+        uint8_t newly_pressed = buttons & (uint8_t)~slot->held_mouse_buttons;
+        output_mouse_button(newly_pressed, true);
+        slot->held_mouse_buttons |= newly_pressed;
+        batch->mouse_buttons |= newly_pressed;
+    } else {
+        uint8_t released = (buttons ? buttons : 0xFF) & slot->held_mouse_buttons;
+        output_mouse_button(released, false);
+        slot->held_mouse_buttons &= (uint8_t)~released;
+        batch->mouse_buttons |= released;
+    }
+}
+
+/**
+ * Check if an instruction would undo a change of the same run
+ * Both would land in one report and the first change would never be seen
+ * (a tap that is pressed and released, or released and pressed again).
+ * @param operands Operand bytes of the instruction
+ */
+static bool macro_undoes_batch(uint8_t op, const uint8_t *operands, const macro_batch_t *batch) {
+    // An operand of 0 releases everything, but presses nothing
+    bool all = operands[0] == 0 && (op == MACRO_OP_KEY_UP || op == MACRO_OP_BUTTON_UP);
     
-    macro_t *macro = macro_get(macro_state.current_macro_id);
-    if (!macro || macro_state.current_step >= macro->num_steps) {
-        // Macro finished or invalid
-        macro_state.executing = false;
-        printf("Macro: Execution complete\n");
-        return;
+    if (op == MACRO_OP_KEY_DOWN || op == MACRO_OP_KEY_UP) {
+        for (uint8_t i = 0; i < batch->num_keys; i++) {
+            if (all || batch->keys[i] == operands[0]) {
+                return true;
+            }
+        }
+    } else if (op == MACRO_OP_BUTTON_DOWN || op == MACRO_OP_BUTTON_UP) {
+        return ((all ? 0xFF : operands[0]) & batch->mouse_buttons) != 0;
+    }
+    return false;
+}
+
+/**
+ * Apply an easing curve
+ * @param t Progress, 0 to 65536
+ * @return Eased progress, 0 to 65536
+ */
+static uint32_t glide_ease(uint8_t ease, uint32_t t) {
+    uint64_t u = 65536u - t;
+    switch (ease) {
+        case MACRO_EASE_IN:
+            return (uint32_t)(((uint64_t)t * t) >> 16);
+        case MACRO_EASE_OUT:
+            return (uint32_t)(65536u - ((u * u) >> 16));
+        case MACRO_EASE_IN_OUT:
+            // Smoothstep: 3t^2 - 2t^3
+            return (uint32_t)(((uint64_t)t * t * (3u * 65536u - 2u * t)) >> 32);
+        default:
+            return t;
+    }
+}
+
+/**
+ * Get a coordinate of the glide at progress s (0 to 65536), rounded
+ */
+static int32_t glide_point(const macro_glide_t *glide, int16_t c, int16_t d, uint32_t s) {
+    int64_t q32;  // Position in 1/2^32 counts
+    if (glide->curved) {
+        // Quadratic Bezier from 0 through c to d: 2(1-s)s c + s^2 d
+        q32 = 2 * (int64_t)(65536u - s) * s * c + (int64_t)s * s * d;
+    } else {
+        q32 = (int64_t)d * s * 65536;
+    }
+    return (int32_t)((q32 + ((int64_t)1 << 31)) >> 32);
+}
+
+/**
+ * Move the cursor to where the glide should be at `now`
+ * The step is measured from the position already reached, so the rounding
+ * of one step is made up by the next.
+ */
+static void glide_step(macro_glide_t *glide, uint64_t now) {
+    uint64_t end_us = glide->start_us + glide->duration_us;
+    uint32_t s = 65536;
+    if (now < end_us) {
+        uint64_t elapsed = now > glide->start_us ? now - glide->start_us : 0;
+        s = glide_ease(glide->ease, (uint32_t)((elapsed << 16) / glide->duration_us));
+    }
+    
+    int32_t x = glide_point(glide, glide->cx, glide->dx, s);
+    int32_t y = glide_point(glide, glide->cy, glide->dy, s);
+    if (x != glide->sent_x || y != glide->sent_y) {
+        output_mouse_move((int16_t)(x - glide->sent_x), (int16_t)(y - glide->sent_y), 0);
+        glide->sent_x = x;
+        glide->sent_y = y;
+    }
+    
+    if (now >= end_us) {
+        glide->active = false;
+    } else {
+        // One step per output frame, and one exactly at the end
+        glide->next_us = now + OUTPUT_FRAME_US < end_us ? now + OUTPUT_FRAME_US : end_us;
+    }
+}
+
+/**
+ * Start a glide from a MOUSE_PATH / MOUSE_CURVE instruction
+ * @param p Operands, advanced past them
+ * @param start_us Time the glide starts on the slot's timeline
+ */
+static void glide_start(macro_slot_t *slot, uint8_t op, const uint8_t **p, uint64_t start_us) {
+    macro_glide_t *glide = &slot->glide;
+    if (glide->active) {
+        // Finish the previous glide where it was headed
+        glide_step(glide, UINT64_MAX);
+    }
+    
+    memset(glide, 0, sizeof(*glide));
+    glide->ease = *(*p)++;
+    glide->curved = op == MACRO_OP_MOUSE_CURVE;
+    if (glide->curved) {
+        glide->cx = get_zigzag(p);
+        glide->cy = get_zigzag(p);
     }
+    glide->dx = get_zigzag(p);
+    glide->dy = get_zigzag(p);
+    glide->duration_us = get_varint(p) * 1000u;
+    glide->start_us = start_us;
+    glide->active = true;
+    glide_step(glide, start_us);
     
-    macro_step_t *step = &macro->steps[macro_state.current_step];
-    uint32_t now = to_ms_since_boot(get_absolute_time());
+    TRACE_DEBUG("Macro: Glide (%d, %d) over %lu us", glide->dx, glide->dy,
+                (unsigned long)glide->duration_us);
+}
+
+/**
+ * Release everything a slot holds and free it
+ */
+static void macro_finish(macro_slot_t *slot) {
+    macro_batch_t batch = {0};
+    macro_release_key(slot, &batch, 0);
+    macro_mouse_buttons(slot, &batch, 0, false);
+    slot->glide.active = false;
+    slot->active = false;
+}
+
+void macro_init(void) {
+    TRACE_INFO("Macro: Initializing");
+    macro_store_init();
+    memset(slots, 0, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool macro_execute(uint8_t macro_id, uint16_t trigger_button) {
+    if (!macro_get(macro_id, NULL)) {
+        TRACE_WARN("Macro: Macro %d not found", macro_id);
+        counters_inc(COUNTER_MACRO_REJECTED);
+        return false;
+    }
     
-    // Execute current step
-    switch (step->action) {
-        case MACRO_ACTION_KEY_PRESS: {
-            uint8_t keycode = (uint8_t)step->param1;
-            usb_device_send_keyboard(0, &keycode, 1);
-            printf("Macro: Key press 0x%02X\n", keycode);
-            macro_state.current_step++;
-            macro_state.step_start_time = now;
+    macro_slot_t *slot = NULL;
+    for (uint8_t i = 0; i < MACRO_SLOTS; i++) {
+        if (!slots[i].active) {
+            slot = &slots[i];
             break;
         }
-        
-        case MACRO_ACTION_KEY_RELEASE: {
-            usb_device_send_keyboard(0, NULL, 0);
-            printf("Macro: Key release\n");
-            macro_state.current_step++;
-            macro_state.step_start_time = now;
-            break;
+    }
+    if (!slot) {
+        TRACE_WARN("Macro: All %d slots busy, ignoring request for %d", MACRO_SLOTS, macro_id);
+        counters_inc(COUNTER_MACRO_REJECTED);
+        return false;
+    }
+    
+    TRACE_INFO("Macro: Executing macro %d in slot %d", macro_id, (int)(slot - slots));
+    
+    counters_inc(COUNTER_MACRO_STARTS);
+    memset(slot, 0, sizeof(*slot));
+    slot->active = true;
+    slot->macro_id = macro_id;
+    slot->trigger_button = trigger_button;
+    slot->trigger_held = trigger_button != MACRO_NO_TRIGGER;
+    slot->next_us = hal_time_us();
+    slot->trigger_us = output_get_input_time();
+    sched_signal(SCHED_EVENT_MACRO);
+    
+    return true;
+}
+
+void macro_trigger_released(uint16_t button) {
+    for (uint8_t i = 0; i < MACRO_SLOTS; i++) {
+        macro_slot_t *slot = &slots[i];
+        if (!slot->active || !(slot->trigger_button & button)) {
+            continue;
         }
         
-        case MACRO_ACTION_MOUSE_MOVE: {
-            int8_t x = (int8_t)step->param2;
-            int8_t y = (int8_t)step->param3;
-            usb_device_send_mouse(0, x, y, 0);
-            printf("Macro: Mouse move (%d, %d)\n", x, y);
-            macro_state.current_step++;
-            macro_state.step_start_time = now;
-            break;
+        slot->trigger_held = false;
+        if (slot->waiting) {
+            // WAIT_RELEASE: carry on from the release
+            slot->waiting = false;
+            slot->next_us = hal_time_us();
+            sched_signal(SCHED_EVENT_MACRO);
         }
+    }
+}
+
+bool macro_is_executing(void) {
+    return macro_running_slots() != 0;
+}
+
+uint8_t macro_running_slots(void) {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < MACRO_SLOTS; i++) {
+        if (slots[i].active) {
+            mask |= (uint8_t)(1u << i);
+        }
+    }
+    return mask;
+}
+
+void macro_stop(uint8_t slot_mask) {
+    for (uint8_t i = 0; i < MACRO_SLOTS; i++) {
+        if ((slot_mask & (1u << i)) && slots[i].active) {
+            macro_finish(&slots[i]);
+            TRACE_DEBUG("Macro: Stopped macro %d in slot %d", slots[i].macro_id, i);
+        }
+    }
+}
+
+/**
+ * Stop every running instance of a macro (before its code changes)
+ */
+static void macro_stop_id(uint8_t macro_id) {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < MACRO_SLOTS; i++) {
+        if (slots[i].active && slots[i].macro_id == macro_id) {
+            mask |= (uint8_t)(1u << i);
+        }
+    }
+    macro_stop(mask);
+}
+
+uint64_t macro_next_deadline_us(void) {
+    uint64_t next = UINT64_MAX;
+    for (uint8_t i = 0; i < MACRO_SLOTS; i++) {
+        if (!slots[i].active) {
+            continue;
+        }
+        if (slots[i].next_us < next) {
+            next = slots[i].next_us;
+        }
+        if (slots[i].glide.active && slots[i].glide.next_us < next) {
+            next = slots[i].glide.next_us;
+        }
+    }
+    return next;
+}
+
+/**
+ * Interpret the due instructions of a slot, up to its next delay
+ * Instructions without a delay between them change the output together and
+ * go out in one report. A delay moves the slot's time on by exactly the
+ * authored amount, so late runs catch up instead of stretching the macro.
+ * @param now Current time in us
+ */
+static void macro_run_slot(macro_slot_t *slot, uint64_t now) {
+    uint16_t len;
+    const uint8_t *code = macro_get(slot->macro_id, &len);
+    if (!code) {
+        macro_finish(slot);
+        return;
+    }
+    
+    stats.runs++;
+    macro_batch_t batch = {0};
+    
+    // Instructions up to the first delay are output of the triggering input
+    output_set_input_time(slot->trigger_us);
+    
+    for (uint8_t budget = MACRO_OPS_PER_RUN; ; budget--) {
+        uint8_t op = slot->pc < len ? code[slot->pc] : MACRO_OP_END;
         
-        case MACRO_ACTION_MOUSE_BUTTON_PRESS: {
-            uint8_t buttons = (uint8_t)step->param1;
-            usb_device_send_mouse(buttons, 0, 0, 0);
-            printf("Macro: Mouse button press 0x%02X\n", buttons);
-            macro_state.current_step++;
-            macro_state.step_start_time = now;
+        if (op == MACRO_OP_END) {
+            // Finish now, or one frame later if that would hide this run's changes
+            if (slot->glide.active) {
+                // After the glide's last step (macro_task runs that first)
+                slot->next_us = slot->glide.start_us + slot->glide.duration_us;
+            } else if (batch.num_keys == 0 && batch.mouse_buttons == 0) {
+                macro_finish(slot);
+                TRACE_INFO("Macro: Execution of macro %d complete", slot->macro_id);
+            } else {
+                slot->next_us = now + OUTPUT_FRAME_US;
+            }
             break;
         }
-        
-        case MACRO_ACTION_MOUSE_BUTTON_RELEASE: {
-            usb_device_send_mouse(0, 0, 0, 0);
-            printf("Macro: Mouse button release\n");
-            macro_state.current_step++;
-            macro_state.step_start_time = now;
+        const uint8_t *p = &code[slot->pc + 1];
+        if (budget == 0 || macro_undoes_batch(op, p, &batch)) {
+            // Let this run's output go out in its own report first
+            slot->next_us = now + OUTPUT_FRAME_US;
             break;
         }
         
-        case MACRO_ACTION_DELAY: {
-            uint32_t delay_ms = step->param1;
-            if (now - macro_state.step_start_time >= delay_ms) {
-                printf("Macro: Delay %d ms complete\n", delay_ms);
-                macro_state.current_step++;
-                macro_state.step_start_time = now;
+        bool yield = false;
+        stats.ops++;
+        
+        switch (op) {
+            case MACRO_OP_KEY_DOWN:
+                macro_press_key(slot, &batch, *p);
+                TRACE_DEBUG("Macro: Key press 0x%02X", *p);
+                p++;
+                break;
+            
+            case MACRO_OP_KEY_UP:
+                macro_release_key(slot, &batch, *p++);
+                TRACE_DEBUG("Macro: Key release");
+                break;
+            
+            case MACRO_OP_MOUSE_MOVE: {
+                int16_t x = get_zigzag(&p);
+                int16_t y = get_zigzag(&p);
+                output_mouse_move(x, y, 0);
+                TRACE_DEBUG("Macro: Mouse move (%d, %d)", x, y);
+                break;
             }
-            break;
+            
+            case MACRO_OP_BUTTON_DOWN:
+                macro_mouse_buttons(slot, &batch, *p, true);
+                TRACE_DEBUG("Macro: Mouse button press 0x%02X", *p);
+                p++;
+                break;
+            
+            case MACRO_OP_BUTTON_UP:
+                macro_mouse_buttons(slot, &batch, *p++, false);
+                TRACE_DEBUG("Macro: Mouse button release");
+                break;
+            
+            case MACRO_OP_DELAY:
+            case MACRO_OP_DELAY_US: {
+                uint32_t delay = get_varint(&p);
+                if (delay > 0) {
+                    slot->next_us += op == MACRO_OP_DELAY ? (uint64_t)delay * 1000u : delay;
+                    slot->trigger_us = 0;
+                    yield = true;
+                    TRACE_DEBUG("Macro: Delay %lu %s", (unsigned long)delay,
+                                op == MACRO_OP_DELAY ? "ms" : "us");
+                }
+                break;
+            }
+            
+            case MACRO_OP_MOUSE_PATH:
+            case MACRO_OP_MOUSE_CURVE:
+                glide_start(slot, op, &p, slot->next_us);
+                break;
+            
+            case MACRO_OP_LOOP: {
+                // Validation keeps the nesting within MACRO_LOOP_DEPTH
+                macro_loop_t *loop = &slot->loops[slot->loop_depth++];
+                loop->remaining = *p++;
+                loop->start = (uint16_t)(p - code);
+                break;
+            }
+            
+            case MACRO_OP_NEXT: {
+                macro_loop_t *loop = &slot->loops[slot->loop_depth - 1];
+                if (--loop->remaining > 0) {
+                    p = &code[loop->start];
+                } else {
+                    slot->loop_depth--;
+                }
+                break;
+            }
+            
+            case MACRO_OP_JUMP_IF_HELD: {
+                uint16_t target = (uint16_t)(p[0] | (p[1] << 8));
+                p += 2;
+                if (slot->trigger_held) {
+                    p = &code[target];
+                }
+                break;
+            }
+            
+            case MACRO_OP_WAIT_RELEASE:
+                if (slot->trigger_held) {
+                    // macro_trigger_released() wakes the slot
+                    slot->waiting = true;
+                    slot->next_us = UINT64_MAX;
+                    slot->trigger_us = 0;
+                    yield = true;
+                }
+                break;
+            
+            default:
+                break;
         }
         
-        default:
-            printf("Macro: Unknown action %d\n", step->action);
-            macro_state.current_step++;
+        slot->pc = (uint16_t)(p - code);
+        if (yield) {
             break;
+        }
     }
+    
+    output_set_input_time(0);
 }
 
-bool macro_add(const macro_t *macro) {
-    if (num_macros >= MAX_MACROS) {
-        printf("Macro: Macro table full\n");
+void macro_task(void) {
+    uint64_t now = hal_time_us();
+    
+    for (uint8_t i = 0; i < MACRO_SLOTS; i++) {
+        if (slots[i].active && slots[i].glide.active && slots[i].glide.next_us <= now) {
+            glide_step(&slots[i].glide, now);
+        }
+        if (slots[i].active && slots[i].next_us <= now) {
+            macro_run_slot(&slots[i], now);
+        }
+    }
+}
+
+void macro_get_stats(macro_stats_t *out) {
+    if (out) {
+        *out = stats;
+    }
+}
+
+void macro_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool macro_add(uint8_t macro_id, const uint8_t *code, uint16_t len) {
+    if (!macro_validate(code, len)) {
+        TRACE_WARN("Macro: Invalid bytecode for macro %d", macro_id);
         return false;
     }
     
-    // Check if macro with this ID already exists
-    for (uint8_t i = 0; i < num_macros; i++) {
-        if (macros[i].id == macro->id) {
-            // Replace existing macro
-            memcpy(&macros[i], macro, sizeof(macro_t));
-            printf("Macro: Updated macro %d\n", macro->id);
-            return true;
-        }
+    // Leave the flash alone when nothing changes
+    uint16_t stored_len;
+    const uint8_t *stored = macro_store_get(macro_id, &stored_len);
+    if (stored && stored_len == len && memcmp(stored, code, len) == 0) {
+        return true;
+    }
+    
+    macro_stop_id(macro_id);
+    if (!macro_store_put(macro_id, code, len)) {
+        return false;
     }
     
-    // Add new macro
-    memcpy(&macros[num_macros], macro, sizeof(macro_t));
-    num_macros++;
-    printf("Macro: Added macro %d with %d steps\n", macro->id, macro->num_steps);
+    TRACE_INFO("Macro: %s macro %d with %d bytes", stored ? "Updated" : "Added", macro_id, len);
     return true;
 }
 
 bool macro_remove(uint8_t macro_id) {
-    for (uint8_t i = 0; i < num_macros; i++) {
-        if (macros[i].id == macro_id) {
-            // Shift remaining macros down
-            for (uint8_t j = i; j < num_macros - 1; j++) {
-                memcpy(&macros[j], &macros[j + 1], sizeof(macro_t));
-            }
-            num_macros--;
-            printf("Macro: Removed macro %d\n", macro_id);
-            return true;
-        }
+    if (!macro_store_get(macro_id, NULL)) {
+        TRACE_WARN("Macro: Macro %d not found", macro_id);
+        return false;
     }
     
-    printf("Macro: Macro %d not found\n", macro_id);
-    return false;
+    macro_stop_id(macro_id);
+    if (!macro_store_put(macro_id, NULL, 0)) {
+        return false;
+    }
+    TRACE_INFO("Macro: Removed macro %d", macro_id);
+    return true;
 }
 
-macro_t* macro_get(uint8_t macro_id) {
-    for (uint8_t i = 0; i < num_macros; i++) {
-        if (macros[i].id == macro_id) {
-            return &macros[i];
-        }
-    }
-    return NULL;
+const uint8_t* macro_get(uint8_t macro_id, uint16_t *len) {
+    return macro_store_get(macro_id, len);
 }
 
-void macro_clear_all(void) {
-    num_macros = 0;
-    memset(macros, 0, sizeof(macros));
-    printf("Macro: Cleared all macros\n");
+bool macro_clear_all(void) {
+    macro_stop((uint8_t)((1u << MACRO_SLOTS) - 1));
+    if (!macro_store_clear()) {
+        return false;
+    }
+    TRACE_INFO("Macro: Cleared all macros");
+    return true;
 }
@@ -1,7 +1,12 @@
 /**
  * Macro System
  * 
- * Handles complex mouse and keyboard macros.
+ * Handles complex mouse and keyboard macros. Macros are variable-length
+ * bytecode (MACRO_OP_*) kept in flash (macro_store.h) and run in place by a
+ * small interpreter. Up to MACRO_SLOTS macros play back at the same time, each in
+ * its own execution slot. Step times are kept in microseconds on the
+ * authored timeline (trigger time plus the delays so far), and all
+ * instructions between two delays go out in one output report.
  */
 
 #ifndef MACRO_H
@@ -11,32 +16,72 @@
 #include <stdint.h>
 
 #define MAX_MACROS 16
-#define MAX_MACRO_STEPS 128
+#define MACRO_MAX_SIZE 2048    // Largest single macro in bytes
+#define MACRO_SLOTS 4          // Macros that can run at once
+#define MACRO_LOOP_DEPTH 4     // Nested LOOP levels
 
-// Macro action types
+/*
+ * Macro bytecode
+ *
+ * A macro is a sequence of instructions: one opcode byte followed by its
+ * operands. Varints are unsigned LEB128; signed values are zigzag-encoded
+ * first (0, -1, 1, -2, ... become 0, 1, 2, 3, ...), so small moves take one
+ * byte. Jump targets are u16 little-endian offsets from the start of the
+ * macro. Code past the last instruction counts as MACRO_OP_END.
+ *
+ * Example, rapid fire while the trigger button is held:
+ *   0: KEY_DOWN 0x04   2: DELAY 30   4: KEY_UP 0x04   6: DELAY 30
+ *   8: JUMP_IF_HELD 0
+ */
 typedef enum {
-    MACRO_ACTION_KEY_PRESS,
-    MACRO_ACTION_KEY_RELEASE,
-    MACRO_ACTION_MOUSE_MOVE,
-    MACRO_ACTION_MOUSE_BUTTON_PRESS,
-    MACRO_ACTION_MOUSE_BUTTON_RELEASE,
-    MACRO_ACTION_DELAY
-} macro_action_type_t;
-
-// Macro step
-typedef struct {
-    macro_action_type_t action;
-    uint16_t param1;  // Key code, mouse button, or delay ms
-    int16_t param2;   // Mouse X or 0
-    int16_t param3;   // Mouse Y or 0
-} macro_step_t;
+    MACRO_OP_END = 0x00,       // Stop, releasing everything still held
+    MACRO_OP_KEY_DOWN,         // u8 keycode
+    MACRO_OP_KEY_UP,           // u8 keycode (0 = all keys the macro holds)
+    MACRO_OP_MOUSE_MOVE,       // zigzag varint dx, zigzag varint dy
+    MACRO_OP_BUTTON_DOWN,      // u8 mouse button mask
+    MACRO_OP_BUTTON_UP,        // u8 mouse button mask (0 = all the macro holds)
+    MACRO_OP_DELAY,            // varint ms
+    MACRO_OP_LOOP,             // u8 count (1-255): run up to the matching NEXT count times
+    MACRO_OP_NEXT,             // End of the innermost LOOP body
+    MACRO_OP_JUMP_IF_HELD,     // u16 target: jump while the trigger button is held
+    MACRO_OP_WAIT_RELEASE,     // Pause until the trigger button is released
+    MACRO_OP_DELAY_US,         // varint us (recorded macros keep exact gaps)
+    MACRO_OP_MOUSE_PATH,       // u8 easing, zigzag varint dx, dy, varint ms: straight glide
+    MACRO_OP_MOUSE_CURVE,      // u8 easing, zigzag varint cx, cy, dx, dy, varint ms: Bezier glide
+    MACRO_OP_COUNT
+} macro_op_t;
+
+/*
+ * Mouse glides
+ *
+ * MOUSE_PATH and MOUSE_CURVE move the cursor by (dx, dy) over the given
+ * time, one step per output frame, instead of in one report. MOUSE_CURVE
+ * bends the path as a quadratic Bezier curve towards the control point
+ * (cx, cy); both points are relative to where the glide starts. Each step
+ * moves to the rounded position on the path, so rounding never adds up and
+ * the glide ends exactly at (dx, dy).
+ *
+ * A glide runs alongside the macro: the next instructions run at once, so
+ * keys can be pressed during the move and a DELAY waits for it. A slot runs
+ * one glide at a time; starting another completes the current one first,
+ * and the macro ends only after its glide has.
+ */
+typedef enum {
+    MACRO_EASE_LINEAR = 0,     // Constant speed
+    MACRO_EASE_IN,             // Accelerate
+    MACRO_EASE_OUT,            // Decelerate
+    MACRO_EASE_IN_OUT,         // Accelerate, then decelerate
+    MACRO_EASE_COUNT
+} macro_ease_t;
+
+// Trigger button value for macros not started by a button
+#define MACRO_NO_TRIGGER 0
 
-// Macro definition
+// Interpreter statistics
 typedef struct {
-    uint8_t id;
-    uint8_t num_steps;
-    macro_step_t steps[MAX_MACRO_STEPS];
-} macro_t;
+    uint32_t runs;  // Slot runs (one per due slot per macro_task)
+    uint32_t ops;   // Instructions executed
+} macro_stats_t;
 
 /**
  * Initialize macro system
@@ -44,18 +89,61 @@ typedef struct {
 void macro_init(void);
 
 /**
- * Execute a macro
+ * Execute a macro in a free slot
  * @param macro_id Macro ID to execute
- * @return true on success, false if macro not found
+ * @param trigger_button Input button that started it (for JUMP_IF_HELD and
+ *        WAIT_RELEASE), or MACRO_NO_TRIGGER
+ * @return true on success, false if macro not found or all slots are busy
+ */
+bool macro_execute(uint8_t macro_id, uint16_t trigger_button);
+
+/**
+ * Tell running macros that an input button was released
+ * @param button Released button bit
+ */
+void macro_trigger_released(uint16_t button);
+
+/**
+ * Check if a macro is running
+ * @return true while any slot executes
+ */
+bool macro_is_executing(void);
+
+/**
+ * Get the slots that are executing
+ * @return Bitmask, bit n set while slot n runs
  */
-bool macro_execute(uint8_t macro_id);
+uint8_t macro_running_slots(void);
 
 /**
- * Add a macro
- * @param macro Macro definition
- * @return true on success, false if macro table is full
+ * Stop running macros, releasing the keys and mouse buttons they hold
+ * @param slot_mask Slots to stop (bit n = slot n)
  */
-bool macro_add(const macro_t *macro);
+void macro_stop(uint8_t slot_mask);
+
+/**
+ * Check macro bytecode
+ * Every opcode and operand must be complete, LOOP/NEXT must pair up within
+ * MACRO_LOOP_DEPTH levels and jumps must land on an instruction in the same
+ * loop body.
+ * @param code Bytecode
+ * @param len Length in bytes
+ * @return true if the interpreter can run it
+ */
+bool macro_validate(const uint8_t *code, uint16_t len);
+
+/**
+ * Add or replace a macro in the flash store
+ * A running instance of a replaced macro is stopped. Writing flash takes
+ * about 45 ms per 4 KB sector the store occupies (see macro_store_put());
+ * storing unchanged code is skipped.
+ * @param macro_id Macro ID
+ * @param code Bytecode
+ * @param len Length in bytes (at most MACRO_MAX_SIZE)
+ * @return true on success, false if the code is invalid, the store is full
+ *         or the flash write failed
+ */
+bool macro_add(uint8_t macro_id, const uint8_t *code, uint16_t len);
 
 /**
  * Remove a macro
@@ -65,20 +153,41 @@ bool macro_add(const macro_t *macro);
 bool macro_remove(uint8_t macro_id);
 
 /**
- * Get macro by ID
+ * Get macro bytecode by ID
  * @param macro_id Macro ID
- * @return Pointer to macro, or NULL if not found
+ * @param len Receives the length in bytes (may be NULL)
+ * @return Pointer to the bytecode in memory-mapped flash, or NULL if not found
  */
-macro_t* macro_get(uint8_t macro_id);
+const uint8_t* macro_get(uint8_t macro_id, uint16_t *len);
 
 /**
- * Clear all macros
+ * Clear all macros, stopping any that run
+ * @return true on success, false if the flash write failed
  */
-void macro_clear_all(void);
+bool macro_clear_all(void);
 
 /**
- * Macro task - must be called regularly to execute pending macros
+ * Macro task - runs the due steps of every slot, up to each slot's next delay
+ * Starting a macro raises SCHED_EVENT_MACRO.
  */
 void macro_task(void);
 
+/**
+ * Get the time macro_task next has work to do
+ * @return Absolute time in us of the earliest due step (in the past if one
+ *         is ready now), or UINT64_MAX if idle
+ */
+uint64_t macro_next_deadline_us(void);
+
+/**
+ * Get interpreter statistics
+ * @param stats Pointer to store statistics
+ */
+void macro_get_stats(macro_stats_t *stats);
+
+/**
+ * Reset interpreter statistics
+ */
+void macro_reset_stats(void);
+
 #endif // MACRO_H
@@ -0,0 +1,302 @@
+/**
+ * Macro Recorder Implementation
+ */
+
+#include "macro_record.h"
+#include <string.h>
+#include "macro.h"
+#include "output.h"
+#include "hal.h"
+#include "trace.h"
+
+// Largest delay operand (21-bit varint); a gap is capped at this many ms
+#define RECORD_DELAY_MAX 0x1FFFFFu
+
+// Longest step instruction: MOUSE_MOVE with two 3-byte varints
+#define RECORD_INSN_MAX 7
+
+// Room kept free for the final delay written by macro_record_stop()
+#define RECORD_TAIL_BYTES 8
+
+// Step waiting to be written, with any repeats merged into it
+typedef struct {
+    uint8_t insn[RECORD_INSN_MAX];
+    uint8_t size;        // 0 when nothing is pending
+    uint32_t first_gap;  // Time from the previous step to the first one
+    uint32_t repeat_sum; // Total time between the repeats
+    uint32_t count;      // Times the step happened
+} record_step_t;
+
+static bool recording = false;
+static bool full = false;
+static uint8_t record_id;
+static uint8_t code[MACRO_MAX_SIZE];
+static uint16_t code_len;
+static record_step_t pending;
+static bool started;        // First step seen
+static uint64_t first_us;   // First step
+static uint64_t last_us;    // Latest step
+static uint32_t events;
+static uint32_t steps;
+
+// Output state the recording has produced so far
+static uint8_t key_refs[256];
+static uint8_t button_refs[8];
+
+static uint8_t put_varint(uint8_t *out, uint32_t value) {
+    uint8_t n = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out[n++] = (uint8_t)(byte | (value ? 0x80 : 0));
+    } while (value);
+    return n;
+}
+
+static uint32_t zigzag(int16_t value) {
+    return ((uint32_t)(int32_t)value << 1) ^ (uint32_t)(value < 0 ? -1 : 0);
+}
+
+/**
+ * Encode a delay as DELAY (whole ms, only when too long for one DELAY_US)
+ * and DELAY_US
+ * @return Bytes written to out (at most 8)
+ */
+static uint8_t put_delay(uint8_t *out, uint32_t delay_us) {
+    uint8_t n = 0;
+    if (delay_us > RECORD_DELAY_MAX * 1000u) {
+        delay_us = RECORD_DELAY_MAX * 1000u;
+    }
+    if (delay_us > RECORD_DELAY_MAX) {
+        uint32_t ms = delay_us / 1000u;
+        out[n++] = MACRO_OP_DELAY;
+        n = (uint8_t)(n + put_varint(&out[n], ms));
+        delay_us -= ms * 1000u;
+    }
+    if (delay_us > 0) {
+        out[n++] = MACRO_OP_DELAY_US;
+        n = (uint8_t)(n + put_varint(&out[n], delay_us));
+    }
+    return n;
+}
+
+/**
+ * Append bytes unless that would leave no room for the tail
+ */
+static bool emit(const uint8_t *bytes, uint16_t len) {
+    if (code_len + len > MACRO_MAX_SIZE - RECORD_TAIL_BYTES) {
+        full = true;
+        return false;
+    }
+    memcpy(&code[code_len], bytes, len);
+    code_len = (uint16_t)(code_len + len);
+    return true;
+}
+
+/**
+ * Write the pending step: once, then its repeats at their average interval,
+ * as LOOPs where that is shorter than writing every repeat
+ */
+static void flush_pending(void) {
+    if (pending.size == 0) {
+        return;
+    }
+
+    uint8_t unit[8 + RECORD_INSN_MAX];
+    uint8_t n = put_delay(unit, pending.first_gap);
+    memcpy(&unit[n], pending.insn, pending.size);
+    bool ok = emit(unit, (uint16_t)(n + pending.size));
+    steps++;
+
+    uint32_t repeats = pending.count - 1;
+    uint32_t interval = repeats > 0 ? pending.repeat_sum / repeats : 0;
+    uint32_t extra = repeats > 0 ? pending.repeat_sum % repeats : 0;
+
+    while (ok && repeats > 0) {
+        // The first `extra` repeats take one microsecond more, so the
+        // total stays exact
+        uint32_t run = extra > 0 ? extra : repeats;
+        if (run > 255) {
+            run = 255;
+        }
+        n = put_delay(unit, interval + (extra > 0 ? 1 : 0));
+        memcpy(&unit[n], pending.insn, pending.size);
+        uint16_t size = (uint16_t)(n + pending.size);
+        
+        if (run * size <= size + 3u) {
+            for (uint32_t i = 0; i < run && ok; i++) {
+                ok = emit(unit, size);
+            }
+        } else {
+            uint8_t loop[2 + 8 + RECORD_INSN_MAX + 1] = {MACRO_OP_LOOP, (uint8_t)run};
+            memcpy(&loop[2], unit, size);
+            loop[2 + size] = MACRO_OP_NEXT;
+            ok = emit(loop, (uint16_t)(size + 3));
+        }
+        steps++;
+        repeats -= run;
+        extra = extra > run ? extra - run : 0;
+    }
+    pending.size = 0;
+}
+
+/**
+ * Add a step at the current input time
+ * The same step again at about the same interval extends the pending run.
+ */
+static void record_step(const uint8_t *insn, uint8_t size) {
+    uint64_t now = output_get_input_time();
+    if (now == 0) {
+        now = hal_time_us();
+    }
+    if (!started) {
+        started = true;
+        first_us = now;
+        last_us = now;
+    }
+    uint64_t elapsed = now > last_us ? now - last_us : 0;
+    uint32_t gap = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+    last_us = now;
+
+    if (pending.size == size && memcmp(pending.insn, insn, size) == 0) {
+        uint32_t repeats = pending.count - 1;
+        uint32_t interval = repeats > 0 ? pending.repeat_sum / repeats : gap;
+        uint32_t diff = gap > interval ? gap - interval : interval - gap;
+        if (gap > 0 && diff <= MACRO_RECORD_JITTER_US && pending.repeat_sum + gap > pending.repeat_sum) {
+            pending.repeat_sum += gap;
+            pending.count++;
+            return;
+        }
+    }
+
+    flush_pending();
+    if (full) {
+        TRACE_WARN("Macro record: Macro %d full, recording stopped", record_id);
+        return;
+    }
+    memcpy(pending.insn, insn, size);
+    pending.size = size;
+    pending.first_gap = gap;
+    pending.repeat_sum = 0;
+    pending.count = 1;
+}
+
+void macro_record_start(uint8_t macro_id) {
+    recording = true;
+    full = false;
+    record_id = macro_id;
+    code_len = 0;
+    memset(&pending, 0, sizeof(pending));
+    started = false;
+    first_us = 0;
+    last_us = 0;
+    events = 0;
+    steps = 0;
+    memset(key_refs, 0, sizeof(key_refs));
+    memset(button_refs, 0, sizeof(button_refs));
+    TRACE_INFO("Macro record: Recording macro %d", macro_id);
+}
+
+bool macro_record_active(void) {
+    return recording;
+}
+
+void macro_record_key(uint8_t keycode, bool pressed) {
+    if (!recording || full || keycode == 0) {
+        return;
+    }
+    events++;
+
+    // Only the first press and the last release change the output
+    if (pressed) {
+        if (key_refs[keycode]++ > 0) {
+            return;
+        }
+    } else if (key_refs[keycode] == 0 || --key_refs[keycode] > 0) {
+        return;
+    }
+    uint8_t insn[2] = {pressed ? MACRO_OP_KEY_DOWN : MACRO_OP_KEY_UP, keycode};
+    record_step(insn, sizeof(insn));
+}
+
+void macro_record_mouse_button(uint8_t buttons, bool pressed) {
+    if (!recording || full) {
+        return;
+    }
+    events++;
+
+    uint8_t changed = 0;
+    for (uint8_t i = 0; i < 8; i++) {
+        if (!(buttons & (1u << i))) {
+            continue;
+        }
+        if (pressed) {
+            if (button_refs[i]++ == 0) {
+                changed |= (uint8_t)(1u << i);
+            }
+        } else if (button_refs[i] > 0 && --button_refs[i] == 0) {
+            changed |= (uint8_t)(1u << i);
+        }
+    }
+    if (changed) {
+        uint8_t insn[2] = {pressed ? MACRO_OP_BUTTON_DOWN : MACRO_OP_BUTTON_UP, changed};
+        record_step(insn, sizeof(insn));
+    }
+}
+
+void macro_record_mouse_move(int16_t dx, int16_t dy) {
+    if (!recording || full || (dx == 0 && dy == 0)) {
+        return;
+    }
+    events++;
+
+    uint8_t insn[RECORD_INSN_MAX];
+    uint8_t n = 0;
+    insn[n++] = MACRO_OP_MOUSE_MOVE;
+    n = (uint8_t)(n + put_varint(&insn[n], zigzag(dx)));
+    n = (uint8_t)(n + put_varint(&insn[n], zigzag(dy)));
+    record_step(insn, n);
+}
+
+bool macro_record_stop(macro_record_result_t *result) {
+    if (!recording) {
+        return false;
+    }
+
+    // Until the stop, or the last step if the recording filled up
+    uint64_t end_us = full ? last_us : hal_time_us();
+    flush_pending();
+    recording = false;
+
+    // Keep whatever is still held down until the stop; the end of the macro releases it
+    bool held = false;
+    for (uint16_t i = 0; i < 256 && !held; i++) {
+        held = key_refs[i] != 0;
+    }
+    for (uint8_t i = 0; i < 8 && !held; i++) {
+        held = button_refs[i] != 0;
+    }
+    if (held && end_us > last_us && !full) {
+        uint64_t tail = end_us - last_us;
+        code_len = (uint16_t)(code_len + put_delay(&code[code_len],
+                                                   tail > UINT32_MAX ? UINT32_MAX : (uint32_t)tail));
+        last_us = end_us;
+    }
+
+    if (result) {
+        result->macro_id = record_id;
+        result->len = code_len;
+        result->events = events;
+        result->steps = steps;
+        result->duration_us = started ? (uint32_t)(last_us - first_us) : 0;
+        result->truncated = full;
+    }
+
+    if (code_len == 0) {
+        TRACE_WARN("Macro record: Nothing recorded for macro %d", record_id);
+        return false;
+    }
+    TRACE_INFO("Macro record: Macro %d recorded, %lu events in %d bytes",
+               record_id, (unsigned long)events, code_len);
+    return macro_add(record_id, code, code_len);
+}
@@ -0,0 +1,79 @@
+/**
+ * Macro Recorder
+ *
+ * Captures the keyboard and mouse output the remapping engine produces from
+ * live input and turns it into macro bytecode, so a combo can be recorded
+ * at full input rate on the device instead of being typed into the
+ * configuration tool.
+ *
+ * Each output change becomes a step: the time since the previous step
+ * (MACRO_OP_DELAY_US, exact to the microsecond) followed by the key, mouse
+ * button or mouse move. Steps that change nothing (a key another mapping
+ * already holds) are dropped, and runs of the same step at the same
+ * interval, like the 1 ms moves of a held stick, become one LOOP. Time
+ * before the first step is not recorded.
+ */
+
+#ifndef MACRO_RECORD_H
+#define MACRO_RECORD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Repeats whose intervals differ by at most this much still merge into a loop
+#define MACRO_RECORD_JITTER_US 100
+
+// Result of a recording
+typedef struct {
+    uint8_t macro_id;
+    uint16_t len;        // Bytecode bytes
+    uint32_t events;     // Output changes captured
+    uint32_t steps;      // Steps left after dropping and merging
+    uint32_t duration_us;
+    bool truncated;      // Stopped early because the macro reached MACRO_MAX_SIZE
+} macro_record_result_t;
+
+/**
+ * Start recording (discards a recording in progress)
+ * @param macro_id Macro ID the recording will be stored as
+ */
+void macro_record_start(uint8_t macro_id);
+
+/**
+ * Stop recording and store the result with macro_add()
+ * Keys and mouse buttons still held are released at the stop time, so the
+ * last hold keeps its length.
+ * @param result Receives the recording summary (may be NULL)
+ * @return true if the macro was stored, false if nothing was recorded or
+ *         storing failed
+ */
+bool macro_record_stop(macro_record_result_t *result);
+
+/**
+ * Check if a recording is in progress
+ * @return true while recording
+ */
+bool macro_record_active(void);
+
+/**
+ * Record a key press or release
+ * @param keycode HID keyboard usage code
+ * @param pressed true for a press
+ */
+void macro_record_key(uint8_t keycode, bool pressed);
+
+/**
+ * Record mouse buttons being pressed or released
+ * @param buttons Mouse button bitmask
+ * @param pressed true for a press
+ */
+void macro_record_mouse_button(uint8_t buttons, bool pressed);
+
+/**
+ * Record mouse movement
+ * @param dx X movement
+ * @param dy Y movement
+ */
+void macro_record_mouse_move(int16_t dx, int16_t dy);
+
+#endif // MACRO_RECORD_H
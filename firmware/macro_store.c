@@ -0,0 +1,283 @@
+/**
+ * Macro Flash Store Implementation
+ */
+
+#include "macro_store.h"
+#include <string.h>
+#include "macro.h"
+#include "trace.h"
+
+#define MACRO_STORE_MAGIC   0x4A434D53  // "JCMS"
+#define MACRO_STORE_VERSION 1
+
+// Banks sit directly below the configuration sector (see config.c)
+#define MACRO_STORE_OFFSET(bank) \
+    (hal_flash_size() - HAL_FLASH_SECTOR_SIZE - \
+     (MACRO_STORE_BANKS - (uint32_t)(bank)) * MACRO_STORE_BANK_SIZE)
+
+typedef struct {
+    uint8_t id;
+    uint8_t reserved;
+    uint16_t offset;  // From the start of the bank
+    uint16_t len;
+} macro_store_entry_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t sequence;  // Higher is newer
+    uint32_t checksum;  // FNV-1a over the index entries and all bytecode
+    macro_store_entry_t entries[MAX_MACROS];
+} macro_store_header_t;
+
+_Static_assert(sizeof(macro_store_header_t) <= HAL_FLASH_PAGE_SIZE,
+               "macro store header must fit in one flash page");
+
+static int active_bank = -1;  // -1 while the store is empty
+
+static const uint8_t* bank_base(int bank) {
+    return hal_flash_read(MACRO_STORE_OFFSET(bank));
+}
+
+static const macro_store_header_t* bank_header(int bank) {
+    return (const macro_store_header_t *)bank_base(bank);
+}
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t *data, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+#define FNV1A_INIT 2166136261u
+
+/**
+ * Check a bank's header, index and checksum
+ */
+static bool bank_valid(int bank) {
+    const macro_store_header_t *header = bank_header(bank);
+    if (header->magic != MACRO_STORE_MAGIC || header->version != MACRO_STORE_VERSION ||
+        header->count > MAX_MACROS) {
+        return false;
+    }
+
+    uint32_t hash = fnv1a(FNV1A_INIT, (const uint8_t *)header->entries,
+                          header->count * sizeof(macro_store_entry_t));
+    for (uint16_t i = 0; i < header->count; i++) {
+        const macro_store_entry_t *entry = &header->entries[i];
+        if (entry->offset < HAL_FLASH_PAGE_SIZE ||
+            (uint32_t)entry->offset + entry->len > MACRO_STORE_BANK_SIZE) {
+            return false;
+        }
+        hash = fnv1a(hash, bank_base(bank) + entry->offset, entry->len);
+    }
+    return hash == header->checksum;
+}
+
+bool macro_store_init(void) {
+    active_bank = -1;
+    for (int bank = 0; bank < MACRO_STORE_BANKS; bank++) {
+        if (!bank_valid(bank)) {
+            continue;
+        }
+        if (active_bank < 0 ||
+            (int32_t)(bank_header(bank)->sequence - bank_header(active_bank)->sequence) > 0) {
+            active_bank = bank;
+        }
+    }
+
+    if (active_bank < 0) {
+        TRACE_INFO("Macro store: Empty");
+        return false;
+    }
+    TRACE_INFO("Macro store: Bank %d, %d macros", active_bank, bank_header(active_bank)->count);
+    return true;
+}
+
+/**
+ * Find a macro in the active bank
+ * @return Index entry, or NULL
+ */
+static const macro_store_entry_t* find_entry(uint8_t macro_id) {
+    if (active_bank < 0) {
+        return NULL;
+    }
+
+    const macro_store_header_t *header = bank_header(active_bank);
+    for (uint16_t i = 0; i < header->count; i++) {
+        if (header->entries[i].id == macro_id) {
+            return &header->entries[i];
+        }
+    }
+    return NULL;
+}
+
+const uint8_t* macro_store_get(uint8_t macro_id, uint16_t *len) {
+    const macro_store_entry_t *entry = find_entry(macro_id);
+    if (!entry) {
+        return NULL;
+    }
+
+    if (len) {
+        *len = entry->len;
+    }
+    return bank_base(active_bank) + entry->offset;
+}
+
+// Copies bytecode into the new bank one flash page at a time
+typedef struct {
+    uint32_t flash_offset;  // Start of the page being filled
+    uint16_t fill;
+    uint8_t page[HAL_FLASH_PAGE_SIZE];
+} page_writer_t;
+
+static bool page_write(page_writer_t *writer, const uint8_t *data, uint16_t len) {
+    while (len > 0) {
+        uint16_t chunk = (uint16_t)(HAL_FLASH_PAGE_SIZE - writer->fill);
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(&writer->page[writer->fill], data, chunk);
+        writer->fill = (uint16_t)(writer->fill + chunk);
+        data += chunk;
+        len = (uint16_t)(len - chunk);
+
+        if (writer->fill == HAL_FLASH_PAGE_SIZE) {
+            if (!hal_flash_program(writer->flash_offset, writer->page, HAL_FLASH_PAGE_SIZE)) {
+                return false;
+            }
+            writer->flash_offset += HAL_FLASH_PAGE_SIZE;
+            writer->fill = 0;
+        }
+    }
+    return true;
+}
+
+static bool page_flush(page_writer_t *writer) {
+    return writer->fill == 0 || hal_flash_program(writer->flash_offset, writer->page, writer->fill);
+}
+
+/**
+ * Write the active bank's macros, minus macro_id, plus code (if not NULL)
+ * to the other bank and switch to it
+ * @param keep false to drop every old macro
+ */
+static bool store_rewrite(uint8_t macro_id, const uint8_t *code, uint16_t len, bool keep) {
+    int new_bank = active_bank < 0 ? 0 : 1 - active_bank;
+    const macro_store_header_t *old = active_bank < 0 ? NULL : bank_header(active_bank);
+
+    // Build the new index; the code follows the header page in index order
+    macro_store_header_t header;
+    memset(&header, 0xFF, sizeof(header));
+    header.magic = MACRO_STORE_MAGIC;
+    header.version = MACRO_STORE_VERSION;
+    header.count = 0;
+    header.sequence = old ? old->sequence + 1 : 1;
+
+    uint32_t offset = HAL_FLASH_PAGE_SIZE;
+    for (uint16_t i = 0; old && keep && i < old->count; i++) {
+        if (old->entries[i].id == macro_id) {
+            continue;
+        }
+        macro_store_entry_t *entry = &header.entries[header.count++];
+        *entry = old->entries[i];
+        entry->offset = (uint16_t)offset;
+        offset += entry->len;
+    }
+    if (code) {
+        if (header.count >= MAX_MACROS) {
+            TRACE_WARN("Macro store: Index full");
+            return false;
+        }
+        macro_store_entry_t *entry = &header.entries[header.count++];
+        entry->id = macro_id;
+        entry->reserved = 0;
+        entry->offset = (uint16_t)offset;
+        entry->len = len;
+        offset += len;
+    }
+    if (offset > MACRO_STORE_BANK_SIZE) {
+        TRACE_WARN("Macro store: Full, %lu bytes needed",
+                   (unsigned long)(offset - HAL_FLASH_PAGE_SIZE));
+        return false;
+    }
+
+    // Erase only the sectors the new contents cover; bank_valid() never
+    // looks past the index, so stale data behind them does no harm
+    uint32_t bank_offset = MACRO_STORE_OFFSET(new_bank);
+    uint32_t erase_len = (offset + HAL_FLASH_SECTOR_SIZE - 1) & ~(HAL_FLASH_SECTOR_SIZE - 1);
+    if (!hal_flash_erase(bank_offset, erase_len)) {
+        return false;
+    }
+
+    // Bytecode first (old entries from the active bank, the new one from RAM)
+    page_writer_t writer = {.flash_offset = bank_offset + HAL_FLASH_PAGE_SIZE, .fill = 0};
+    uint32_t hash = fnv1a(FNV1A_INIT, (const uint8_t *)header.entries,
+                          header.count * sizeof(macro_store_entry_t));
+    for (uint16_t i = 0; i < header.count; i++) {
+        const macro_store_entry_t *entry = &header.entries[i];
+        const uint8_t *src = (code && entry->id == macro_id) ? code :
+                             macro_store_get(entry->id, NULL);
+        hash = fnv1a(hash, src, entry->len);
+        if (!page_write(&writer, src, entry->len)) {
+            return false;
+        }
+    }
+    if (!page_flush(&writer)) {
+        return false;
+    }
+
+    // The header makes the bank valid, so it goes last
+    header.checksum = hash;
+    if (!hal_flash_program(bank_offset, &header, sizeof(header))) {
+        return false;
+    }
+
+    active_bank = new_bank;
+    return true;
+}
+
+bool macro_store_put(uint8_t macro_id, const uint8_t *code, uint16_t len) {
+    if (!code && !find_entry(macro_id)) {
+        return false;
+    }
+    if (code && len == 0) {
+        return false;
+    }
+
+    if (!store_rewrite(macro_id, code, len, true)) {
+        TRACE_WARN("Macro store: Writing macro %d failed", macro_id);
+        return false;
+    }
+    return true;
+}
+
+bool macro_store_clear(void) {
+    // An empty but valid bank, so the old contents stay superseded
+    return active_bank < 0 || store_rewrite(0, NULL, 0, false);
+}
+
+bool macro_store_entry(uint8_t index, uint8_t *macro_id, uint16_t *len) {
+    if (index >= macro_store_count()) {
+        return false;
+    }
+
+    const macro_store_entry_t *entry = &bank_header(active_bank)->entries[index];
+    *macro_id = entry->id;
+    *len = entry->len;
+    return true;
+}
+
+uint8_t macro_store_count(void) {
+    return active_bank < 0 ? 0 : (uint8_t)bank_header(active_bank)->count;
+}
+
+uint16_t macro_store_used(void) {
+    uint16_t used = 0;
+    for (uint8_t i = 0; i < macro_store_count(); i++) {
+        used = (uint16_t)(used + bank_header(active_bank)->entries[i].len);
+    }
+    return used;
+}
@@ -0,0 +1,87 @@
+/**
+ * Macro Flash Store
+ *
+ * Keeps macro bytecode in flash directly below the configuration sector,
+ * so macros survive a reboot and take no RAM: the interpreter reads the
+ * code through the memory-mapped (XIP) flash view.
+ *
+ * Two banks of MACRO_STORE_BANK_SIZE alternate. A change writes the
+ * complete new contents to the inactive bank, header page last, and only
+ * then switches over; the active bank stays intact until the next change,
+ * so an interrupted write loses nothing and code pointers handed out
+ * before the change stay readable. At boot the valid bank with the higher
+ * sequence number is used.
+ *
+ * Bank layout: one header page (magic, version, sequence, checksum and an
+ * index of {id, offset, len} entries), then the bytecode of each macro.
+ */
+
+#ifndef MACRO_STORE_H
+#define MACRO_STORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hal.h"
+
+#define MACRO_STORE_BANK_SIZE (4u * HAL_FLASH_SECTOR_SIZE)
+#define MACRO_STORE_BANKS     2
+
+// Bytecode bytes one bank holds (everything after the header page)
+#define MACRO_STORE_CAPACITY  (MACRO_STORE_BANK_SIZE - HAL_FLASH_PAGE_SIZE)
+
+/**
+ * Find the active bank
+ * @return true if a valid bank was found, false if the store is empty
+ */
+bool macro_store_init(void);
+
+/**
+ * Look up a macro
+ * @param macro_id Macro ID
+ * @param len Receives the length in bytes (may be NULL)
+ * @return Pointer into memory-mapped flash, or NULL if not stored
+ */
+const uint8_t* macro_store_get(uint8_t macro_id, uint16_t *len);
+
+/**
+ * Add, replace or remove a macro
+ * Erases and programs the inactive bank, one 4 KB sector per 4 KB of
+ * stored bytecode (the first sector holds about 3.8 KB). A sector erase
+ * takes about 45 ms, up to 400 ms worst case, with interrupts off and
+ * core 1 paused.
+ * @param macro_id Macro ID
+ * @param code Bytecode, or NULL to remove the macro
+ * @param len Length in bytes
+ * @return true on success, false if the index or bank is full, the macro
+ *         to remove does not exist, or flash programming failed
+ */
+bool macro_store_put(uint8_t macro_id, const uint8_t *code, uint16_t len);
+
+/**
+ * Remove all macros
+ * @return true on success
+ */
+bool macro_store_clear(void);
+
+/**
+ * Get a stored macro by position
+ * @param index Position (0 to macro_store_count() - 1)
+ * @param macro_id Receives the macro ID
+ * @param len Receives the length in bytes
+ * @return true if index is valid
+ */
+bool macro_store_entry(uint8_t index, uint8_t *macro_id, uint16_t *len);
+
+/**
+ * Get the number of stored macros
+ * @return Number of macros
+ */
+uint8_t macro_store_count(void);
+
+/**
+ * Get the bytecode bytes in use
+ * @return Bytes of MACRO_STORE_CAPACITY taken by macros
+ */
+uint16_t macro_store_used(void);
+
+#endif // MACRO_STORE_H
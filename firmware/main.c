@@ -7,6 +7,9 @@
  * Hardware: Waveshare RP2350-PiZero with dual USB:
  * - Native USB (Type-C): USB Device for HID output + CDC serial (connects to PC)
  * - PIO-USB (Type-C): USB Host for controller input
+ *
+ * Core 1 runs the PIO-USB host stack and decodes input reports; core 0
+ * runs the device side, remapping, macros and serial commands.
  */
 
 #include <stdio.h>
@@ -23,8 +26,19 @@
 #include "usb_device.h"
 #include "config.h"
 #include "remapping.h"
+#include "output.h"
 #include "macro.h"
 #include "logging.h"
+#include "sched.h"
+#include "hal.h"
+#include "console.h"
+#include "command.h"
+#include "telemetry.h"
+#include "latency.h"
+#include "counters.h"
+#include "bench.h"
+#include "macro_store.h"
+#include "macro_record.h"
 
 // LED pin for status indication
 #define LED_PIN 25
@@ -41,6 +55,7 @@ typedef enum {
 
 static app_state_t current_state = STATE_INIT;
 static bool debug_mode_enabled = false;
+static bool console_ready = false;
 
 /**
  * Initialize hardware peripherals
@@ -53,8 +68,11 @@ static void hardware_init(void) {
     // Small delay for clock stabilization
     sleep_ms(10);
     
-    // Initialize stdio for debugging (uses USB CDC)
+    // Initialize stdio; the debug UART console queues output for DMA so
+    // printf never waits on the UART. It must not take the DMA channel
+    // PIO-USB claims when core 1 starts the host stack.
     stdio_init_all();
+    console_ready = console_init(USB_HOST_PIO_DMA_CHANNEL);
     
     // Initialize LED
     gpio_init(LED_PIN);
@@ -66,147 +84,639 @@ static void hardware_init(void) {
     printf("System clock: %lu Hz\n", clock_get_hz(clk_sys));
 }
 
-// Command buffer size for serial commands
-#define CMD_BUFFER_SIZE 32
+// Multi-line replies (LOG_GET, PROF, PROF_TRACE_GET) are streamed into
+// the CDC TX FIFO between other work, a chunk at a time
+#define REPLY_STREAM_CHUNK 128
 
-// Buffer for log output (shared across log commands)
-static char log_output_buffer[LOG_BUFFER_SIZE];
+/**
+ * Produce the next part of a streamed reply
+ * @param buf Output buffer (not NUL-terminated)
+ * @param size Size of buf
+ * @return Bytes written, 0 when the reply is complete
+ */
+typedef uint16_t (*reply_stream_fn_t)(char *buf, uint16_t size);
+
+static reply_stream_fn_t reply_stream_fn = NULL;  // NULL when idle
+static const char *reply_stream_end = NULL;       // Line sent after the last part
+static uint16_t reply_stream_pos = 0;             // Row position of table replies
+
+static log_cursor_t log_stream_cursor;
+
+// Macro being uploaded with MACRO_BEGIN / MACRO_DATA / MACRO_END
+static uint8_t macro_upload[MACRO_MAX_SIZE];
+static uint16_t macro_upload_len = 0;       // Announced length
+static uint16_t macro_upload_received = 0;
+static int macro_upload_id = -1;            // -1 when no upload is open
+
+static int telemetry_task_id = -1;
+static int usb_device_task_id = -1;
+
+//--------------------------------------------------------------------
+// Serial commands
+//--------------------------------------------------------------------
 
 /**
- * Handle serial commands for debug mode and logging
+ * Parse the optional device slot argument of a debug command ("" or "n")
+ * @param args Command arguments
+ * @param device Set to the requested slot, or the first connected one (-1 if none)
+ * @return true if the argument is valid
  */
-static void handle_serial_commands(void) {
-    static char cmd_buffer[CMD_BUFFER_SIZE];
-    static int cmd_pos = 0;
+static bool parse_device_arg(const char *args, int *device) {
+    if (args[0] == '\0') {
+        uint8_t connected = usb_host_get_connected_devices();
+        *device = connected ? __builtin_ctz(connected) : -1;
+        return true;
+    }
+    if (args[0] >= '0' && args[0] < '0' + USB_HOST_MAX_DEVICES && args[1] == '\0') {
+        *device = args[0] - '0';
+        return true;
+    }
+    return false;
+}
+
+static void cmd_bench(const char *args) {
+    // Pipeline throughput with the current config (BENCH [reports])
+    uint32_t reports = BENCH_DEFAULT_REPORTS;
+    if (args[0] != '\0') {
+        char *end;
+        reports = (uint32_t)strtoul(args, &end, 10);
+        if (*end != '\0') {
+            reports = 0;
+        }
+    }
+    if (reports == 0 || reports > BENCH_MAX_REPORTS) {
+        command_printf("BENCH_ERROR:invalid\n");
+        return;
+    }
+    if (macro_record_active()) {
+        // The synthetic input would end up in the recording
+        command_printf("BENCH_ERROR:recording\n");
+        return;
+    }
     
-    // Check if data is available
-    int c = getchar_timeout_us(0);
-    if (c == PICO_ERROR_TIMEOUT) {
+    bench_result_t result;
+    if (!bench_run(reports, &result)) {
+        command_printf("BENCH_ERROR:no_free_slot\n");
         return;
     }
     
-    // Validate character is printable or newline
-    if (c < 0 || (c > 127 && c != '\n' && c != '\r')) {
-        // Invalid character, reset buffer
-        cmd_pos = 0;
+    LOG_INFO("Bench: %lu reports, %lu reports/s",
+             (unsigned long)result.reports, (unsigned long)result.reports_per_sec);
+    command_printf("BENCH:reports=%lu,rate=%lu,avg_cycles=%lu,max_cycles=%lu,macros=%lu,cycle_hz=%lu\n",
+                   (unsigned long)result.reports,
+                   (unsigned long)result.reports_per_sec,
+                   (unsigned long)result.cycles_avg,
+                   (unsigned long)result.cycles_max,
+                   (unsigned long)result.macro_triggers,
+                   (unsigned long)hal_cycle_hz());
+}
+
+static void cmd_console_stats(const char *args) {
+    (void)args;
+    // Debug UART output counters
+    console_stats_t stats;
+    console_get_stats(&stats);
+    command_printf("CONSOLE_STATS:written=%lu,dropped=%lu,free=%lu\n",
+                   (unsigned long)stats.written,
+                   (unsigned long)stats.dropped,
+                   (unsigned long)console_write_space());
+}
+
+static void cmd_console_stats_reset(const char *args) {
+    (void)args;
+    console_reset_stats();
+    command_printf("CONSOLE_STATS_RESET\n");
+}
+
+static void cmd_debug_get(const char *args) {
+    int device;
+    if (!parse_device_arg(args, &device) || !debug_mode_enabled || device < 0) {
         return;
     }
     
-    // Add character to buffer
-    if (c == '\n' || c == '\r') {
-        if (cmd_pos > 0) {
-            cmd_buffer[cmd_pos] = '\0';
-            
-            // Process command
-            if (strcmp(cmd_buffer, "DEBUG_START") == 0) {
-                debug_mode_enabled = true;
-                if (usb_host_device_connected()) {
-                    current_state = STATE_DEBUG_MODE;
-                }
-                printf("DEBUG_MODE_STARTED\n");
-            } else if (strcmp(cmd_buffer, "DEBUG_STOP") == 0) {
-                debug_mode_enabled = false;
-                if (current_state == STATE_DEBUG_MODE) {
-                    current_state = STATE_ACTIVE;
-                }
-                printf("DEBUG_MODE_STOPPED\n");
-            } else if (strcmp(cmd_buffer, "DEBUG_GET") == 0) {
-                // Send current input state based on input type
-                if (debug_mode_enabled && usb_host_device_connected()) {
-                    input_type_t input_type = usb_host_get_input_type();
-                    
-                    if (input_type == INPUT_TYPE_KEYBOARD) {
-                        keyboard_state_t state;
-                        if (usb_host_get_keyboard_state(&state)) {
-                            // Format: "DEBUG_KB:modifiers,num_keys,key0,key1,key2,key3,key4,key5"
-                            printf("DEBUG_KB:%u,%u,%u,%u,%u,%u,%u,%u\n",
-                                   state.modifiers,
-                                   state.num_keys,
-                                   state.keys[0], state.keys[1],
-                                   state.keys[2], state.keys[3],
-                                   state.keys[4], state.keys[5]);
-                        }
-                    } else {
-                        gamepad_state_t state;
-                        if (usb_host_get_gamepad_state(&state)) {
-                            // Format: "DEBUG:buttons,lx,ly,rx,ry,lt,rt,dx,dy"
-                            printf("DEBUG:%u,%d,%d,%d,%d,%u,%u,%d,%d\n",
-                                   state.buttons,
-                                   state.left_x, state.left_y,
-                                   state.right_x, state.right_y,
-                                   state.left_trigger, state.right_trigger,
-                                   state.dpad_x, state.dpad_y);
-                        }
-                    }
-                }
-            } else if (strcmp(cmd_buffer, "DEBUG_INFO") == 0) {
-                // Send connected device info
-                if (usb_host_device_connected()) {
-                    usb_device_info_t info;
-                    if (usb_host_get_device_info(&info)) {
-                        // Format: "DEBUG_INFO:vid,pid,addr,type"
-                        printf("DEBUG_INFO:0x%04X,0x%04X,%u,%u\n",
-                               info.vid, info.pid, 
-                               info.dev_addr, (unsigned)info.input_type);
-                    }
-                } else {
-                    printf("DEBUG_INFO:NO_DEVICE\n");
-                }
-            } else if (strcmp(cmd_buffer, "LOG_GET") == 0) {
-                // Get and send all logs
-                uint16_t len = logging_get_logs(log_output_buffer, sizeof(log_output_buffer));
-                if (len > 0) {
-                    printf("LOG_START\n");
-                    printf("%s", log_output_buffer);
-                    printf("LOG_END\n");
-                } else {
-                    printf("LOG_EMPTY\n");
-                }
-            } else if (strcmp(cmd_buffer, "LOG_CLEAR") == 0) {
-                // Clear all logs
-                logging_clear();
-                printf("LOG_CLEARED\n");
-            } else if (strcmp(cmd_buffer, "LOG_COUNT") == 0) {
-                // Get log entry count
-                printf("LOG_COUNT:%u\n", logging_get_count());
-            } else if (strncmp(cmd_buffer, "LOG_LEVEL ", 10) == 0) {
-                // Set log level (LOG_LEVEL 0-3), ensure there's a character after space
-                if (cmd_buffer[10] != '\0') {
-                    int level = cmd_buffer[10] - '0';
-                    if (level >= 0 && level <= 3) {
-                        logging_set_level((log_level_t)level);
-                        printf("LOG_LEVEL_SET:%d\n", level);
-                    } else {
-                        printf("LOG_LEVEL_ERROR:invalid\n");
-                    }
-                } else {
-                    printf("LOG_LEVEL_ERROR:invalid\n");
-                }
-            } else if (strcmp(cmd_buffer, "LOG_STATUS") == 0) {
-                // Get logging status
-                printf("LOG_STATUS:level=%d,count=%u,overflow=%d\n",
-                       logging_get_level(),
-                       logging_get_count(),
-                       logging_has_overflow() ? 1 : 0);
-            }
-            
-            cmd_pos = 0;
+    // Send current input state of one device based on its input type
+    input_type_t input_type = usb_host_get_input_type((uint8_t)device);
+    
+    if (input_type == INPUT_TYPE_KEYBOARD) {
+        keyboard_state_t state;
+        if (usb_host_get_keyboard_state((uint8_t)device, &state)) {
+            // Format: "DEBUG_KB:modifiers,num_keys,key0,key1,key2,key3,key4,key5"
+            command_printf("DEBUG_KB:%u,%u,%u,%u,%u,%u,%u,%u\n",
+                           state.modifiers,
+                           state.num_keys,
+                           state.keys[0], state.keys[1],
+                           state.keys[2], state.keys[3],
+                           state.keys[4], state.keys[5]);
+        }
+    } else {
+        gamepad_state_t state;
+        if (usb_host_get_gamepad_state((uint8_t)device, &state)) {
+            // Format: "DEBUG:buttons,lx,ly,rx,ry,lt,rt,dx,dy"
+            command_printf("DEBUG:%u,%d,%d,%d,%d,%u,%u,%d,%d\n",
+                           state.buttons,
+                           state.left_x, state.left_y,
+                           state.right_x, state.right_y,
+                           state.left_trigger, state.right_trigger,
+                           state.dpad_x, state.dpad_y);
+        }
+    }
+}
+
+static void cmd_debug_info(const char *args) {
+    int device;
+    if (!parse_device_arg(args, &device)) {
+        return;
+    }
+    
+    // Send connected device info
+    usb_device_info_t info;
+    if (device >= 0 && usb_host_get_device_info((uint8_t)device, &info)) {
+        // Format: "DEBUG_INFO:vid,pid,addr,type"
+        command_printf("DEBUG_INFO:0x%04X,0x%04X,%u,%u\n",
+                       info.vid, info.pid,
+                       info.dev_addr, (unsigned)info.input_type);
+    } else {
+        command_printf("DEBUG_INFO:NO_DEVICE\n");
+    }
+}
+
+static void cmd_debug_start(const char *args) {
+    (void)args;
+    debug_mode_enabled = true;
+    if (usb_host_device_connected()) {
+        current_state = STATE_DEBUG_MODE;
+    }
+    command_printf("DEBUG_MODE_STARTED\n");
+}
+
+static void cmd_debug_stop(const char *args) {
+    (void)args;
+    debug_mode_enabled = false;
+    if (current_state == STATE_DEBUG_MODE) {
+        current_state = STATE_ACTIVE;
+    }
+    // Resume a macro held back while debugging
+    sched_signal(SCHED_EVENT_MACRO);
+    command_printf("DEBUG_MODE_STOPPED\n");
+}
+
+static void cmd_decode_stats(const char *args) {
+    (void)args;
+    // Input report decode cost (cycles of the core running the host stack)
+    usb_host_decode_stats_t stats;
+    usb_host_get_decode_stats(&stats);
+    uint32_t avg = stats.reports ? (uint32_t)(stats.cycles_total / stats.reports) : 0;
+    command_printf("DECODE_STATS:reports=%lu,avg_cycles=%lu,max_cycles=%lu,last_cycles=%lu,fields=%u,decoder=%s,cycle_hz=%lu\n",
+                   (unsigned long)stats.reports,
+                   (unsigned long)avg,
+                   (unsigned long)stats.cycles_max,
+                   (unsigned long)stats.cycles_last,
+                   stats.num_fields,
+                   usb_host_get_decoder_name(stats.decoder),
+                   (unsigned long)hal_cycle_hz());
+}
+
+static void cmd_decode_stats_reset(const char *args) {
+    (void)args;
+    usb_host_reset_decode_stats();
+    command_printf("DECODE_STATS_RESET\n");
+}
+
+static void cmd_hid_stats(const char *args) {
+    (void)args;
+    // Report transmission counters per report ID
+    usb_device_stats_t stats;
+    usb_device_get_stats(&stats);
+    command_printf("HID_STATS:gamepad=%lu/%lu/%lu,keyboard=%lu/%lu/%lu,mouse=%lu/%lu/%lu\n",
+                   (unsigned long)stats.gamepad.sent,
+                   (unsigned long)stats.gamepad.suppressed,
+                   (unsigned long)stats.gamepad.keepalive,
+                   (unsigned long)stats.keyboard.sent,
+                   (unsigned long)stats.keyboard.suppressed,
+                   (unsigned long)stats.keyboard.keepalive,
+                   (unsigned long)stats.mouse.sent,
+                   (unsigned long)stats.mouse.suppressed,
+                   (unsigned long)stats.mouse.keepalive);
+}
+
+static void cmd_hid_keepalive(const char *args) {
+    // HID_KEEPALIVE [ms]: set (0 = off) or query the report keep-alive interval
+    if (args[0] != '\0') {
+        char *end;
+        unsigned long interval = strtoul(args, &end, 10);
+        if (*end != '\0' || interval > USB_DEVICE_KEEPALIVE_MAX_MS) {
+            command_printf("HID_KEEPALIVE_ERROR:invalid\n");
+            return;
+        }
+        usb_device_set_keepalive((uint32_t)interval);
+        // Let the device task pick up its new deadline
+        sched_wake_at(usb_device_task_id, hal_time_us());
+    }
+    command_printf("HID_KEEPALIVE:%lu\n", (unsigned long)usb_device_get_keepalive());
+}
+
+static void cmd_hid_stats_reset(const char *args) {
+    (void)args;
+    usb_device_reset_stats();
+    command_printf("HID_STATS_RESET\n");
+}
+
+static void cmd_lat_stats(const char *args) {
+    (void)args;
+    // Input-to-output latency in us; hist lists the log2 buckets from 0
+    latency_stats_t stats;
+    latency_get_stats(&stats);
+    command_printf("LAT_STATS:count=%lu,min=%lu,avg=%lu,p50=%lu,p99=%lu,max=%lu,hist=",
+                   (unsigned long)stats.count,
+                   (unsigned long)stats.min_us,
+                   (unsigned long)stats.avg_us,
+                   (unsigned long)stats.p50_us,
+                   (unsigned long)stats.p99_us,
+                   (unsigned long)stats.max_us);
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        command_printf(i + 1 < LATENCY_BUCKETS ? "%lu/" : "%lu\n", (unsigned long)stats.buckets[i]);
+    }
+}
+
+static void cmd_lat_stats_reset(const char *args) {
+    (void)args;
+    latency_reset_stats();
+    command_printf("LAT_STATS_RESET\n");
+}
+
+static void cmd_log_clear(const char *args) {
+    (void)args;
+    logging_clear();
+    command_printf("LOG_CLEARED\n");
+}
+
+static void cmd_log_count(const char *args) {
+    (void)args;
+    command_printf("LOG_COUNT:%u\n", logging_get_count());
+}
+
+/**
+ * Start a streamed reply; replaces one still in progress
+ * @param fn Producer of the reply body
+ * @param end Line sent when fn is done
+ */
+static void reply_stream_start(reply_stream_fn_t fn, const char *end) {
+    reply_stream_fn = fn;
+    reply_stream_end = end;
+    reply_stream_pos = 0;
+}
+
+static uint16_t log_stream_read(char *buf, uint16_t size) {
+    return logging_read(&log_stream_cursor, buf, size);
+}
+
+static void cmd_log_get(const char *args) {
+    (void)args;
+    // Start sending all logs; reply_stream_task sends the entries
+    if (logging_get_count() > 0) {
+        command_printf("LOG_START\n");
+        logging_cursor_init(&log_stream_cursor);
+        reply_stream_start(log_stream_read, "LOG_END\n");
+    } else {
+        command_printf("LOG_EMPTY\n");
+    }
+}
+
+static void cmd_log_level(const char *args) {
+    // Set log level (LOG_LEVEL 0-3)
+    if (args[0] >= '0' && args[0] <= '3' && args[1] == '\0') {
+        int level = args[0] - '0';
+        logging_set_level((log_level_t)level);
+        command_printf("LOG_LEVEL_SET:%d\n", level);
+    } else {
+        command_printf("LOG_LEVEL_ERROR:invalid\n");
+    }
+}
+
+static void cmd_log_status(const char *args) {
+    (void)args;
+    command_printf("LOG_STATUS:level=%d,count=%u,overflow=%d\n",
+                   logging_get_level(),
+                   logging_get_count(),
+                   logging_has_overflow() ? 1 : 0);
+}
+
+/**
+ * Parse a macro ID argument
+ * @return ID (0-255), or -1 if invalid
+ */
+static int parse_macro_id(const char *arg, char **end) {
+    unsigned long id = strtoul(arg, end, 10);
+    return (*end == arg || id > 255) ? -1 : (int)id;
+}
+
+static void cmd_macro_begin(const char *args) {
+    // Open an upload (MACRO_BEGIN <id> <len>); the code follows in MACRO_DATA lines
+    char *end;
+    int id = parse_macro_id(args, &end);
+    unsigned long len = (*end == ' ') ? strtoul(end + 1, &end, 10) : 0;
+    if (id < 0 || *end != '\0' || len == 0 || len > MACRO_MAX_SIZE) {
+        command_printf("MACRO_ERROR:invalid\n");
+        return;
+    }
+    
+    macro_upload_id = id;
+    macro_upload_len = (uint16_t)len;
+    macro_upload_received = 0;
+    command_printf("MACRO_READY:%d,%u\n", id, macro_upload_len);
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static void cmd_macro_data(const char *args) {
+    // Next part of the code as hex; the reply acknowledges the running total
+    if (macro_upload_id < 0) {
+        command_printf("MACRO_ERROR:no_upload\n");
+        return;
+    }
+    
+    size_t digits = strlen(args);
+    if (digits == 0 || (digits & 1) ||
+        macro_upload_received + digits / 2 > macro_upload_len) {
+        macro_upload_id = -1;
+        command_printf("MACRO_ERROR:invalid\n");
+        return;
+    }
+    for (size_t i = 0; i < digits; i += 2) {
+        int high = hex_digit(args[i]);
+        int low = hex_digit(args[i + 1]);
+        if (high < 0 || low < 0) {
+            macro_upload_id = -1;
+            command_printf("MACRO_ERROR:invalid\n");
+            return;
+        }
+        macro_upload[macro_upload_received++] = (uint8_t)((high << 4) | low);
+    }
+    command_printf("MACRO_DATA:%u\n", macro_upload_received);
+}
+
+static void cmd_macro_del(const char *args) {
+    char *end;
+    int id = parse_macro_id(args, &end);
+    if (id < 0 || *end != '\0') {
+        command_printf("MACRO_ERROR:invalid\n");
+    } else if (macro_remove((uint8_t)id)) {
+        command_printf("MACRO_DELETED:%d\n", id);
+    } else {
+        command_printf("MACRO_ERROR:not_found\n");
+    }
+}
+
+static void cmd_macro_end(const char *args) {
+    (void)args;
+    // Validate the uploaded code and write it to the flash store
+    if (macro_upload_id < 0) {
+        command_printf("MACRO_ERROR:no_upload\n");
+        return;
+    }
+    
+    int id = macro_upload_id;
+    macro_upload_id = -1;
+    if (macro_upload_received != macro_upload_len) {
+        command_printf("MACRO_ERROR:incomplete\n");
+    } else if (!macro_validate(macro_upload, macro_upload_len)) {
+        command_printf("MACRO_ERROR:bad_code\n");
+    } else if (!macro_add((uint8_t)id, macro_upload, macro_upload_len)) {
+        command_printf("MACRO_ERROR:store_full\n");
+    } else {
+        LOG_INFO("Macro %d stored, %u bytes", id, macro_upload_len);
+        command_printf("MACRO_SAVED:%d,%u\n", id, macro_upload_len);
+    }
+}
+
+static void cmd_macro_list(const char *args) {
+    (void)args;
+    // MACRO_LIST:used=<bytes>,capacity=<bytes>,macros=<id>:<len>/...
+    command_printf("MACRO_LIST:used=%u,capacity=%u,macros=",
+                   macro_store_used(), (unsigned)MACRO_STORE_CAPACITY);
+    uint8_t count = macro_store_count();
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t id;
+        uint16_t len;
+        macro_store_entry(i, &id, &len);
+        command_printf(i + 1 < count ? "%u:%u/" : "%u:%u", id, len);
+    }
+    command_printf("\n");
+}
+
+static void cmd_macro_record(const char *args) {
+    // Record the mapped output of live input as macro <id> until MACRO_RECORD_STOP
+    char *end;
+    int id = parse_macro_id(args, &end);
+    if (id < 0 || *end != '\0') {
+        command_printf("MACRO_ERROR:invalid\n");
+        return;
+    }
+    
+    macro_record_start((uint8_t)id);
+    command_printf("MACRO_RECORDING:%d\n", id);
+}
+
+static void cmd_macro_record_stop(const char *args) {
+    (void)args;
+    if (!macro_record_active()) {
+        command_printf("MACRO_ERROR:not_recording\n");
+        return;
+    }
+    
+    macro_record_result_t result;
+    bool saved = macro_record_stop(&result);
+    if (result.len == 0) {
+        command_printf("MACRO_ERROR:empty\n");
+    } else if (!saved) {
+        command_printf("MACRO_ERROR:store_full\n");
+    } else {
+        LOG_INFO("Macro %u recorded, %lu events, %u bytes",
+                 result.macro_id, (unsigned long)result.events, result.len);
+        command_printf("MACRO_RECORDED:%u,%u,events=%lu,steps=%lu,duration_us=%lu,truncated=%d\n",
+                       result.macro_id, result.len,
+                       (unsigned long)result.events,
+                       (unsigned long)result.steps,
+                       (unsigned long)result.duration_us,
+                       result.truncated ? 1 : 0);
+    }
+}
+
+static void cmd_macro_run(const char *args) {
+    // Start a stored macro as if a mapped button had been pressed and released
+    char *end;
+    int id = parse_macro_id(args, &end);
+    if (id < 0 || *end != '\0') {
+        command_printf("MACRO_ERROR:invalid\n");
+    } else if (macro_execute((uint8_t)id, MACRO_NO_TRIGGER)) {
+        command_printf("MACRO_STARTED:%d\n", id);
+    } else {
+        command_printf("MACRO_ERROR:not_started\n");
+    }
+}
+
+static uint16_t prof_stream_read(char *buf, uint16_t size) {
+    // One row per task
+    const char *name;
+    uint32_t budget_us;
+    sched_task_stats_t stats;
+    if (!sched_get_task_stats(reply_stream_pos, &name, &budget_us, &stats)) {
+        return 0;
+    }
+    
+    uint32_t avg = stats.calls ? (uint32_t)(stats.cycles_total / stats.calls) : 0;
+    int len = snprintf(buf, size, "PROF_TASK:%u,%s,calls=%lu,avg=%lu,max=%lu,overruns=%lu,budget_us=%lu\n",
+                       reply_stream_pos, name,
+                       (unsigned long)stats.calls,
+                       (unsigned long)avg,
+                       (unsigned long)stats.cycles_max,
+                       (unsigned long)stats.overruns,
+                       (unsigned long)budget_us);
+    reply_stream_pos++;
+    return (len > 0 && len < size) ? (uint16_t)len : 0;
+}
+
+static void cmd_prof(const char *args) {
+    (void)args;
+    // Per-task run time in cycles; the PROF_TASK rows follow
+    command_printf("PROF:tasks=%u,cycle_hz=%lu,trace=%u/%u\n",
+                   sched_task_count(), (unsigned long)hal_cycle_hz(),
+                   sched_trace_count(), SCHED_TRACE_SIZE);
+    reply_stream_start(prof_stream_read, "PROF_END\n");
+}
+
+static void cmd_prof_reset(const char *args) {
+    (void)args;
+    sched_reset_stats();
+    command_printf("PROF_RESET\n");
+}
+
+static uint16_t trace_stream_read(char *buf, uint16_t size) {
+    // As many "T:<task>,<start_us>,<cycles>" rows as fit
+    uint16_t len = 0;
+    sched_trace_entry_t entry;
+    while (sched_trace_get(reply_stream_pos, &entry)) {
+        char row[40];
+        int row_len = snprintf(row, sizeof(row), "T:%u,%lu,%lu\n", entry.task_id,
+                               (unsigned long)entry.start_us, (unsigned long)entry.cycles);
+        if (row_len <= 0 || len + row_len > size) {
+            break;
         }
-    } else if (cmd_pos < CMD_BUFFER_SIZE - 1) {
-        // Only add printable characters
-        if (c >= 32 && c < 127) {
-            cmd_buffer[cmd_pos++] = (char)c;
+        memcpy(&buf[len], row, (size_t)row_len);
+        len += (uint16_t)row_len;
+        reply_stream_pos++;
+    }
+    return len;
+}
+
+static void cmd_prof_trace_get(const char *args) {
+    (void)args;
+    command_printf("PROF_TRACE:count=%u,cycle_hz=%lu\n",
+                   sched_trace_count(), (unsigned long)hal_cycle_hz());
+    reply_stream_start(trace_stream_read, "PROF_TRACE_END\n");
+}
+
+static void cmd_prof_trace_start(const char *args) {
+    (void)args;
+    sched_trace_start();
+    command_printf("PROF_TRACE_STARTED:%u\n", SCHED_TRACE_SIZE);
+}
+
+static void cmd_stats(const char *args) {
+    // Pipeline counters; "STATS RESET" clears them in the same read
+    bool reset = strcmp(args, "RESET") == 0;
+    if (args[0] != '\0' && !reset) {
+        command_printf("STATS_ERROR:invalid\n");
+        return;
+    }
+    
+    counters_t counters;
+    counters_snapshot(&counters, reset);
+    command_printf("STATS:");
+    for (uint8_t i = 0; i < COUNTER_COUNT; i++) {
+        command_printf(i + 1 < COUNTER_COUNT ? "%s=%lu," : "%s=%lu\n",
+                       counters_name((counter_id_t)i), (unsigned long)counters.values[i]);
+    }
+}
+
+static void cmd_stream_start(const char *args) {
+    // Push input frames at <rate> samples per second (default 1000)
+    uint32_t rate = TELEMETRY_MAX_RATE;
+    if (args[0] != '\0') {
+        char *end;
+        rate = (uint32_t)strtoul(args, &end, 10);
+        if (*end != '\0') {
+            rate = 0;
         }
+    }
+    
+    if (telemetry_start(rate)) {
+        command_printf("STREAM_STARTED:%lu\n", (unsigned long)rate);
+        sched_wake_at(telemetry_task_id, telemetry_next_deadline_us());
     } else {
-        // Buffer full, reset to prevent overflow
-        cmd_pos = 0;
+        command_printf("STREAM_ERROR:invalid\n");
     }
 }
 
+static void cmd_stream_stop(const char *args) {
+    (void)args;
+    telemetry_stats_t stats;
+    telemetry_stop();
+    telemetry_get_stats(&stats);
+    command_printf("STREAM_STOPPED:frames=%lu,bytes=%lu,deferred=%lu\n",
+                   (unsigned long)stats.frames,
+                   (unsigned long)stats.bytes,
+                   (unsigned long)stats.deferred);
+}
+
+// Sorted by name (command_init checks the order)
+static const command_t commands[] = {
+    {"BENCH",               cmd_bench},
+    {"CONSOLE_STATS",       cmd_console_stats},
+    {"CONSOLE_STATS_RESET", cmd_console_stats_reset},
+    {"DEBUG_GET",           cmd_debug_get},
+    {"DEBUG_INFO",          cmd_debug_info},
+    {"DEBUG_START",         cmd_debug_start},
+    {"DEBUG_STOP",          cmd_debug_stop},
+    {"DECODE_STATS",        cmd_decode_stats},
+    {"DECODE_STATS_RESET",  cmd_decode_stats_reset},
+    {"HID_KEEPALIVE",       cmd_hid_keepalive},
+    {"HID_STATS",           cmd_hid_stats},
+    {"HID_STATS_RESET",     cmd_hid_stats_reset},
+    {"LAT_STATS",           cmd_lat_stats},
+    {"LAT_STATS_RESET",     cmd_lat_stats_reset},
+    {"LOG_CLEAR",           cmd_log_clear},
+    {"LOG_COUNT",           cmd_log_count},
+    {"LOG_GET",             cmd_log_get},
+    {"LOG_LEVEL",           cmd_log_level},
+    {"LOG_STATUS",          cmd_log_status},
+    {"MACRO_BEGIN",         cmd_macro_begin},
+    {"MACRO_DATA",          cmd_macro_data},
+    {"MACRO_DEL",           cmd_macro_del},
+    {"MACRO_END",           cmd_macro_end},
+    {"MACRO_LIST",          cmd_macro_list},
+    {"MACRO_RECORD",        cmd_macro_record},
+    {"MACRO_RECORD_STOP",   cmd_macro_record_stop},
+    {"MACRO_RUN",           cmd_macro_run},
+    {"PROF",                cmd_prof},
+    {"PROF_RESET",          cmd_prof_reset},
+    {"PROF_TRACE_GET",      cmd_prof_trace_get},
+    {"PROF_TRACE_START",    cmd_prof_trace_start},
+    {"STATS",               cmd_stats},
+    {"STREAM_START",        cmd_stream_start},
+    {"STREAM_STOP",         cmd_stream_stop},
+};
+
 /**
  * Blink LED to indicate status
+ * @return Milliseconds until the LED next changes
  */
-static void status_led_update(void) {
+static uint32_t status_led_update(void) {
     static uint32_t last_blink = 0;
     static bool led_state = false;
     uint32_t now = to_ms_since_boot(get_absolute_time());
@@ -241,6 +751,175 @@ static void status_led_update(void) {
         gpio_put(LED_PIN, led_state);
         last_blink = now;
     }
+    
+    return blink_interval - (now - last_blink);
+}
+
+/**
+ * Update application state from the input device connection
+ */
+static void app_state_update(void) {
+    if (current_state == STATE_WAITING_FOR_INPUT) {
+        if (usb_host_device_connected()) {
+            if (debug_mode_enabled) {
+                current_state = STATE_DEBUG_MODE;
+            } else {
+                current_state = STATE_ACTIVE;
+            }
+            LOG_INFO("Gamepad connected");
+        }
+    } else if (current_state == STATE_ACTIVE || current_state == STATE_DEBUG_MODE) {
+        if (!usb_host_device_connected()) {
+            current_state = STATE_WAITING_FOR_INPUT;
+            LOG_INFO("Gamepad disconnected");
+        }
+    }
+    
+    // Check for config mode entry (could be via special button combo)
+    if (usb_device_config_mode_requested()) {
+        current_state = STATE_CONFIG_MODE;
+        LOG_INFO("Entering configuration mode");
+    }
+}
+
+//--------------------------------------------------------------------
+// Scheduler tasks
+//
+// The USB stacks run first, then input and everything that feeds the
+// output composer, so a report received in one pass is transmitted in
+// the same pass.
+//--------------------------------------------------------------------
+
+enum {
+    PRIO_USB_DEVICE,
+    PRIO_USB_HOST,
+    PRIO_INPUT,
+    PRIO_MOUSE,
+    PRIO_MACRO,
+    PRIO_OUTPUT,
+    PRIO_TELEMETRY,
+    PRIO_SERIAL,
+    PRIO_REPLY_STREAM,
+    PRIO_STATUS
+};
+
+static int mouse_task_id = -1;
+static bool mouse_ticking = false;
+
+static void usb_device_sched_task(void) {
+    usb_device_task();
+    sched_wake_at(sched_current_task(), usb_device_next_deadline_us());
+}
+
+static void input_task(void) {
+    uint8_t connected = usb_host_get_connected_devices();
+    uint8_t updated = usb_host_take_updated_devices();
+    
+    for (uint8_t device = 0; device < USB_HOST_MAX_DEVICES; device++) {
+        uint8_t device_bit = (uint8_t)(1u << device);
+        gamepad_state_t state;
+        
+        if (!(connected & device_bit)) {
+            // A disconnected device stops contributing, releasing its mappings
+            remapping_remove_device(device);
+        } else if ((updated & device_bit) && usb_host_get_gamepad_state(device, &state)) {
+            remapping_process_input(device, &state, usb_host_get_input_time(device));
+        }
+    }
+    
+    // Stick-to-mouse runs on its own 1 ms tick while the stick is deflected
+    if (!mouse_ticking && remapping_mouse_active()) {
+        mouse_ticking = true;
+        sched_wake_at(mouse_task_id, hal_time_us());
+    }
+}
+
+static void mouse_task(void) {
+    remapping_mouse_task();
+    
+    mouse_ticking = remapping_mouse_active();
+    if (mouse_ticking) {
+        sched_wake_at(sched_current_task(), hal_time_us() + OUTPUT_FRAME_US);
+    }
+}
+
+static void macro_sched_task(void) {
+    // Macros are held while debugging; DEBUG_STOP resumes them
+    if (debug_mode_enabled) {
+        return;
+    }
+    
+    macro_task();
+    sched_wake_at(sched_current_task(), macro_next_deadline_us());
+}
+
+static void output_sched_task(void) {
+    output_task();
+    sched_wake_at(sched_current_task(), output_next_deadline_us());
+}
+
+static void telemetry_sched_task(void) {
+    telemetry_task();
+    sched_wake_at(sched_current_task(), telemetry_next_deadline_us());
+}
+
+static bool reply_stream_pending(void) {
+    // Runs again as the host drains the TX FIFO
+    return command_reply_pending() ||
+           (reply_stream_fn && command_reply_queued() == 0 &&
+            command_write_space() >= REPLY_STREAM_CHUNK);
+}
+
+static void reply_stream_task(void) {
+    char chunk[REPLY_STREAM_CHUNK];
+    
+    // Queued reply lines go first, then the streamed reply fills the TX
+    // FIFO and lets it drain
+    command_reply_drain();
+    while (reply_stream_fn && command_reply_queued() == 0 &&
+           command_write_space() >= REPLY_STREAM_CHUNK) {
+        uint16_t len = reply_stream_fn(chunk, sizeof(chunk));
+        if (len == 0) {
+            command_printf("%s", reply_stream_end);
+            reply_stream_fn = NULL;
+            break;
+        }
+        command_write(chunk, len);
+    }
+    command_flush();
+}
+
+static void status_task(void) {
+    app_state_update();
+    
+    uint32_t next_ms = status_led_update();
+    sched_wake_at(sched_current_task(), hal_time_us() + (uint64_t)next_ms * 1000u);
+}
+
+/**
+ * Register the main loop tasks with the scheduler
+ */
+static void sched_setup(void) {
+    sched_init();
+    
+    usb_device_task_id = sched_add_task("usb_device", usb_device_sched_task, PRIO_USB_DEVICE, 0,
+                                        usb_device_task_pending);
+    sched_add_task("usb_host", usb_host_task, PRIO_USB_HOST, 0, usb_host_task_pending);
+    sched_add_task("input", input_task, PRIO_INPUT,
+                   SCHED_EVENT_HID_INPUT | SCHED_EVENT_HOST_CONNECT, NULL);
+    mouse_task_id = sched_add_task("mouse", mouse_task, PRIO_MOUSE, 0, NULL);
+    sched_add_task("macro", macro_sched_task, PRIO_MACRO, SCHED_EVENT_MACRO, NULL);
+    sched_add_task("output", output_sched_task, PRIO_OUTPUT, SCHED_EVENT_OUTPUT, NULL);
+    telemetry_task_id = sched_add_task("telemetry", telemetry_sched_task, PRIO_TELEMETRY, 0, NULL);
+    sched_add_task("serial", command_task, PRIO_SERIAL, SCHED_EVENT_SERIAL_RX, NULL);
+    sched_add_task("reply_stream", reply_stream_task, PRIO_REPLY_STREAM, 0, reply_stream_pending);
+    int status_id = sched_add_task("status", status_task, PRIO_STATUS, SCHED_EVENT_HOST_CONNECT, NULL);
+    
+    // Run once at startup to set up the LED and state
+    sched_wake_at(status_id, 0);
+    
+    // Commands that arrived before the task was registered
+    sched_signal(SCHED_EVENT_SERIAL_RX);
 }
 
 /**
@@ -253,6 +932,9 @@ int main(void) {
     // Initialize logging system
     logging_init();
     LOG_INFO("Joystick Converter starting...");
+    if (!console_ready) {
+        LOG_ERROR("UART console unavailable (no free DMA channel)");
+    }
     
     // Load configuration from flash
     if (!config_load()) {
@@ -279,6 +961,9 @@ int main(void) {
         LOG_INFO("USB device initialized");
     }
     
+    // Initialize output composer
+    output_init();
+    
     // Initialize remapping engine
     remapping_init();
     LOG_INFO("Remapping engine initialized");
@@ -287,53 +972,17 @@ int main(void) {
     macro_init();
     LOG_INFO("Macro system initialized");
     
+    // Serial commands from the configuration tool
+    if (!command_init(commands, sizeof(commands) / sizeof(commands[0]))) {
+        LOG_ERROR("Command table is not sorted");
+    }
+    
     LOG_INFO("Initialization complete. Waiting for gamepad...");
     
-    // Main loop
-    while (1) {
-        // Update LED status
-        status_led_update();
-        
-        // Process USB host (gamepad input)
-        usb_host_task();
-        
-        // Process USB device (output)
-        usb_device_task();
-        
-        // Process macro execution (skip in debug mode)
-        if (!debug_mode_enabled) {
-            macro_task();
-        }
-        
-        // Handle serial commands for debug mode
-        handle_serial_commands();
-        
-        // Update application state
-        if (current_state == STATE_WAITING_FOR_INPUT) {
-            if (usb_host_device_connected()) {
-                if (debug_mode_enabled) {
-                    current_state = STATE_DEBUG_MODE;
-                } else {
-                    current_state = STATE_ACTIVE;
-                }
-                LOG_INFO("Gamepad connected");
-            }
-        } else if (current_state == STATE_ACTIVE || current_state == STATE_DEBUG_MODE) {
-            if (!usb_host_device_connected()) {
-                current_state = STATE_WAITING_FOR_INPUT;
-                LOG_INFO("Gamepad disconnected");
-            }
-        }
-        
-        // Check for config mode entry (could be via special button combo)
-        if (usb_device_config_mode_requested()) {
-            current_state = STATE_CONFIG_MODE;
-            LOG_INFO("Entering configuration mode");
-        }
-        
-        // Small delay to prevent busy waiting and reduce power consumption
-        sleep_ms(1);
-    }
+    // Main loop: tasks run when their events or deadlines fire, and the
+    // core sleeps in between
+    sched_setup();
+    sched_run();
     
     return 0;
 }
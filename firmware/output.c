@@ -0,0 +1,282 @@
+/**
+ * Output Frame Composer Implementation
+ */
+
+#include "output.h"
+#include "usb_device.h"
+#include "sched.h"
+#include "hal.h"
+#include <string.h>
+
+#define OUTPUT_MAX_KEYS          6
+#define OUTPUT_NUM_MODIFIERS     8
+#define OUTPUT_NUM_MOUSE_BUTTONS 5
+#define OUTPUT_MOUSE_MAX         127
+
+// HID keyboard modifier usage range
+#define KEY_MODIFIER_FIRST 0xE0
+#define KEY_MODIFIER_LAST  0xE7
+
+// Report slots, one per HID report ID
+typedef enum {
+    OUTPUT_REPORT_GAMEPAD,
+    OUTPUT_REPORT_KEYBOARD,
+    OUTPUT_REPORT_MOUSE,
+    OUTPUT_REPORT_COUNT
+} output_report_t;
+
+// Held key with reference count
+typedef struct {
+    uint8_t keycode;
+    uint8_t refs;
+} held_key_t;
+
+static struct {
+    // Gamepad
+    uint16_t gamepad_buttons;
+    int16_t gamepad_axes[6];
+
+    // Keyboard
+    held_key_t keys[OUTPUT_MAX_KEYS];
+    uint8_t num_keys;
+    uint8_t modifier_refs[OUTPUT_NUM_MODIFIERS];
+
+    // Mouse
+    uint8_t mouse_button_refs[OUTPUT_NUM_MOUSE_BUTTONS];
+    int32_t mouse_x;
+    int32_t mouse_y;
+    int32_t mouse_wheel;
+
+    bool dirty[OUTPUT_REPORT_COUNT];
+    uint64_t next_send_us[OUTPUT_REPORT_COUNT];
+    uint64_t input_us[OUTPUT_REPORT_COUNT];  // Oldest input behind an unsent change
+} frame;
+
+// Input being applied by the current contributor (0 = none)
+static uint64_t current_input_us = 0;
+
+void output_init(void) {
+    memset(&frame, 0, sizeof(frame));
+    current_input_us = 0;
+}
+
+void output_set_input_time(uint64_t input_us) {
+    current_input_us = input_us;
+}
+
+uint64_t output_get_input_time(void) {
+    return current_input_us;
+}
+
+static void mark_dirty(output_report_t report) {
+    frame.dirty[report] = true;
+    if (frame.input_us[report] == 0) {
+        frame.input_us[report] = current_input_us;
+    }
+    sched_signal(SCHED_EVENT_OUTPUT);
+}
+
+void output_set_gamepad(uint16_t buttons, const gamepad_state_t *input) {
+    if (!input) {
+        return;
+    }
+
+    // Triggers (0-255) are scaled to the full int16 range used for axes
+    int16_t axes[6] = {
+        input->left_x,
+        input->left_y,
+        input->right_x,
+        input->right_y,
+        (int16_t)(input->left_trigger * 257 - 32768),
+        (int16_t)(input->right_trigger * 257 - 32768)
+    };
+
+    if (buttons != frame.gamepad_buttons ||
+        memcmp(axes, frame.gamepad_axes, sizeof(axes)) != 0) {
+        frame.gamepad_buttons = buttons;
+        memcpy(frame.gamepad_axes, axes, sizeof(axes));
+        mark_dirty(OUTPUT_REPORT_GAMEPAD);
+    }
+}
+
+void output_key_press(uint8_t keycode) {
+    if (keycode == 0) {
+        return;
+    }
+
+    if (keycode >= KEY_MODIFIER_FIRST && keycode <= KEY_MODIFIER_LAST) {
+        if (frame.modifier_refs[keycode - KEY_MODIFIER_FIRST]++ == 0) {
+            mark_dirty(OUTPUT_REPORT_KEYBOARD);
+        }
+        return;
+    }
+
+    for (uint8_t i = 0; i < frame.num_keys; i++) {
+        if (frame.keys[i].keycode == keycode) {
+            frame.keys[i].refs++;
+            return;
+        }
+    }
+
+    // Boot keyboard reports hold at most six keys; extra keys are ignored
+    if (frame.num_keys < OUTPUT_MAX_KEYS) {
+        frame.keys[frame.num_keys].keycode = keycode;
+        frame.keys[frame.num_keys].refs = 1;
+        frame.num_keys++;
+        mark_dirty(OUTPUT_REPORT_KEYBOARD);
+    }
+}
+
+void output_key_release(uint8_t keycode) {
+    if (keycode >= KEY_MODIFIER_FIRST && keycode <= KEY_MODIFIER_LAST) {
+        uint8_t *refs = &frame.modifier_refs[keycode - KEY_MODIFIER_FIRST];
+        if (*refs > 0 && --(*refs) == 0) {
+            mark_dirty(OUTPUT_REPORT_KEYBOARD);
+        }
+        return;
+    }
+
+    for (uint8_t i = 0; i < frame.num_keys; i++) {
+        if (frame.keys[i].keycode == keycode) {
+            if (--frame.keys[i].refs == 0) {
+                // Keep remaining keys in press order
+                memmove(&frame.keys[i], &frame.keys[i + 1],
+                        (frame.num_keys - i - 1) * sizeof(held_key_t));
+                frame.num_keys--;
+                mark_dirty(OUTPUT_REPORT_KEYBOARD);
+            }
+            return;
+        }
+    }
+}
+
+void output_mouse_button(uint8_t buttons, bool pressed) {
+    for (uint8_t i = 0; i < OUTPUT_NUM_MOUSE_BUTTONS; i++) {
+        if (!(buttons & (1u << i))) {
+            continue;
+        }
+
+        uint8_t *refs = &frame.mouse_button_refs[i];
+        if (pressed) {
+            if ((*refs)++ == 0) {
+                mark_dirty(OUTPUT_REPORT_MOUSE);
+            }
+        } else if (*refs > 0 && --(*refs) == 0) {
+            mark_dirty(OUTPUT_REPORT_MOUSE);
+        }
+    }
+}
+
+static bool mouse_motion_pending(void) {
+    return frame.mouse_x != 0 || frame.mouse_y != 0 || frame.mouse_wheel != 0;
+}
+
+void output_mouse_move(int16_t dx, int16_t dy, int8_t wheel) {
+    frame.mouse_x += dx;
+    frame.mouse_y += dy;
+    frame.mouse_wheel += wheel;
+
+    if (mouse_motion_pending()) {
+        mark_dirty(OUTPUT_REPORT_MOUSE);
+    }
+}
+
+// Take up to one report's worth of accumulated movement
+static int8_t take_motion(int32_t *accum) {
+    int32_t value = *accum;
+    if (value > OUTPUT_MOUSE_MAX) {
+        value = OUTPUT_MOUSE_MAX;
+    } else if (value < -OUTPUT_MOUSE_MAX) {
+        value = -OUTPUT_MOUSE_MAX;
+    }
+    *accum -= value;
+    return (int8_t)value;
+}
+
+static bool emit_gamepad(void) {
+    return usb_device_send_gamepad(frame.gamepad_buttons, frame.gamepad_axes, 6,
+                                   frame.input_us[OUTPUT_REPORT_GAMEPAD]);
+}
+
+static bool emit_keyboard(void) {
+    uint8_t modifiers = 0;
+    for (uint8_t i = 0; i < OUTPUT_NUM_MODIFIERS; i++) {
+        if (frame.modifier_refs[i] > 0) {
+            modifiers |= (uint8_t)(1u << i);
+        }
+    }
+
+    uint8_t keycodes[OUTPUT_MAX_KEYS];
+    for (uint8_t i = 0; i < frame.num_keys; i++) {
+        keycodes[i] = frame.keys[i].keycode;
+    }
+
+    return usb_device_send_keyboard(modifiers, keycodes, frame.num_keys,
+                                    frame.input_us[OUTPUT_REPORT_KEYBOARD]);
+}
+
+static bool emit_mouse(void) {
+    uint8_t buttons = 0;
+    for (uint8_t i = 0; i < OUTPUT_NUM_MOUSE_BUTTONS; i++) {
+        if (frame.mouse_button_refs[i] > 0) {
+            buttons |= (uint8_t)(1u << i);
+        }
+    }
+
+    // Only consume movement once the report has been accepted
+    int32_t x = frame.mouse_x;
+    int32_t y = frame.mouse_y;
+    int32_t wheel = frame.mouse_wheel;
+    int8_t rx = take_motion(&x);
+    int8_t ry = take_motion(&y);
+    int8_t rw = take_motion(&wheel);
+
+    if (!usb_device_send_mouse(buttons, rx, ry, rw, frame.input_us[OUTPUT_REPORT_MOUSE])) {
+        // Mouse output disabled; don't let movement pile up for later
+        frame.mouse_x = 0;
+        frame.mouse_y = 0;
+        frame.mouse_wheel = 0;
+        return false;
+    }
+
+    frame.mouse_x = x;
+    frame.mouse_y = y;
+    frame.mouse_wheel = wheel;
+    return true;
+}
+
+void output_task(void) {
+    static bool (*const emitters[OUTPUT_REPORT_COUNT])(void) = {
+        emit_gamepad,
+        emit_keyboard,
+        emit_mouse
+    };
+
+    uint64_t now = hal_time_us();
+
+    // At most one report per report ID per USB interval
+    for (uint8_t i = 0; i < OUTPUT_REPORT_COUNT; i++) {
+        if (!frame.dirty[i] || now < frame.next_send_us[i]) {
+            continue;
+        }
+
+        // Reports for a disabled output type are dropped; the state goes out
+        // with the next change once the type is enabled
+        frame.next_send_us[i] = now + OUTPUT_FRAME_US;
+        emitters[i]();
+        frame.input_us[i] = 0;
+
+        // Carried-over mouse movement goes out in the next interval
+        frame.dirty[i] = (i == OUTPUT_REPORT_MOUSE) && mouse_motion_pending();
+    }
+}
+
+uint64_t output_next_deadline_us(void) {
+    uint64_t next = UINT64_MAX;
+    for (uint8_t i = 0; i < OUTPUT_REPORT_COUNT; i++) {
+        if (frame.dirty[i] && frame.next_send_us[i] < next) {
+            next = frame.next_send_us[i];
+        }
+    }
+    return next;
+}
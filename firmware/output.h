@@ -0,0 +1,89 @@
+/**
+ * Output Frame Composer
+ *
+ * Accumulates the gamepad, keyboard and mouse output contributed by the
+ * remapping engine and the macro system, and emits at most one HID report
+ * per report ID per USB interval.
+ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "usb_host.h"
+
+// HID IN endpoint polling interval (bInterval = 1 ms in usb_descriptors.c)
+#define OUTPUT_FRAME_US 1000
+
+/**
+ * Initialize output composer and clear accumulated state
+ */
+void output_init(void);
+
+/**
+ * Attribute the following changes to an input report
+ * A report carries the oldest input that changed it since it was last
+ * emitted; usb_device measures the latency when that report completes.
+ * @param input_us When the input was received (hal_time_us), 0 for none
+ */
+void output_set_input_time(uint64_t input_us);
+
+/**
+ * Get the input the current changes are attributed to
+ * @return Receive time in us, 0 for none
+ */
+uint64_t output_get_input_time(void);
+
+/**
+ * Set gamepad output state
+ * @param buttons Output button bitmap (after remapping)
+ * @param input Source of axis and trigger values
+ */
+void output_set_gamepad(uint16_t buttons, const gamepad_state_t *input);
+
+/**
+ * Press a keyboard key
+ * Keys are reference counted, so several contributors can hold the same key.
+ * Modifier usages (0xE0-0xE7) are reported in the modifier byte.
+ * @param keycode HID keyboard usage code
+ */
+void output_key_press(uint8_t keycode);
+
+/**
+ * Release a keyboard key previously pressed with output_key_press
+ * @param keycode HID keyboard usage code
+ */
+void output_key_release(uint8_t keycode);
+
+/**
+ * Press or release mouse buttons (reference counted per button)
+ * @param buttons Mouse button bitmask
+ * @param pressed true to press, false to release
+ */
+void output_mouse_button(uint8_t buttons, bool pressed);
+
+/**
+ * Add relative mouse movement
+ * Movement is summed until the next mouse report; anything beyond the
+ * report range is carried into following reports.
+ * @param dx X movement
+ * @param dy Y movement
+ * @param wheel Wheel movement
+ */
+void output_mouse_move(int16_t dx, int16_t dy, int8_t wheel);
+
+/**
+ * Output task - emits changed reports
+ * Changes raise SCHED_EVENT_OUTPUT; reports held back by the per-interval
+ * limit fall due at output_next_deadline_us().
+ */
+void output_task(void);
+
+/**
+ * Get the time the next held-back report may be emitted
+ * @return Absolute time in us, or UINT64_MAX if nothing is waiting
+ */
+uint64_t output_next_deadline_us(void);
+
+#endif // OUTPUT_H
@@ -5,124 +5,218 @@
 #include "remapping.h"
 #include "config.h"
 #include "usb_device.h"
+#include "output.h"
 #include "macro.h"
-#include <stdio.h>
+#include "macro_record.h"
+#include "trace.h"
+#include <stdlib.h>
 #include <string.h>
 
 static uint16_t previous_buttons = 0;
-static gamepad_state_t last_input = {0};
+static gamepad_state_t last_input = {0};  // Merged input of all devices
+
+// Latest input per device slot
+static gamepad_state_t device_inputs[USB_HOST_MAX_DEVICES];
+static uint8_t active_devices = 0;  // Bitmask of slots contributing input
 
 void remapping_init(void) {
-    printf("Remapping: Initializing\n");
+    TRACE_INFO("Remapping: Initializing");
     previous_buttons = 0;
     memset(&last_input, 0, sizeof(last_input));
+    memset(device_inputs, 0, sizeof(device_inputs));
+    active_devices = 0;
 }
 
-void remapping_process_input(const gamepad_state_t *input) {
-    if (!input) {
-        return;
+// Pick the value further from center
+static inline int16_t merge_axis(int16_t a, int16_t b) {
+    return abs(b) > abs(a) ? b : a;
+}
+
+/**
+ * Merge the input of every active device into one state
+ */
+static void merge_inputs(gamepad_state_t *merged) {
+    memset(merged, 0, sizeof(*merged));
+    
+    uint8_t active = active_devices;
+    while (active) {
+        const gamepad_state_t *input = &device_inputs[__builtin_ctz(active)];
+        active &= (uint8_t)(active - 1);
+        
+        merged->buttons |= input->buttons;
+        merged->left_x = merge_axis(merged->left_x, input->left_x);
+        merged->left_y = merge_axis(merged->left_y, input->left_y);
+        merged->right_x = merge_axis(merged->right_x, input->right_x);
+        merged->right_y = merge_axis(merged->right_y, input->right_y);
+        if (input->left_trigger > merged->left_trigger) {
+            merged->left_trigger = input->left_trigger;
+        }
+        if (input->right_trigger > merged->right_trigger) {
+            merged->right_trigger = input->right_trigger;
+        }
+        if (input->dpad_x != 0) {
+            merged->dpad_x = input->dpad_x;
+        }
+        if (input->dpad_y != 0) {
+            merged->dpad_y = input->dpad_y;
+        }
     }
+}
+
+/**
+ * Apply button-to-button mappings to a gamepad button bitmap
+ * Buttons mapped to anything else are removed from the gamepad output.
+ */
+static uint16_t remap_gamepad_buttons(uint16_t buttons) {
+    uint16_t mapped = buttons & config_get_mapped_buttons();
+    uint16_t result = buttons & (uint16_t)~config_get_mapped_buttons();
     
+    while (mapped) {
+        const button_mapping_t *mapping = config_get_button_mapping((uint8_t)__builtin_ctz(mapped));
+        mapped &= (uint16_t)(mapped - 1);
+        
+        if (mapping->type == MAPPING_TYPE_BUTTON) {
+            result |= mapping->target_value;
+        }
+    }
+    
+    return result;
+}
+
+/**
+ * Apply mappings to the merged input
+ */
+static void apply_input(const gamepad_state_t *input) {
     config_t *cfg = config_get();
     
     // Process button events
     uint16_t button_changes = input->buttons ^ previous_buttons;
     
-    // Check each button for changes
-    for (uint8_t i = 0; i < 16; i++) {
-        uint16_t button_bit = (1 << i);
+    // Visit only the changed buttons, lowest bit first
+    while (button_changes) {
+        uint8_t i = (uint8_t)__builtin_ctz(button_changes);
+        uint16_t button_bit = (uint16_t)(1u << i);
+        button_changes &= (uint16_t)(button_changes - 1);  // Clear lowest set bit
         
-        if (button_changes & button_bit) {
-            // Button state changed
-            bool pressed = (input->buttons & button_bit) != 0;
-            
-            // Look up mapping for this button
-            button_mapping_t *mapping = config_find_mapping(button_bit);
-            
-            if (mapping) {
-                // Apply mapping
-                switch (mapping->type) {
-                    case MAPPING_TYPE_BUTTON:
-                        // Map to different button
-                        printf("Remapping: Button 0x%04X -> Button 0x%04X (%s)\n", 
-                               button_bit, mapping->target_value, pressed ? "pressed" : "released");
-                        break;
-                        
-                    case MAPPING_TYPE_KEY:
-                        // Map to keyboard key
-                        if (pressed) {
-                            uint8_t keycode = (uint8_t)mapping->target_value;
-                            usb_device_send_keyboard(0, &keycode, 1);
-                            printf("Remapping: Button 0x%04X -> Key 0x%02X\n", 
-                                   button_bit, keycode);
-                        } else {
-                            // Release all keys - pass empty array
-                            uint8_t no_keys = 0;
-                            usb_device_send_keyboard(0, &no_keys, 0);
-                        }
-                        break;
-                        
-                    case MAPPING_TYPE_MOUSE_BUTTON:
-                        // Map to mouse button
-                        if (pressed) {
-                            usb_device_send_mouse((uint8_t)mapping->target_value, 0, 0, 0);
-                            printf("Remapping: Button 0x%04X -> Mouse Button 0x%02X\n", 
-                                   button_bit, mapping->target_value);
-                        } else {
-                            usb_device_send_mouse(0, 0, 0, 0);
-                        }
-                        break;
-                        
-                    case MAPPING_TYPE_MACRO:
-                        // Execute macro
-                        if (pressed) {
-                            macro_execute(mapping->macro_id);
-                            printf("Remapping: Button 0x%04X -> Macro %d\n", 
-                                   button_bit, mapping->macro_id);
-                        }
-                        break;
-                        
-                    default:
-                        break;
-                }
-            } else {
-                // No mapping, pass through
-                if (cfg->output_type == OUTPUT_TYPE_GAMEPAD) {
-                    // Passthrough mode - just send the original input
-                }
+        // Button state changed
+        bool pressed = (input->buttons & button_bit) != 0;
+        
+        // Look up mapping for this button
+        const button_mapping_t *mapping = config_get_button_mapping(i);
+        
+        if (mapping) {
+            // Apply mapping
+            switch (mapping->type) {
+                case MAPPING_TYPE_BUTTON:
+                    // Map to different button (applied when composing gamepad output)
+                    TRACE_DEBUG("Remapping: Button 0x%04X -> Button 0x%04X (%s)", 
+                                button_bit, mapping->target_value, pressed ? "pressed" : "released");
+                    break;
+                    
+                case MAPPING_TYPE_KEY:
+                    // Map to keyboard key
+                    if (pressed) {
+                        uint8_t keycode = (uint8_t)mapping->target_value;
+                        output_key_press(keycode);
+                        macro_record_key(keycode, true);
+                        TRACE_DEBUG("Remapping: Button 0x%04X -> Key 0x%02X", 
+                                    button_bit, keycode);
+                    } else {
+                        output_key_release((uint8_t)mapping->target_value);
+                        macro_record_key((uint8_t)mapping->target_value, false);
+                    }
+                    break;
+                    
+                case MAPPING_TYPE_MOUSE_BUTTON:
+                    // Map to mouse button
+                    output_mouse_button((uint8_t)mapping->target_value, pressed);
+                    macro_record_mouse_button((uint8_t)mapping->target_value, pressed);
+                    if (pressed) {
+                        TRACE_DEBUG("Remapping: Button 0x%04X -> Mouse Button 0x%02X", 
+                                    button_bit, mapping->target_value);
+                    }
+                    break;
+                    
+                case MAPPING_TYPE_MACRO:
+                    // Execute macro; the release ends JUMP_IF_HELD / WAIT_RELEASE
+                    if (pressed) {
+                        macro_execute(mapping->macro_id, button_bit);
+                        TRACE_DEBUG("Remapping: Button 0x%04X -> Macro %d", 
+                                    button_bit, mapping->macro_id);
+                    } else {
+                        macro_trigger_released(button_bit);
+                    }
+                    break;
+                    
+                default:
+                    break;
             }
         }
     }
     
-    // If no mappings are active, send gamepad data in passthrough mode
-    if (cfg->output_type == OUTPUT_TYPE_GAMEPAD && cfg->num_mappings == 0) {
-        int16_t axes[6] = {
-            input->left_x,
-            input->left_y,
-            input->right_x,
-            input->right_y,
-            (int16_t)input->left_trigger,
-            (int16_t)input->right_trigger
-        };
-        usb_device_send_gamepad(input->buttons, axes, 6);
+    // Compose gamepad output: unmapped buttons pass through
+    if (cfg->output_type == OUTPUT_TYPE_GAMEPAD) {
+        output_set_gamepad(remap_gamepad_buttons(input->buttons), input);
     }
     
-    // Process analog sticks for mouse emulation if needed
-    if (cfg->output_type == OUTPUT_TYPE_MOUSE || cfg->output_type == OUTPUT_TYPE_COMBO) {
-        // Convert right stick to mouse movement
-        int8_t mouse_x = (int8_t)(input->right_x / 256);
-        int8_t mouse_y = (int8_t)(input->right_y / 256);
-        
-        if (mouse_x != 0 || mouse_y != 0) {
-            usb_device_send_mouse(0, mouse_x, mouse_y, 0);
-        }
-    }
-    
-    // Update state
+    // Update state (stick-to-mouse motion is applied by remapping_mouse_task)
     previous_buttons = input->buttons;
     memcpy(&last_input, input, sizeof(gamepad_state_t));
 }
 
+void remapping_process_input(uint8_t device, const gamepad_state_t *input, uint64_t input_us) {
+    if (!input || device >= USB_HOST_MAX_DEVICES) {
+        return;
+    }
+    
+    device_inputs[device] = *input;
+    active_devices |= (uint8_t)(1u << device);
+    
+    gamepad_state_t merged;
+    merge_inputs(&merged);
+    
+    // Output changed by this input is measured from its receive time
+    output_set_input_time(input_us);
+    apply_input(&merged);
+    output_set_input_time(0);
+}
+
+void remapping_remove_device(uint8_t device) {
+    if (device >= USB_HOST_MAX_DEVICES || !(active_devices & (1u << device))) {
+        return;
+    }
+    
+    active_devices &= (uint8_t)~(1u << device);
+    memset(&device_inputs[device], 0, sizeof(device_inputs[device]));
+    
+    // The remaining devices (or neutral input) take over
+    gamepad_state_t merged;
+    merge_inputs(&merged);
+    apply_input(&merged);
+}
+
+bool remapping_mouse_active(void) {
+    config_t *cfg = config_get();
+    if (cfg->output_type != OUTPUT_TYPE_MOUSE && cfg->output_type != OUTPUT_TYPE_COMBO) {
+        return false;
+    }
+    
+    // Same dead zone as the conversion below
+    return (last_input.right_x / 256) != 0 || (last_input.right_y / 256) != 0;
+}
+
+void remapping_mouse_task(void) {
+    if (!remapping_mouse_active()) {
+        return;
+    }
+    
+    // Convert right stick to mouse movement
+    int8_t mouse_x = (int8_t)(last_input.right_x / 256);
+    int8_t mouse_y = (int8_t)(last_input.right_y / 256);
+    output_mouse_move(mouse_x, mouse_y, 0);
+    macro_record_mouse_move(mouse_x, mouse_y);
+}
+
 bool remapping_is_button_pressed(uint16_t buttons, uint16_t button) {
     return (buttons & button) != 0;
 }
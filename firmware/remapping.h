@@ -17,10 +17,36 @@
 void remapping_init(void);
 
 /**
- * Process input from gamepad and generate output
+ * Process input from one gamepad and generate output
+ * Input from all active devices is merged before mapping: buttons are
+ * OR'ed, each stick axis and d-pad axis takes the largest deflection and
+ * each trigger the highest value.
+ * @param device Input device slot (0 to USB_HOST_MAX_DEVICES - 1)
  * @param input Gamepad input state
+ * @param input_us When the input was received (usb_host_get_input_time),
+ *                 0 to leave the resulting output unmeasured
  */
-void remapping_process_input(const gamepad_state_t *input);
+void remapping_process_input(uint8_t device, const gamepad_state_t *input, uint64_t input_us);
+
+/**
+ * Stop merging input from a device (e.g. on disconnect)
+ * Buttons only that device held are released.
+ * @param device Input device slot
+ */
+void remapping_remove_device(uint8_t device);
+
+/**
+ * Check if the right stick is deflected while mouse output is enabled
+ * @return true if remapping_mouse_task would move the mouse
+ */
+bool remapping_mouse_active(void);
+
+/**
+ * Apply one interval of right-stick mouse movement from the latest input
+ * Call once per OUTPUT_FRAME_US while remapping_mouse_active() is true, so
+ * cursor speed does not depend on the controller's report rate.
+ */
+void remapping_mouse_task(void);
 
 /**
  * Check if a button is pressed (with debouncing)
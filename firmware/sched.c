@@ -0,0 +1,241 @@
+/**
+ * Cooperative Scheduler Implementation
+ */
+
+#include "sched.h"
+#include "hal.h"
+#include <string.h>
+
+typedef struct {
+    const char *name;
+    sched_task_fn_t fn;
+    sched_pending_fn_t pending;
+    uint32_t wake_events;
+    uint32_t events;        // Wake events received but not yet handled
+    uint8_t priority;
+    uint64_t deadline_us;
+    uint32_t budget_us;
+    uint32_t budget_cycles;
+    sched_task_stats_t stats;
+} sched_task_t;
+
+// Tasks sorted by priority; task IDs index task_order
+static sched_task_t tasks[SCHED_MAX_TASKS];
+static uint8_t task_order[SCHED_MAX_TASKS];
+static uint8_t num_tasks = 0;
+static int current_task = -1;
+
+// Events signaled since the last poll (set from ISRs and core 1)
+static volatile uint32_t pending_events = 0;
+
+// One-shot trace of task runs
+static sched_trace_entry_t trace[SCHED_TRACE_SIZE];
+static uint16_t trace_count = 0;
+static bool trace_active = false;
+static uint64_t trace_start_us = 0;
+
+void sched_init(void) {
+    memset(tasks, 0, sizeof(tasks));
+    num_tasks = 0;
+    current_task = -1;
+    pending_events = 0;
+    trace_count = 0;
+    trace_active = false;
+}
+
+int sched_add_task(const char *name, sched_task_fn_t fn, uint8_t priority,
+                   uint32_t wake_events, sched_pending_fn_t pending) {
+    if (num_tasks >= SCHED_MAX_TASKS || !fn) {
+        return -1;
+    }
+
+    int id = num_tasks;
+    tasks[id].name = name;
+    tasks[id].fn = fn;
+    tasks[id].pending = pending;
+    tasks[id].wake_events = wake_events;
+    tasks[id].events = 0;
+    tasks[id].priority = priority;
+    tasks[id].deadline_us = SCHED_NO_DEADLINE;
+    memset(&tasks[id].stats, 0, sizeof(tasks[id].stats));
+
+    // Insert into the run order, after tasks of equal priority
+    uint8_t pos = num_tasks;
+    while (pos > 0 && tasks[task_order[pos - 1]].priority > priority) {
+        task_order[pos] = task_order[pos - 1];
+        pos--;
+    }
+    task_order[pos] = (uint8_t)id;
+    num_tasks++;
+
+    sched_set_budget(id, SCHED_DEFAULT_BUDGET_US);
+    return id;
+}
+
+void sched_signal(uint32_t events) {
+    __atomic_fetch_or(&pending_events, events, __ATOMIC_RELEASE);
+    hal_signal_event();
+}
+
+void sched_wake_at(int task_id, uint64_t deadline_us) {
+    if (task_id >= 0 && task_id < num_tasks) {
+        tasks[task_id].deadline_us = deadline_us;
+    }
+}
+
+int sched_current_task(void) {
+    return current_task;
+}
+
+void sched_set_budget(int task_id, uint32_t budget_us) {
+    if (task_id < 0 || task_id >= num_tasks) {
+        return;
+    }
+
+    uint64_t cycles = (uint64_t)budget_us * hal_cycle_hz() / 1000000u;
+    tasks[task_id].budget_us = budget_us;
+    tasks[task_id].budget_cycles = cycles > UINT32_MAX ? UINT32_MAX : (uint32_t)cycles;
+}
+
+uint8_t sched_task_count(void) {
+    return num_tasks;
+}
+
+bool sched_get_task_stats(int task_id, const char **name, uint32_t *budget_us,
+                          sched_task_stats_t *stats) {
+    if (task_id < 0 || task_id >= num_tasks) {
+        return false;
+    }
+
+    if (name) {
+        *name = tasks[task_id].name;
+    }
+    if (budget_us) {
+        *budget_us = tasks[task_id].budget_us;
+    }
+    if (stats) {
+        *stats = tasks[task_id].stats;
+    }
+    return true;
+}
+
+void sched_reset_stats(void) {
+    for (uint8_t i = 0; i < num_tasks; i++) {
+        memset(&tasks[i].stats, 0, sizeof(tasks[i].stats));
+    }
+}
+
+void sched_trace_start(void) {
+    trace_count = 0;
+    trace_start_us = hal_time_us();
+    trace_active = true;
+}
+
+uint16_t sched_trace_count(void) {
+    return trace_count;
+}
+
+bool sched_trace_get(uint16_t index, sched_trace_entry_t *entry) {
+    if (index >= trace_count || !entry) {
+        return false;
+    }
+    *entry = trace[index];
+    return true;
+}
+
+uint64_t sched_next_deadline(void) {
+    uint64_t next = SCHED_NO_DEADLINE;
+    for (uint8_t i = 0; i < num_tasks; i++) {
+        if (tasks[i].deadline_us < next) {
+            next = tasks[i].deadline_us;
+        }
+    }
+    return next;
+}
+
+/**
+ * Run a task and account its run time
+ */
+static void run_task(uint8_t id) {
+    sched_task_t *task = &tasks[id];
+    // Only runs that started while tracing are recorded
+    bool traced = trace_active;
+    uint64_t start_us = traced ? hal_time_us() : 0;
+
+    current_task = id;
+    uint32_t start = hal_cycle_count();
+    task->fn();
+    uint32_t cycles = hal_cycle_count() - start;
+    current_task = -1;
+
+    task->stats.calls++;
+    task->stats.cycles_total += cycles;
+    if (cycles > task->stats.cycles_max) {
+        task->stats.cycles_max = cycles;
+    }
+    if (cycles > task->budget_cycles) {
+        task->stats.overruns++;
+    }
+
+    if (traced && trace_active && start_us >= trace_start_us) {
+        sched_trace_entry_t *entry = &trace[trace_count++];
+        entry->start_us = (uint32_t)(start_us - trace_start_us);
+        entry->cycles = cycles;
+        entry->task_id = id;
+        trace_active = trace_count < SCHED_TRACE_SIZE;
+    }
+}
+
+/**
+ * Hand newly signaled events to every task waiting for them
+ */
+static void collect_events(void) {
+    uint32_t events = __atomic_exchange_n(&pending_events, 0, __ATOMIC_ACQUIRE);
+    if (!events) {
+        return;
+    }
+    for (uint8_t i = 0; i < num_tasks; i++) {
+        tasks[i].events |= events & tasks[i].wake_events;
+    }
+}
+
+bool sched_poll(void) {
+    bool ran = false;
+
+    for (uint8_t i = 0; i < num_tasks; i++) {
+        uint8_t id = task_order[i];
+        sched_task_t *task = &tasks[id];
+
+        // Pick up events raised by higher-priority tasks in this pass
+        collect_events();
+
+        bool ready = task->events != 0 ||
+                     hal_time_us() >= task->deadline_us ||
+                     (task->pending && task->pending());
+        if (!ready) {
+            continue;
+        }
+
+        task->events = 0;
+        task->deadline_us = SCHED_NO_DEADLINE;
+        run_task(id);
+        ran = true;
+    }
+
+    return ran;
+}
+
+void sched_run(void) {
+    while (1) {
+        if (sched_poll()) {
+            continue;
+        }
+
+        // Sleep until an interrupt, a signaled event or the next deadline.
+        // Events signaled after the poll set the event register, so the
+        // wait returns immediately instead of missing them.
+        if (__atomic_load_n(&pending_events, __ATOMIC_ACQUIRE) == 0) {
+            hal_wait_for_event(sched_next_deadline());
+        }
+    }
+}
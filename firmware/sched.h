@@ -0,0 +1,165 @@
+/**
+ * Cooperative Scheduler
+ *
+ * Runs registered tasks in priority order when one of their wake
+ * conditions holds: an event bit signaled by a module (e.g. a new HID
+ * report), a pending-work check (e.g. USB stack events), or a deadline.
+ * When nothing is ready the core sleeps until the next event or deadline.
+ *
+ * Every task run is timed with the cycle counter: per-task call count,
+ * total and longest run, and runs over the task's budget. A one-shot trace
+ * can additionally capture the start time and length of the next
+ * SCHED_TRACE_SIZE runs.
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Maximum number of registered tasks
+#define SCHED_MAX_TASKS 12
+
+// Deadline value meaning "no deadline"
+#define SCHED_NO_DEADLINE UINT64_MAX
+
+// Default run-time budget per task call: one USB frame
+#define SCHED_DEFAULT_BUDGET_US 1000
+
+// Task runs captured by one trace
+#define SCHED_TRACE_SIZE 512
+
+// Wake events (bitmask)
+#define SCHED_EVENT_HID_INPUT    (1u << 0)  // New input report decoded
+#define SCHED_EVENT_HOST_CONNECT (1u << 1)  // Input device mounted/unmounted
+#define SCHED_EVENT_MACRO        (1u << 2)  // Macro started
+#define SCHED_EVENT_OUTPUT       (1u << 3)  // Output frame changed
+#define SCHED_EVENT_SERIAL_RX    (1u << 4)  // Serial command data received
+
+// Task function
+typedef void (*sched_task_fn_t)(void);
+
+// Optional check for work that cannot signal an event (e.g. USB stack queues)
+typedef bool (*sched_pending_fn_t)(void);
+
+// Per-task run-time statistics, in hal_cycle_count() ticks
+typedef struct {
+    uint32_t calls;         // Runs
+    uint32_t overruns;      // Runs longer than the task budget
+    uint32_t cycles_max;    // Longest run
+    uint64_t cycles_total;  // Sum of all runs
+} sched_task_stats_t;
+
+// One traced task run
+typedef struct {
+    uint32_t start_us;  // Start, relative to sched_trace_start()
+    uint32_t cycles;    // Run time in hal_cycle_count() ticks
+    uint8_t task_id;
+} sched_trace_entry_t;
+
+/**
+ * Initialize scheduler and remove all tasks
+ */
+void sched_init(void);
+
+/**
+ * Register a task
+ * @param name Task name (for diagnostics)
+ * @param fn Task function
+ * @param priority Priority, lower value runs first
+ * @param wake_events Events that wake the task (SCHED_EVENT_*)
+ * @param pending Optional pending-work check, or NULL
+ * @return Task ID, or -1 if the task table is full
+ */
+int sched_add_task(const char *name, sched_task_fn_t fn, uint8_t priority,
+                   uint32_t wake_events, sched_pending_fn_t pending);
+
+/**
+ * Signal wake events
+ * Safe to call from interrupt handlers and from the other core.
+ * @param events Event bitmask
+ */
+void sched_signal(uint32_t events);
+
+/**
+ * Set a task deadline (replaces any earlier deadline)
+ * @param task_id Task ID
+ * @param deadline_us Absolute time in us, or SCHED_NO_DEADLINE
+ */
+void sched_wake_at(int task_id, uint64_t deadline_us);
+
+/**
+ * Get the ID of the task that is currently running
+ * @return Task ID, or -1 outside of a task
+ */
+int sched_current_task(void);
+
+/**
+ * Set the run-time budget of a task (default SCHED_DEFAULT_BUDGET_US)
+ * Runs over the budget are counted as overruns.
+ * @param task_id Task ID
+ * @param budget_us Budget in us
+ */
+void sched_set_budget(int task_id, uint32_t budget_us);
+
+/**
+ * Get the number of registered tasks (task IDs are 0 to count - 1)
+ * @return Task count
+ */
+uint8_t sched_task_count(void);
+
+/**
+ * Get task details and run-time statistics
+ * @param task_id Task ID
+ * @param name Set to the task name (may be NULL)
+ * @param budget_us Set to the task budget in us (may be NULL)
+ * @param stats Pointer to store statistics (may be NULL)
+ * @return true if the task exists
+ */
+bool sched_get_task_stats(int task_id, const char **name, uint32_t *budget_us,
+                          sched_task_stats_t *stats);
+
+/**
+ * Reset the run-time statistics of all tasks
+ */
+void sched_reset_stats(void);
+
+/**
+ * Start a trace capture, discarding the previous one
+ * The next SCHED_TRACE_SIZE task runs are recorded, then capture stops.
+ */
+void sched_trace_start(void);
+
+/**
+ * Get the number of captured task runs
+ * @return Entries recorded (0 to SCHED_TRACE_SIZE)
+ */
+uint16_t sched_trace_count(void);
+
+/**
+ * Get a captured task run
+ * @param index Entry index, in run order
+ * @param entry Pointer to store the entry
+ * @return true if the entry exists
+ */
+bool sched_trace_get(uint16_t index, sched_trace_entry_t *entry);
+
+/**
+ * Get the earliest task deadline
+ * @return Absolute time in us, or SCHED_NO_DEADLINE
+ */
+uint64_t sched_next_deadline(void);
+
+/**
+ * Run every ready task once, in priority order
+ * @return true if at least one task ran
+ */
+bool sched_poll(void);
+
+/**
+ * Run the scheduler forever, sleeping while no task is ready
+ */
+void sched_run(void);
+
+#endif // SCHED_H
@@ -0,0 +1,230 @@
+/**
+ * Input Telemetry Stream Implementation
+ */
+
+#include "telemetry.h"
+#include <string.h>
+#include "usb_host.h"
+#include "command.h"
+#include "hal.h"
+
+// Sync, type, len, checksum plus the largest payload (gamepad with every field)
+#define TELEMETRY_FRAME_MAX 40
+
+static bool stream_active = false;
+static uint32_t sample_period_us = 0;
+static uint64_t next_sample_us = UINT64_MAX;
+static uint64_t last_frame_us = 0;
+
+// Last state sent per device; the decoder keeps the same reference
+static gamepad_state_t sent_gamepad[USB_HOST_MAX_DEVICES];
+static keyboard_state_t sent_keyboard[USB_HOST_MAX_DEVICES];
+static uint8_t streamed_devices = 0;  // Slots with a non-zero reference state
+
+static telemetry_stats_t stats = {0};
+
+static uint8_t *put_varint(uint8_t *p, uint32_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+// Stick change as zigzag varint (small moves in either direction stay short)
+static uint8_t *put_axis_delta(uint8_t *p, int16_t now, int16_t before) {
+    int32_t delta = (int32_t)now - (int32_t)before;
+    return put_varint(p, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+}
+
+/**
+ * Start a frame: sync, type, length placeholder, device and time delta
+ * @return Write position for the rest of the payload
+ */
+static uint8_t *frame_begin(uint8_t *frame, uint8_t type, uint8_t device, uint64_t now) {
+    frame[0] = TELEMETRY_SYNC;
+    frame[1] = type;
+    frame[3] = device;
+    return put_varint(&frame[4], (uint32_t)(now - last_frame_us));
+}
+
+/**
+ * Complete a frame and queue it if the TX FIFO has room
+ * @return true if queued; otherwise the caller keeps its reference state
+ */
+static bool frame_send(uint8_t *frame, uint8_t *end, uint64_t now) {
+    uint8_t len = (uint8_t)(end - &frame[3]);
+    frame[2] = len;
+
+    uint8_t sum = 0;
+    for (uint8_t *p = &frame[1]; p < end; p++) {
+        sum = (uint8_t)(sum + *p);
+    }
+    *end++ = sum;
+
+    // Command replies waiting for the TX FIFO go first
+    uint32_t size = (uint32_t)(end - frame);
+    if (command_reply_queued() > 0 || command_write_space() < size) {
+        stats.deferred++;
+        return false;
+    }
+
+    command_write((const char *)frame, size);
+    last_frame_us = now;
+    stats.frames++;
+    stats.bytes += size;
+    return true;
+}
+
+static void sample_gamepad(uint8_t device, uint64_t now) {
+    gamepad_state_t state;
+    if (!usb_host_get_gamepad_state(device, &state)) {
+        return;
+    }
+
+    const gamepad_state_t *ref = &sent_gamepad[device];
+    uint16_t mask = 0;
+    if (state.buttons != ref->buttons)             mask |= TELEMETRY_FIELD_BUTTONS;
+    if (state.left_x != ref->left_x)               mask |= TELEMETRY_FIELD_LEFT_X;
+    if (state.left_y != ref->left_y)               mask |= TELEMETRY_FIELD_LEFT_Y;
+    if (state.right_x != ref->right_x)             mask |= TELEMETRY_FIELD_RIGHT_X;
+    if (state.right_y != ref->right_y)             mask |= TELEMETRY_FIELD_RIGHT_Y;
+    if (state.left_trigger != ref->left_trigger)   mask |= TELEMETRY_FIELD_LEFT_TRIGGER;
+    if (state.right_trigger != ref->right_trigger) mask |= TELEMETRY_FIELD_RIGHT_TRIGGER;
+    if (state.dpad_x != ref->dpad_x)               mask |= TELEMETRY_FIELD_DPAD_X;
+    if (state.dpad_y != ref->dpad_y)               mask |= TELEMETRY_FIELD_DPAD_Y;
+    if (mask == 0) {
+        return;
+    }
+
+    uint8_t frame[TELEMETRY_FRAME_MAX];
+    uint8_t *p = frame_begin(frame, TELEMETRY_FRAME_GAMEPAD, device, now);
+    *p++ = (uint8_t)(mask & 0xFF);
+    *p++ = (uint8_t)(mask >> 8);
+    if (mask & TELEMETRY_FIELD_BUTTONS) {
+        *p++ = (uint8_t)(state.buttons & 0xFF);
+        *p++ = (uint8_t)(state.buttons >> 8);
+    }
+    if (mask & TELEMETRY_FIELD_LEFT_X)        p = put_axis_delta(p, state.left_x, ref->left_x);
+    if (mask & TELEMETRY_FIELD_LEFT_Y)        p = put_axis_delta(p, state.left_y, ref->left_y);
+    if (mask & TELEMETRY_FIELD_RIGHT_X)       p = put_axis_delta(p, state.right_x, ref->right_x);
+    if (mask & TELEMETRY_FIELD_RIGHT_Y)       p = put_axis_delta(p, state.right_y, ref->right_y);
+    if (mask & TELEMETRY_FIELD_LEFT_TRIGGER)  *p++ = state.left_trigger;
+    if (mask & TELEMETRY_FIELD_RIGHT_TRIGGER) *p++ = state.right_trigger;
+    if (mask & TELEMETRY_FIELD_DPAD_X)        *p++ = (uint8_t)state.dpad_x;
+    if (mask & TELEMETRY_FIELD_DPAD_Y)        *p++ = (uint8_t)state.dpad_y;
+
+    if (frame_send(frame, p, now)) {
+        sent_gamepad[device] = state;
+        streamed_devices |= (uint8_t)(1u << device);
+    }
+}
+
+static void sample_keyboard(uint8_t device, uint64_t now) {
+    keyboard_state_t state;
+    if (!usb_host_get_keyboard_state(device, &state)) {
+        return;
+    }
+
+    const keyboard_state_t *ref = &sent_keyboard[device];
+    if (state.num_keys > MAX_KEYBOARD_KEYS) {
+        state.num_keys = MAX_KEYBOARD_KEYS;
+    }
+    if (state.modifiers == ref->modifiers && state.num_keys == ref->num_keys &&
+        memcmp(state.keys, ref->keys, state.num_keys) == 0) {
+        return;
+    }
+
+    uint8_t frame[TELEMETRY_FRAME_MAX];
+    uint8_t *p = frame_begin(frame, TELEMETRY_FRAME_KEYBOARD, device, now);
+    *p++ = state.modifiers;
+    *p++ = state.num_keys;
+    memcpy(p, state.keys, state.num_keys);
+    p += state.num_keys;
+
+    if (frame_send(frame, p, now)) {
+        sent_keyboard[device] = state;
+        streamed_devices |= (uint8_t)(1u << device);
+    }
+}
+
+static void sample_disconnect(uint8_t device, uint64_t now) {
+    uint8_t frame[TELEMETRY_FRAME_MAX];
+    uint8_t *p = frame_begin(frame, TELEMETRY_FRAME_DISCONNECT, device, now);
+
+    if (frame_send(frame, p, now)) {
+        memset(&sent_gamepad[device], 0, sizeof(sent_gamepad[device]));
+        memset(&sent_keyboard[device], 0, sizeof(sent_keyboard[device]));
+        streamed_devices &= (uint8_t)~(1u << device);
+    }
+}
+
+bool telemetry_start(uint32_t rate) {
+    if (rate == 0 || rate > TELEMETRY_MAX_RATE) {
+        return false;
+    }
+
+    memset(sent_gamepad, 0, sizeof(sent_gamepad));
+    memset(sent_keyboard, 0, sizeof(sent_keyboard));
+    memset(&stats, 0, sizeof(stats));
+    streamed_devices = 0;
+
+    sample_period_us = 1000000u / rate;
+    last_frame_us = hal_time_us();
+    next_sample_us = last_frame_us;
+    stream_active = true;
+    return true;
+}
+
+void telemetry_stop(void) {
+    stream_active = false;
+    next_sample_us = UINT64_MAX;
+}
+
+bool telemetry_active(void) {
+    return stream_active;
+}
+
+void telemetry_task(void) {
+    if (!stream_active) {
+        return;
+    }
+
+    uint64_t now = hal_time_us();
+    if (now < next_sample_us) {
+        return;
+    }
+
+    uint8_t connected = usb_host_get_connected_devices();
+    for (uint8_t device = 0; device < USB_HOST_MAX_DEVICES; device++) {
+        uint8_t device_bit = (uint8_t)(1u << device);
+
+        if (!(connected & device_bit)) {
+            if (streamed_devices & device_bit) {
+                sample_disconnect(device, now);
+            }
+        } else if (usb_host_get_input_type(device) == INPUT_TYPE_KEYBOARD) {
+            sample_keyboard(device, now);
+        } else {
+            sample_gamepad(device, now);
+        }
+    }
+    command_flush();
+
+    // Keep the sample grid, but skip missed samples instead of bursting
+    next_sample_us += sample_period_us;
+    if (next_sample_us <= now) {
+        next_sample_us = now + sample_period_us;
+    }
+}
+
+uint64_t telemetry_next_deadline_us(void) {
+    return stream_active ? next_sample_us : UINT64_MAX;
+}
+
+void telemetry_get_stats(telemetry_stats_t *out) {
+    if (out) {
+        *out = stats;
+    }
+}
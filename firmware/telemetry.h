@@ -0,0 +1,94 @@
+/**
+ * Input Telemetry Stream
+ *
+ * Pushes the input state of every connected device to the configuration
+ * tool as binary frames on the command channel, sampled at a fixed rate
+ * and sent only when something changed. Each frame carries only the fields
+ * that differ from the previous frame of that device, so a 1 kHz stream of
+ * a moving stick costs a few bytes per sample.
+ *
+ * Frame: [TELEMETRY_SYNC][type][len][payload: len bytes][checksum]
+ * The checksum is the 8-bit sum of type, len and payload. The sync byte is
+ * never part of a text reply, so frames and reply lines can share the port.
+ *
+ * Payloads start with the device slot and the microseconds since the
+ * previous frame (unsigned LEB128 varint):
+ * - TELEMETRY_FRAME_GAMEPAD: u16 field mask (TELEMETRY_FIELD_*), then each
+ *   field in the mask in bit order. Buttons are u16, stick axes are zigzag
+ *   varints of the change, triggers and d-pad are one byte each.
+ * - TELEMETRY_FRAME_KEYBOARD: modifiers, num_keys, keys[num_keys]
+ * - TELEMETRY_FRAME_DISCONNECT: nothing else; the device's state is zero again
+ * Multi-byte fields are little-endian. Every device starts from an all-zero
+ * state when the stream starts.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TELEMETRY_SYNC      0xA5
+#define TELEMETRY_MAX_RATE  1000  // Samples per second
+
+// Frame types
+#define TELEMETRY_FRAME_GAMEPAD    0x01
+#define TELEMETRY_FRAME_KEYBOARD   0x02
+#define TELEMETRY_FRAME_DISCONNECT 0x03
+
+// Gamepad field mask bits
+#define TELEMETRY_FIELD_BUTTONS  (1u << 0)
+#define TELEMETRY_FIELD_LEFT_X   (1u << 1)
+#define TELEMETRY_FIELD_LEFT_Y   (1u << 2)
+#define TELEMETRY_FIELD_RIGHT_X  (1u << 3)
+#define TELEMETRY_FIELD_RIGHT_Y  (1u << 4)
+#define TELEMETRY_FIELD_LEFT_TRIGGER  (1u << 5)
+#define TELEMETRY_FIELD_RIGHT_TRIGGER (1u << 6)
+#define TELEMETRY_FIELD_DPAD_X   (1u << 7)
+#define TELEMETRY_FIELD_DPAD_Y   (1u << 8)
+
+// Stream statistics
+typedef struct {
+    uint32_t frames;    // Frames sent
+    uint32_t bytes;     // Bytes sent, including framing
+    uint32_t deferred;  // Samples held back for a full TX FIFO or queued replies
+} telemetry_stats_t;
+
+/**
+ * Start streaming
+ * Resets the per-device reference state and the statistics.
+ * @param rate Samples per second (1 to TELEMETRY_MAX_RATE)
+ * @return true on success, false on invalid rate
+ */
+bool telemetry_start(uint32_t rate);
+
+/**
+ * Stop streaming
+ */
+void telemetry_stop(void);
+
+/**
+ * Check if streaming is active
+ * @return true while streaming
+ */
+bool telemetry_active(void);
+
+/**
+ * Sample all devices and send frames for the ones that changed
+ * Call when telemetry_next_deadline_us() is reached.
+ */
+void telemetry_task(void);
+
+/**
+ * Get the time of the next sample
+ * @return Absolute deadline in us, or UINT64_MAX when not streaming
+ */
+uint64_t telemetry_next_deadline_us(void);
+
+/**
+ * Get stream statistics
+ * @param stats Pointer to store statistics
+ */
+void telemetry_get_stats(telemetry_stats_t *stats);
+
+#endif // TELEMETRY_H
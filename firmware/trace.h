@@ -0,0 +1,89 @@
+/**
+ * Trace Points
+ *
+ * Lightweight diagnostics for the input and macro paths. Trace points
+ * below the build-time level JC_TRACE_LEVEL compile to nothing; enabled
+ * ones are written to the log ring (never to stdio, which blocks on the
+ * UART) and rate limited per call site, so a held button or a tight
+ * macro cannot flood the log.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "logging.h"
+#include "hal.h"
+
+// Trace levels (JC_TRACE_LEVEL)
+#define TRACE_LEVEL_OFF   0
+#define TRACE_LEVEL_WARN  1  // Errors and rejected requests
+#define TRACE_LEVEL_INFO  2  // State changes (macro started/finished, tables edited)
+#define TRACE_LEVEL_DEBUG 3  // Every button event and macro step
+
+#ifndef JC_TRACE_LEVEL
+#define JC_TRACE_LEVEL TRACE_LEVEL_INFO
+#endif
+
+// Per call site rate limit: at most TRACE_RATE_LIMIT entries per window
+#define TRACE_RATE_LIMIT     10
+#define TRACE_RATE_WINDOW_MS 1000
+
+// Rate limiter state of one trace point
+typedef struct {
+    uint32_t window_start_ms;
+    uint16_t count;
+} trace_site_t;
+
+/**
+ * Check the rate limit of a trace point and count the entry
+ * @param site Trace point state
+ * @return true if the entry may be logged
+ */
+static inline bool trace_allow(trace_site_t *site) {
+    uint32_t now = hal_time_ms();
+    if (now - site->window_start_ms >= TRACE_RATE_WINDOW_MS) {
+        site->window_start_ms = now;
+        site->count = 0;
+    }
+    if (site->count >= TRACE_RATE_LIMIT) {
+        return false;
+    }
+    site->count++;
+    return true;
+}
+
+#define TRACE_AT(level, fmt, ...) do { \
+        static trace_site_t trace_site_; \
+        if (trace_allow(&trace_site_)) { \
+            logging_log(level, fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+// Disabled trace points still type-check their arguments
+#define TRACE_NONE(fmt, ...) do { \
+        if (0) { \
+            logging_log(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#if JC_TRACE_LEVEL >= TRACE_LEVEL_WARN
+#define TRACE_WARN(fmt, ...) TRACE_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define TRACE_WARN(fmt, ...) TRACE_NONE(fmt, ##__VA_ARGS__)
+#endif
+
+#if JC_TRACE_LEVEL >= TRACE_LEVEL_INFO
+#define TRACE_INFO(fmt, ...) TRACE_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define TRACE_INFO(fmt, ...) TRACE_NONE(fmt, ##__VA_ARGS__)
+#endif
+
+#if JC_TRACE_LEVEL >= TRACE_LEVEL_DEBUG
+#define TRACE_DEBUG(fmt, ...) TRACE_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define TRACE_DEBUG(fmt, ...) TRACE_NONE(fmt, ##__VA_ARGS__)
+#endif
+
+#endif // TRACE_H
@@ -107,7 +107,9 @@ extern "C" {
 #endif
 
 // Size of buffer to hold descriptors and other data used for enumeration
-#define CFG_TUH_ENUMERATION_BUFSIZE   256
+// HID report descriptors larger than this are not passed to tuh_hid_mount_cb
+// (the DualShock 4 descriptor is 507 bytes)
+#define CFG_TUH_ENUMERATION_BUFSIZE   512
 
 // Number of hub devices supported
 #define CFG_TUH_HUB           1
@@ -12,12 +12,15 @@
 #include "usb_device.h"
 #include <stdio.h>
 #include <string.h>
-#include "pico/stdlib.h"
 #include "tusb.h"
+#include "hal.h"
 #include "logging.h"
+#include "latency.h"
+#include "counters.h"
 
 static output_type_t current_output_type = OUTPUT_TYPE_GAMEPAD;
 static bool config_mode_request = false;
+static uint32_t keepalive_interval_ms = 0;  // 0 = only send on change
 
 // HID Report IDs (must match usb_descriptors.c)
 #define REPORT_ID_GAMEPAD   1
@@ -51,6 +54,206 @@ typedef struct __attribute__((packed)) {
     int8_t wheel;
 } mouse_report_t;
 
+typedef union {
+    gamepad_report_t gamepad;
+    keyboard_report_t keyboard;
+    mouse_report_t mouse;
+} hid_report_t;
+
+// Reports waiting per report ID: the latest report, plus one follow-up
+// when overwriting would hide a button/key edge that was never sent
+#define PENDING_DEPTH 2
+
+// Pending report slot for one report ID
+typedef struct {
+    uint8_t report_id;
+    uint8_t len;
+    uint8_t count;                      // Reports waiting (0 to PENDING_DEPTH)
+    hid_report_t queue[PENDING_DEPTH];  // queue[0] is sent next
+    uint64_t queue_input_us[PENDING_DEPTH];  // Input behind each entry (0 = none)
+    hid_report_t sent;                  // Last report handed to the endpoint
+    bool sent_valid;                    // sent holds a transmitted report
+    uint32_t sent_time_ms;              // When sent was transmitted
+    usb_device_report_stats_t stats;
+} report_slot_t;
+
+// Slots in transmit priority order: edges on keys and mouse buttons first
+enum {
+    SLOT_KEYBOARD,
+    SLOT_MOUSE,
+    SLOT_GAMEPAD,
+    SLOT_COUNT
+};
+
+static report_slot_t slots[SLOT_COUNT] = {
+    [SLOT_KEYBOARD] = {.report_id = REPORT_ID_KEYBOARD, .len = sizeof(keyboard_report_t)},
+    [SLOT_MOUSE]    = {.report_id = REPORT_ID_MOUSE, .len = sizeof(mouse_report_t)},
+    [SLOT_GAMEPAD]  = {.report_id = REPORT_ID_GAMEPAD, .len = sizeof(gamepad_report_t)},
+};
+
+// Input behind the report on the endpoint, closed in tud_hid_report_complete_cb
+static uint64_t in_flight_input_us = 0;
+
+static bool keyboard_has_key(const keyboard_report_t *report, uint8_t keycode) {
+    for (uint8_t i = 0; i < sizeof(report->keycodes); i++) {
+        if (report->keycodes[i] == keycode) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Check whether replacing a pending report would lose an edge
+ * An edge is lost when the pending report changes a button or key relative
+ * to the last one sent and the replacement changes it back.
+ */
+static bool edge_would_be_lost(uint8_t slot, const hid_report_t *sent,
+                               const hid_report_t *pending, const hid_report_t *next) {
+    switch (slot) {
+        case SLOT_GAMEPAD: {
+            uint16_t pending_edges = pending->gamepad.buttons ^ sent->gamepad.buttons;
+            return (pending_edges & (next->gamepad.buttons ^ pending->gamepad.buttons)) != 0;
+        }
+        case SLOT_MOUSE: {
+            uint8_t pending_edges = pending->mouse.buttons ^ sent->mouse.buttons;
+            return (pending_edges & (next->mouse.buttons ^ pending->mouse.buttons)) != 0;
+        }
+        case SLOT_KEYBOARD: {
+            uint8_t pending_edges = pending->keyboard.modifiers ^ sent->keyboard.modifiers;
+            if (pending_edges & (next->keyboard.modifiers ^ pending->keyboard.modifiers)) {
+                return true;
+            }
+            // Pressed-then-released or released-then-pressed before being sent
+            for (uint8_t i = 0; i < sizeof(pending->keyboard.keycodes); i++) {
+                uint8_t key = pending->keyboard.keycodes[i];
+                if (key != 0 && !keyboard_has_key(&sent->keyboard, key) &&
+                    !keyboard_has_key(&next->keyboard, key)) {
+                    return true;
+                }
+                key = sent->keyboard.keycodes[i];
+                if (key != 0 && !keyboard_has_key(&pending->keyboard, key) &&
+                    keyboard_has_key(&next->keyboard, key)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+static bool mouse_axis_fits(int a, int b) {
+    return a + b >= -127 && a + b <= 127;
+}
+
+/**
+ * Fold a new report into a pending one (latest wins, mouse motion summed)
+ * @return false if the reports cannot be merged without losing data
+ */
+static bool merge_report(uint8_t slot, const hid_report_t *sent, hid_report_t *pending,
+                         const hid_report_t *next) {
+    if (edge_would_be_lost(slot, sent, pending, next)) {
+        return false;
+    }
+
+    if (slot == SLOT_MOUSE) {
+        if (!mouse_axis_fits(pending->mouse.x, next->mouse.x) ||
+            !mouse_axis_fits(pending->mouse.y, next->mouse.y) ||
+            !mouse_axis_fits(pending->mouse.wheel, next->mouse.wheel)) {
+            return false;
+        }
+        pending->mouse.buttons = next->mouse.buttons;
+        pending->mouse.x += next->mouse.x;
+        pending->mouse.y += next->mouse.y;
+        pending->mouse.wheel += next->mouse.wheel;
+        return true;
+    }
+
+    *pending = *next;
+    return true;
+}
+
+/**
+ * Send the highest-priority pending report if the endpoint is free
+ */
+static void flush_pending(void) {
+    if (!tud_hid_ready()) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        report_slot_t *slot = &slots[i];
+        if (slot->count == 0) {
+            continue;
+        }
+
+        if (tud_hid_report(slot->report_id, &slot->queue[0], slot->len)) {
+            slot->sent = slot->queue[0];
+            slot->sent_valid = true;
+            slot->sent_time_ms = hal_time_ms();
+            slot->stats.sent++;
+            counters_inc(COUNTER_HID_SENT);
+            in_flight_input_us = slot->queue_input_us[0];
+            slot->queue[0] = slot->queue[1];
+            slot->queue_input_us[0] = slot->queue_input_us[1];
+            slot->count--;
+        }
+        return;
+    }
+}
+
+/**
+ * Store a report in its pending slot and try to send it
+ * @param input_us Input the report was caused by (0 = none); a merged
+ *                 entry keeps the oldest one
+ */
+static void submit_report(uint8_t index, const hid_report_t *report, uint64_t input_us) {
+    report_slot_t *slot = &slots[index];
+
+    // Drop reports identical to what the host already has (or will have);
+    // mouse reports with movement are relative and always count
+    bool moves = (index == SLOT_MOUSE) &&
+                 (report->mouse.x != 0 || report->mouse.y != 0 || report->mouse.wheel != 0);
+    if (!moves) {
+        const hid_report_t *latest = (slot->count > 0) ? &slot->queue[slot->count - 1] : &slot->sent;
+        if ((slot->count > 0 || slot->sent_valid) && memcmp(latest, report, slot->len) == 0) {
+            slot->stats.suppressed++;
+            counters_inc(COUNTER_HID_SUPPRESSED);
+            return;
+        }
+    }
+
+    if (slot->count == 0) {
+        slot->queue[0] = *report;
+        slot->queue_input_us[0] = input_us;
+        slot->count = 1;
+    } else {
+        uint8_t last = slot->count - 1;
+        const hid_report_t *before = (last == 0) ? &slot->sent : &slot->queue[last - 1];
+
+        bool merged = merge_report(index, before, &slot->queue[last], report);
+        if (!merged && slot->count < PENDING_DEPTH) {
+            slot->queue[slot->count] = *report;
+            slot->queue_input_us[slot->count] = input_us;
+            slot->count++;
+        } else {
+            if (!merged) {
+                // Both entries are in use; the newest state still wins
+                slot->queue[last] = *report;
+                counters_inc(COUNTER_HID_DROPPED);
+            }
+            // The entry now stands for both inputs; measure from the older
+            if (slot->queue_input_us[last] == 0) {
+                slot->queue_input_us[last] = input_us;
+            }
+        }
+    }
+
+    flush_pending();
+}
+
 bool usb_device_init(void) {
     LOG_INFO("USB Device: Initializing native USB device stack...");
     
@@ -61,6 +264,13 @@ bool usb_device_init(void) {
     }
     
     config_mode_request = false;
+    in_flight_input_us = 0;
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        slots[i].count = 0;
+        slots[i].sent_valid = false;
+        memset(&slots[i].sent, 0, sizeof(slots[i].sent));
+        memset(&slots[i].stats, 0, sizeof(slots[i].stats));
+    }
     
     LOG_INFO("USB Device: Native USB device stack initialized on port %d", BOARD_TUD_RHPORT);
     return true;
@@ -69,79 +279,123 @@ bool usb_device_init(void) {
 void usb_device_task(void) {
     // Process USB device events via TinyUSB
     tud_task();
+    
+    // Re-send unchanged state once the keep-alive interval has passed
+    if (keepalive_interval_ms > 0) {
+        uint32_t now = hal_time_ms();
+        for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+            report_slot_t *slot = &slots[i];
+            if (slot->count == 0 && slot->sent_valid &&
+                now - slot->sent_time_ms >= keepalive_interval_ms) {
+                slot->queue[0] = slot->sent;
+                slot->queue_input_us[0] = 0;
+                if (i == SLOT_MOUSE) {
+                    // Repeat buttons only, never movement
+                    slot->queue[0].mouse.x = 0;
+                    slot->queue[0].mouse.y = 0;
+                    slot->queue[0].mouse.wheel = 0;
+                }
+                slot->count = 1;
+                slot->stats.keepalive++;
+            }
+        }
+    }
+    
+    // Pick up anything left pending (e.g. after bus resume)
+    flush_pending();
 }
 
-void usb_device_send_gamepad(uint16_t buttons, int16_t *axes, uint8_t num_axes) {
-    if (current_output_type != OUTPUT_TYPE_GAMEPAD) {
-        return;
+bool usb_device_task_pending(void) {
+    return tud_task_event_ready();
+}
+
+uint64_t usb_device_next_deadline_us(void) {
+    uint64_t next = UINT64_MAX;
+    if (keepalive_interval_ms == 0) {
+        return next;
     }
     
-    // Only send if device is ready
-    if (!tud_hid_ready()) {
-        return;
+    uint64_t now_us = hal_time_us();
+    uint32_t now_ms = hal_time_ms();
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        const report_slot_t *slot = &slots[i];
+        if (slot->count == 0 && slot->sent_valid) {
+            // Relative to now, so millisecond wrap-around is harmless
+            uint32_t elapsed = now_ms - slot->sent_time_ms;
+            uint32_t remaining = elapsed < keepalive_interval_ms ? keepalive_interval_ms - elapsed : 0;
+            uint64_t due = now_us + (uint64_t)remaining * 1000u;
+            if (due < next) {
+                next = due;
+            }
+        }
+    }
+    return next;
+}
+
+bool usb_device_send_gamepad(uint16_t buttons, int16_t *axes, uint8_t num_axes, uint64_t input_us) {
+    if (current_output_type != OUTPUT_TYPE_GAMEPAD) {
+        counters_inc(COUNTER_HID_DISABLED);
+        return false;
     }
     
-    gamepad_report_t report = {0};
-    report.buttons = buttons;
+    hid_report_t report = {0};
+    report.gamepad.buttons = buttons;
     
     // Copy axes if provided
     if (axes && num_axes >= 4) {
-        report.left_x = axes[0];
-        report.left_y = axes[1];
-        report.right_x = axes[2];
-        report.right_y = axes[3];
+        report.gamepad.left_x = axes[0];
+        report.gamepad.left_y = axes[1];
+        report.gamepad.right_x = axes[2];
+        report.gamepad.right_y = axes[3];
     }
     if (axes && num_axes >= 6) {
-        report.left_trigger = (uint8_t)((axes[4] + 32768) >> 8);  // Convert from int16 to uint8
-        report.right_trigger = (uint8_t)((axes[5] + 32768) >> 8);
+        report.gamepad.left_trigger = (uint8_t)((axes[4] + 32768) >> 8);  // Convert from int16 to uint8
+        report.gamepad.right_trigger = (uint8_t)((axes[5] + 32768) >> 8);
     }
     
     // Hat switch is centered by default
-    report.hat = 8;  // 8 = center/no direction
+    report.gamepad.hat = 8;  // 8 = center/no direction
     
-    tud_hid_report(REPORT_ID_GAMEPAD, &report, sizeof(report));
+    submit_report(SLOT_GAMEPAD, &report, input_us);
+    return true;
 }
 
-void usb_device_send_keyboard(uint8_t modifiers, uint8_t *keycodes, uint8_t num_keys) {
+bool usb_device_send_keyboard(uint8_t modifiers, uint8_t *keycodes, uint8_t num_keys, uint64_t input_us) {
     if (current_output_type != OUTPUT_TYPE_KEYBOARD && 
         current_output_type != OUTPUT_TYPE_COMBO) {
-        return;
-    }
-    
-    if (!tud_hid_ready()) {
-        return;
+        counters_inc(COUNTER_HID_DISABLED);
+        return false;
     }
     
-    keyboard_report_t report = {0};
-    report.modifiers = modifiers;
-    report.reserved = 0;
+    hid_report_t report = {0};
+    report.keyboard.modifiers = modifiers;
+    report.keyboard.reserved = 0;
     
     // Copy keycodes (up to 6)
     if (keycodes && num_keys > 0) {
         uint8_t copy_count = num_keys > 6 ? 6 : num_keys;
-        memcpy(report.keycodes, keycodes, copy_count);
+        memcpy(report.keyboard.keycodes, keycodes, copy_count);
     }
     
-    tud_hid_report(REPORT_ID_KEYBOARD, &report, sizeof(report));
+    submit_report(SLOT_KEYBOARD, &report, input_us);
+    return true;
 }
 
-void usb_device_send_mouse(uint8_t buttons, int8_t x, int8_t y, int8_t wheel) {
+bool usb_device_send_mouse(uint8_t buttons, int8_t x, int8_t y, int8_t wheel, uint64_t input_us) {
     if (current_output_type != OUTPUT_TYPE_MOUSE && 
         current_output_type != OUTPUT_TYPE_COMBO) {
-        return;
-    }
-    
-    if (!tud_hid_ready()) {
-        return;
+        counters_inc(COUNTER_HID_DISABLED);
+        return false;
     }
     
-    mouse_report_t report = {0};
-    report.buttons = buttons;
-    report.x = x;
-    report.y = y;
-    report.wheel = wheel;
+    hid_report_t report = {0};
+    report.mouse.buttons = buttons;
+    report.mouse.x = x;
+    report.mouse.y = y;
+    report.mouse.wheel = wheel;
     
-    tud_hid_report(REPORT_ID_MOUSE, &report, sizeof(report));
+    submit_report(SLOT_MOUSE, &report, input_us);
+    return true;
 }
 
 bool usb_device_config_mode_requested(void) {
@@ -161,6 +415,30 @@ output_type_t usb_device_get_output_type(void) {
     return current_output_type;
 }
 
+void usb_device_set_keepalive(uint32_t interval_ms) {
+    keepalive_interval_ms = interval_ms;
+}
+
+uint32_t usb_device_get_keepalive(void) {
+    return keepalive_interval_ms;
+}
+
+void usb_device_get_stats(usb_device_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    
+    stats->gamepad = slots[SLOT_GAMEPAD].stats;
+    stats->keyboard = slots[SLOT_KEYBOARD].stats;
+    stats->mouse = slots[SLOT_MOUSE].stats;
+}
+
+void usb_device_reset_stats(void) {
+    for (uint8_t i = 0; i < SLOT_COUNT; i++) {
+        memset(&slots[i].stats, 0, sizeof(slots[i].stats));
+    }
+}
+
 //--------------------------------------------------------------------
 // TinyUSB HID Device Callbacks
 //--------------------------------------------------------------------
@@ -177,6 +455,22 @@ uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id,
     return 0;
 }
 
+// Invoked when a report has been sent to the host
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len) {
+    (void)instance;
+    (void)report;
+    (void)len;
+    
+    // The report has reached the host: close its input-to-output measurement
+    if (in_flight_input_us != 0) {
+        latency_record(in_flight_input_us, hal_time_us());
+        in_flight_input_us = 0;
+    }
+    
+    // Endpoint is free again - send the next pending report
+    flush_pending();
+}
+
 // Invoked when received SET_REPORT control request
 void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, 
                            hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize) {
@@ -18,6 +18,20 @@ typedef enum {
     OUTPUT_TYPE_COMBO  // Combined keyboard + mouse
 } output_type_t;
 
+// Transmission statistics for one HID report ID
+typedef struct {
+    uint32_t sent;        // Reports handed to the HID endpoint
+    uint32_t suppressed;  // Reports dropped because nothing changed
+    uint32_t keepalive;   // Unchanged reports re-sent by the keep-alive timer
+} usb_device_report_stats_t;
+
+// Transmission statistics for all report IDs
+typedef struct {
+    usb_device_report_stats_t gamepad;
+    usb_device_report_stats_t keyboard;
+    usb_device_report_stats_t mouse;
+} usb_device_stats_t;
+
 /**
  * Initialize USB device
  * @return true on success, false on failure
@@ -25,34 +39,57 @@ typedef enum {
 bool usb_device_init(void);
 
 /**
- * USB device task - must be called regularly in main loop
+ * USB device task - runs the TinyUSB device stack and the keep-alive timer
  */
 void usb_device_task(void);
 
+/**
+ * Check if the USB device stack has events waiting for usb_device_task
+ * @return true if usb_device_task has work to do
+ */
+bool usb_device_task_pending(void);
+
+/**
+ * Get the time the next keep-alive report falls due
+ * @return Absolute time in us, or UINT64_MAX if no keep-alive is due
+ */
+uint64_t usb_device_next_deadline_us(void);
+
 /**
  * Send gamepad report
+ * Reports are held in a per-report-ID pending slot (latest wins) and sent
+ * as soon as the HID endpoint is free, so they are never dropped. Reports
+ * identical to the last one transmitted are suppressed.
  * @param buttons Button state bitmap
  * @param axes Array of axis values
  * @param num_axes Number of axes
+ * @param input_us Receive time of the input behind this report, 0 for none;
+ *                 the latency is recorded when the report completes
+ * @return true if the report was queued, false if disabled by the output type
  */
-void usb_device_send_gamepad(uint16_t buttons, int16_t *axes, uint8_t num_axes);
+bool usb_device_send_gamepad(uint16_t buttons, int16_t *axes, uint8_t num_axes, uint64_t input_us);
 
 /**
  * Send keyboard report
  * @param modifiers Modifier keys (Ctrl, Alt, Shift, etc.)
  * @param keycodes Array of key codes (up to 6)
  * @param num_keys Number of keys pressed
+ * @param input_us Receive time of the input behind this report, 0 for none
+ * @return true if the report was queued, false if disabled by the output type
  */
-void usb_device_send_keyboard(uint8_t modifiers, uint8_t *keycodes, uint8_t num_keys);
+bool usb_device_send_keyboard(uint8_t modifiers, uint8_t *keycodes, uint8_t num_keys, uint64_t input_us);
 
 /**
  * Send mouse report
+ * Movement from reports that are still pending is summed, not dropped.
  * @param buttons Mouse button state
  * @param x X movement (-127 to 127)
  * @param y Y movement (-127 to 127)
  * @param wheel Wheel movement (-127 to 127)
+ * @param input_us Receive time of the input behind this report, 0 for none
+ * @return true if the report was queued, false if disabled by the output type
  */
-void usb_device_send_mouse(uint8_t buttons, int8_t x, int8_t y, int8_t wheel);
+bool usb_device_send_mouse(uint8_t buttons, int8_t x, int8_t y, int8_t wheel, uint64_t input_us);
 
 /**
  * Check if config mode is requested (e.g., via USB control transfer)
@@ -72,4 +109,32 @@ void usb_device_set_output_type(output_type_t type);
  */
 output_type_t usb_device_get_output_type(void);
 
+// Longest keep-alive interval accepted by the HID_KEEPALIVE command
+#define USB_DEVICE_KEEPALIVE_MAX_MS 60000
+
+/**
+ * Set keep-alive interval
+ * Reports are only sent when their content changes; with a keep-alive
+ * interval the last report is also repeated after that much idle time.
+ * @param interval_ms Keep-alive interval in ms, 0 to disable
+ */
+void usb_device_set_keepalive(uint32_t interval_ms);
+
+/**
+ * Get keep-alive interval
+ * @return Keep-alive interval in ms, 0 if disabled
+ */
+uint32_t usb_device_get_keepalive(void);
+
+/**
+ * Get report transmission statistics
+ * @param stats Pointer to store statistics
+ */
+void usb_device_get_stats(usb_device_stats_t *stats);
+
+/**
+ * Reset report transmission statistics
+ */
+void usb_device_reset_stats(void);
+
 #endif // USB_DEVICE_H
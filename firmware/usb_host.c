@@ -5,57 +5,171 @@
  * 
  * The USB Host runs on PIO-USB (port 1) which connects to the controller
  * via the PIO-USB Type-C port on the Waveshare RP2350-PiZero.
+ *
+ * The host stack and report decoding run on core 1. Decoded input is
+ * handed to core 0 through a lock-free single-producer/single-consumer
+ * event ring, so host-side bit-banging never delays the output side.
+ *
+ * Each mounted HID interface (dev_addr, instance) gets its own slot, with
+ * the same index on both cores, so several devices behind a hub keep
+ * separate decoders and input state.
  */
 
 #include "usb_host.h"
+#include "usb_host_private.h"
 #include <stdio.h>
 #include <string.h>
-#include "pico/stdlib.h"
 #include "pio_usb.h"
 #include "tusb.h"
-#include "remapping.h"
+#include "hid_parser.h"
+#include "hid_decoders.h"
+#include "sched.h"
+#include "hal.h"
 #include "logging.h"
+#include "counters.h"
 
-// Current gamepad state
-static gamepad_state_t current_gamepad_state = {0};
-// Current keyboard state
-static keyboard_state_t current_keyboard_state = {0};
-// Connected device info
-static usb_device_info_t device_info = {0};
-static bool device_connected = false;
-static bool gamepad_state_valid = false;
-static bool keyboard_state_valid = false;
-static input_type_t current_input_type = INPUT_TYPE_UNKNOWN;
-
-// Known controller VID/PID for logging
+#if CFG_TUH_HID > USB_HOST_MAX_DEVICES
+#error "USB_HOST_MAX_DEVICES must cover every HID interface CFG_TUH_HID allows"
+#endif
+
+//--------------------------------------------------------------------
+// Core 1 -> core 0 event ring
+//--------------------------------------------------------------------
+
+// Ring size in events (power of two)
+#define HOST_EVENT_RING_SIZE 32
+#define HOST_EVENT_RING_MASK (HOST_EVENT_RING_SIZE - 1)
+
+// Mount flags
+#define HOST_EVENT_FLAG_BOOT_PROTOCOL (1u << 0)  // Report protocol not accepted
+#define HOST_EVENT_FLAG_NO_REPORT     (1u << 1)  // First report request failed
+#define HOST_EVENT_FLAG_NO_SLOT       (1u << 2)  // Device table full, device ignored
+
+typedef enum {
+    HOST_EVENT_MOUNT,
+    HOST_EVENT_UNMOUNT,
+    HOST_EVENT_GAMEPAD,
+    HOST_EVENT_KEYBOARD
+} host_event_type_t;
+
+typedef struct {
+    uint8_t type;           // host_event_type_t
+    uint8_t device;         // Device slot
+    uint8_t flags;          // HOST_EVENT_FLAG_* (mount only)
+    uint8_t num_fields;     // Compiled descriptor fields, 0 = fixed layout (mount only)
+    uint8_t decoder;        // usb_host_decoder_t (mount only)
+    uint64_t timestamp_us;  // When core 1 received the report (input) or event
+    union {
+        usb_device_info_t info;
+        gamepad_state_t gamepad;
+        keyboard_state_t keyboard;
+    } data;
+} host_event_t;
+
+static host_event_t event_ring[HOST_EVENT_RING_SIZE];
+static volatile uint32_t ring_head = 0;     // Written by core 1 only
+static volatile uint32_t ring_tail = 0;     // Written by core 0 only
+static volatile uint32_t ring_dropped = 0;  // Written by core 1 only
+
+// Core 1 start-up result
+typedef enum {
+    CORE1_STARTING,
+    CORE1_RUNNING,
+    CORE1_FAILED
+} core1_status_t;
+
+static volatile uint32_t core1_status = CORE1_STARTING;
+
+//--------------------------------------------------------------------
+// Core 0 state, updated from the event ring
+//--------------------------------------------------------------------
+
+// Per-device input state
+typedef struct {
+    usb_device_info_t info;
+    bool connected;
+    bool gamepad_valid;
+    bool keyboard_valid;
+    gamepad_state_t gamepad;
+    keyboard_state_t keyboard;
+    uint64_t input_us;  // When the current input report was received
+} host_device_t;
+
+static host_device_t devices[USB_HOST_MAX_DEVICES];
+static uint8_t connected_devices = 0;  // Bitmask of connected slots
+static uint8_t updated_devices = 0;    // Bitmask of slots with input not yet taken
+
+//--------------------------------------------------------------------
+// Core 1 state, owned by the host stack callbacks
+//--------------------------------------------------------------------
+
+// Per-device decoder state
+typedef struct {
+    bool in_use;
+    uint8_t dev_addr;
+    uint8_t instance;
+    input_type_t input_type;
+    hid_decode_fn_t decode;      // Report decoder selected at mount
+    uint8_t decoder_kind;        // usb_host_decoder_t
+    hid_decoder_t decoder;       // Compiled from the report descriptor
+    bool fallback;               // Descriptor decodes reports the specialized decoder rejects
+    uint8_t switch_command;      // Switch Pro USB command still to send, 0 when done
+    bool switch_command_sent;    // Sent and waiting for its reply
+    gamepad_state_t gamepad;     // Last decoded gamepad state
+} stack_device_t;
+
+static stack_device_t stack_devices[USB_HOST_MAX_DEVICES];
+static stack_device_t *stack_current;  // Device whose report is being decoded
+static host_event_t stack_event;       // Event being decoded
+
+//--------------------------------------------------------------------
+// Decode statistics (written by core 1, read by core 0 via a seqlock)
+//--------------------------------------------------------------------
+
+static usb_host_decode_stats_t decode_stats;
+static volatile uint32_t decode_stats_seq = 0;
+static volatile bool decode_stats_reset_request = false;
+
+// Known controller VID/PID, with an optional specialized report decoder
 typedef struct {
     uint16_t vid;
     uint16_t pid;
     const char *name;
+    hid_decode_fn_t decode;
+    bool switch_usb;  // Needs the Switch USB handshake before sending full reports
 } known_device_t;
 
+// Switch Pro Controller USB commands (output report 0x80, replies in 0x81).
+// Over USB the controller only sends full 0x30 reports after a handshake
+// and the command that keeps it talking USB instead of Bluetooth.
+#define SWITCH_USB_COMMAND_REPORT 0x80
+#define SWITCH_USB_REPLY_REPORT   0x81
+#define SWITCH_USB_HANDSHAKE      0x02
+#define SWITCH_USB_FORCE_USB      0x04
+#define SWITCH_FULL_REPORT        0x30
+
 // Boot protocol keyboard report constants
 #define KEYBOARD_REPORT_SIZE 8
 #define KEYBOARD_REPORT_KEY_START 2
 
 static const known_device_t known_devices[] = {
     // Nintendo controllers
-    {0x057E, 0x2009, "Nintendo Switch Pro Controller"},
-    {0x057E, 0x200E, "Nintendo Switch Pro Controller 2"},  // Second generation Switch Pro Controller
-    {0x057E, 0x2017, "Nintendo Switch SNES Controller"},
-    {0x057E, 0x2019, "Nintendo Switch N64 Controller"},
-    {0x057E, 0x201E, "Nintendo Switch Online Controller"},
-    // Xbox controllers
-    {0x045E, 0x028E, "Xbox 360 Controller"},
-    {0x045E, 0x02FF, "Xbox One Controller"},
-    {0x045E, 0x0B12, "Xbox Series X Controller"},
+    {0x057E, 0x2009, "Nintendo Switch Pro Controller", hid_decode_switch_pro, true},
+    {0x057E, 0x200E, "Nintendo Switch Pro Controller 2", NULL, false},  // Second generation Switch Pro Controller
+    {0x057E, 0x2017, "Nintendo Switch SNES Controller", NULL, false},
+    {0x057E, 0x2019, "Nintendo Switch N64 Controller", NULL, false},
+    {0x057E, 0x201E, "Nintendo Switch Online Controller", NULL, false},
+    // Xbox controllers (vendor-class XInput/GIP over USB, not HID)
+    {0x045E, 0x028E, "Xbox 360 Controller", NULL, false},
+    {0x045E, 0x02FF, "Xbox One Controller", NULL, false},
+    {0x045E, 0x0B12, "Xbox Series X Controller", NULL, false},
     // Sony controllers
-    {0x054C, 0x0268, "PlayStation 3 Controller"},
-    {0x054C, 0x05C4, "PlayStation 4 Controller"},
-    {0x054C, 0x09CC, "PlayStation 4 Controller v2"},
-    {0x054C, 0x0CE6, "PlayStation 5 DualSense"},
+    {0x054C, 0x0268, "PlayStation 3 Controller", NULL, false},  // Needs an enable request before reporting
+    {0x054C, 0x05C4, "PlayStation 4 Controller", hid_decode_ds4, false},
+    {0x054C, 0x09CC, "PlayStation 4 Controller v2", hid_decode_ds4, false},
+    {0x054C, 0x0CE6, "PlayStation 5 DualSense", hid_decode_dualsense, false},
     // Generic/Other
-    {0x0000, 0x0000, NULL}  // End marker
+    {0x0000, 0x0000, NULL, NULL, false}  // End marker
 };
 
 // Helper function to get device name from VID/PID
@@ -68,6 +182,16 @@ static const char* get_device_name(uint16_t vid, uint16_t pid) {
     return "Unknown Device";
 }
 
+// Helper function to get the known_devices entry for a VID/PID, if any
+static const known_device_t* get_known_device(uint16_t vid, uint16_t pid) {
+    for (size_t i = 0; known_devices[i].name != NULL; i++) {
+        if (known_devices[i].vid == vid && known_devices[i].pid == pid) {
+            return &known_devices[i];
+        }
+    }
+    return NULL;
+}
+
 // Helper function to get input type name
 static const char* get_input_type_name(input_type_t type) {
     switch (type) {
@@ -80,199 +204,609 @@ static const char* get_input_type_name(input_type_t type) {
     }
 }
 
-bool usb_host_init(void) {
-    LOG_INFO("USB Host: Initializing PIO-USB host stack...");
+/**
+ * Publish an event to core 0 (core 1 only)
+ * Events are dropped and counted if core 0 has fallen a full ring behind.
+ */
+static void ring_push(const host_event_t *event) {
+    uint32_t head = ring_head;
+    uint32_t tail = __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE);
+    
+    if (head - tail >= HOST_EVENT_RING_SIZE) {
+        ring_dropped++;
+        if (event->type == HOST_EVENT_GAMEPAD || event->type == HOST_EVENT_KEYBOARD) {
+            counters_inc(COUNTER_REPORTS_DROPPED);
+        }
+        return;
+    }
+    
+    event_ring[head & HOST_EVENT_RING_MASK] = *event;
+    __atomic_store_n(&ring_head, head + 1, __ATOMIC_RELEASE);
+    hal_signal_event();
+}
+
+/**
+ * Take the oldest event published by core 1 (core 0 only)
+ */
+static bool ring_pop(host_event_t *event) {
+    uint32_t tail = ring_tail;
+    uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+    
+    if (head == tail) {
+        return false;
+    }
+    
+    *event = event_ring[tail & HOST_EVENT_RING_MASK];
+    __atomic_store_n(&ring_tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * Record the cost of decoding one report (core 1 only)
+ */
+static void decode_stats_record(const stack_device_t *device, uint8_t decoder_kind, uint32_t cycles) {
+    uint32_t seq = decode_stats_seq;
+    __atomic_store_n(&decode_stats_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    
+    if (decode_stats_reset_request) {
+        memset(&decode_stats, 0, sizeof(decode_stats));
+        decode_stats_reset_request = false;
+    }
+    decode_stats.reports++;
+    decode_stats.cycles_total += cycles;
+    decode_stats.cycles_last = cycles;
+    if (cycles > decode_stats.cycles_max) {
+        decode_stats.cycles_max = cycles;
+    }
+    decode_stats.num_fields = device->decoder.num_fields;
+    decode_stats.decoder = decoder_kind;
+    
+    __atomic_store_n(&decode_stats_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+bool usb_host_decode_fixed_layout(const uint8_t *report, uint16_t len, gamepad_state_t *gamepad) {
+    if (len < 8) {
+        return false;
+    }
+    
+    gamepad->buttons = report[0] | (report[1] << 8);
+    gamepad->left_x = (int16_t)(report[2] | (report[3] << 8));
+    gamepad->left_y = (int16_t)(report[4] | (report[5] << 8));
+    
+    if (len >= 12) {
+        gamepad->right_x = (int16_t)(report[6] | (report[7] << 8));
+        gamepad->right_y = (int16_t)(report[8] | (report[9] << 8));
+        gamepad->left_trigger = report[10];
+        gamepad->right_trigger = report[11];
+    }
+    return true;
+}
+
+/**
+ * Decode a report with the current device's compiled report descriptor
+ */
+static bool decode_descriptor(const uint8_t *report, uint16_t len, gamepad_state_t *gamepad) {
+    return hid_parser_decode(&stack_current->decoder, report, len, gamepad);
+}
+
+/**
+ * Send the pending Switch Pro USB command, if any (core 1 only)
+ * A send refused because the endpoint is busy is retried with the next report.
+ */
+static void switch_send_command(stack_device_t *device) {
+    if (device->switch_command == 0 || device->switch_command_sent) {
+        return;
+    }
+    if (!tuh_hid_send_report(device->dev_addr, device->instance, SWITCH_USB_COMMAND_REPORT,
+                             &device->switch_command, 1)) {
+        return;
+    }
     
+    if (device->switch_command == SWITCH_USB_FORCE_USB) {
+        // No reply; full reports follow
+        device->switch_command = 0;
+    } else {
+        device->switch_command_sent = true;
+    }
+}
+
+/**
+ * Advance the Switch Pro handshake on a report from the controller (core 1 only)
+ */
+static void switch_handle_report(stack_device_t *device, const uint8_t *report, uint16_t len) {
+    if (len >= 1 && report[0] == SWITCH_FULL_REPORT) {
+        device->switch_command = 0;
+        return;
+    }
+    if (len >= 2 && report[0] == SWITCH_USB_REPLY_REPORT && device->switch_command_sent &&
+        report[1] == device->switch_command) {
+        device->switch_command = SWITCH_USB_FORCE_USB;
+        device->switch_command_sent = false;
+    }
+    switch_send_command(device);
+}
+
+/**
+ * Find the slot of a mounted HID interface (core 1 only)
+ */
+static stack_device_t* stack_find_device(uint8_t dev_addr, uint8_t instance) {
+    for (uint8_t i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+        stack_device_t *device = &stack_devices[i];
+        if (device->in_use && device->dev_addr == dev_addr && device->instance == instance) {
+            return device;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Claim a free slot for a newly mounted HID interface (core 1 only)
+ */
+static stack_device_t* stack_alloc_device(uint8_t dev_addr, uint8_t instance) {
+    for (uint8_t i = 0; i < USB_HOST_MAX_DEVICES; i++) {
+        stack_device_t *device = &stack_devices[i];
+        if (!device->in_use) {
+            memset(device, 0, sizeof(*device));
+            device->in_use = true;
+            device->dev_addr = dev_addr;
+            device->instance = instance;
+            return device;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Bring up PIO-USB and the TinyUSB host stack on the calling core
+ */
+static bool host_stack_init(void) {
     // Configure PIO-USB with default settings
     // D+ pin is GPIO0, D- is GPIO1 (D+ + 1)
     pio_usb_configuration_t pio_cfg = PIO_USB_DEFAULT_CONFIG;
+    pio_cfg.tx_ch = USB_HOST_PIO_DMA_CHANNEL;  // Kept free by console_init()
     tuh_configure(BOARD_TUH_RHPORT, TUH_CFGID_RPI_PIO_USB_CONFIGURATION, &pio_cfg);
     
+    memset(stack_devices, 0, sizeof(stack_devices));
+    stack_current = NULL;
+    
     // Initialize TinyUSB host stack on PIO-USB port (port 1)
-    if (!tuh_init(BOARD_TUH_RHPORT)) {
+    return tuh_init(BOARD_TUH_RHPORT);
+}
+
+/**
+ * Core 1 entry point: run the host stack forever
+ */
+static void core1_main(void) {
+    bool ok = host_stack_init();
+    __atomic_store_n(&core1_status, ok ? CORE1_RUNNING : CORE1_FAILED, __ATOMIC_RELEASE);
+    hal_signal_event();
+    if (!ok) {
+        return;
+    }
+    
+    while (1) {
+        usb_host_stack_task();
+        
+        // PIO-USB frame interrupts wake the core when there is new work
+        if (!tuh_task_event_ready()) {
+            hal_wait_for_event(UINT64_MAX);
+        }
+    }
+}
+
+bool usb_host_init(void) {
+    LOG_INFO("USB Host: Initializing PIO-USB host stack...");
+    
+    memset(devices, 0, sizeof(devices));
+    connected_devices = 0;
+    updated_devices = 0;
+    ring_head = 0;
+    ring_tail = 0;
+    ring_dropped = 0;
+    core1_status = CORE1_STARTING;
+    
+    bool ok;
+    if (hal_core1_launch(core1_main)) {
+        // Wait for core 1 to report the stack start-up result
+        while (__atomic_load_n(&core1_status, __ATOMIC_ACQUIRE) == CORE1_STARTING) {
+            hal_wait_for_event(UINT64_MAX);
+        }
+        ok = core1_status == CORE1_RUNNING;
+    } else {
+        // Single core: the caller runs usb_host_stack_task() itself
+        ok = host_stack_init();
+    }
+    
+    if (!ok) {
         LOG_ERROR("USB Host: Failed to initialize TinyUSB host on PIO-USB");
         return false;
     }
     
-    memset(&current_gamepad_state, 0, sizeof(current_gamepad_state));
-    memset(&current_keyboard_state, 0, sizeof(current_keyboard_state));
-    memset(&device_info, 0, sizeof(device_info));
-    device_connected = false;
-    gamepad_state_valid = false;
-    keyboard_state_valid = false;
-    current_input_type = INPUT_TYPE_UNKNOWN;
-    
     LOG_INFO("USB Host: PIO-USB host stack initialized on port %d", BOARD_TUH_RHPORT);
     return true;
 }
 
 void usb_host_task(void) {
-    // Process USB host events via TinyUSB
-    tuh_task();
+    host_event_t event;
     
-    if (device_connected) {
-        if (current_input_type == INPUT_TYPE_GAMEPAD && gamepad_state_valid) {
-            // Process the gamepad state through remapping
-            remapping_process_input(&current_gamepad_state);
+    // Apply events up to and including one input snapshot, so every
+    // snapshot (and every button edge) is seen by the input task
+    while (ring_pop(&event)) {
+        host_device_t *device = &devices[event.device];
+        uint8_t device_bit = (uint8_t)(1u << event.device);
+        
+        switch (event.type) {
+            case HOST_EVENT_MOUNT:
+                LOG_INFO("USB Host: Device mounted - addr=%d, instance=%d",
+                         event.data.info.dev_addr, event.data.info.interface_num);
+                if (event.flags & HOST_EVENT_FLAG_NO_SLOT) {
+                    LOG_ERROR("USB Host: Too many input devices (max %d), ignoring device",
+                              USB_HOST_MAX_DEVICES);
+                    break;
+                }
+                
+                memset(device, 0, sizeof(*device));
+                device->info = event.data.info;
+                device->connected = true;
+                connected_devices |= device_bit;
+                
+                LOG_DEBUG("USB Host: VID=0x%04X, PID=0x%04X", device->info.vid, device->info.pid);
+                LOG_DEBUG("USB Host: Device name: %s", get_device_name(device->info.vid, device->info.pid));
+                LOG_INFO("USB Host: Detected %s device in slot %d",
+                         get_input_type_name(device->info.input_type), event.device);
+                if (device->info.input_type == INPUT_TYPE_GAMEPAD) {
+                    if (event.decoder == USB_HOST_DECODER_SPECIALIZED) {
+                        LOG_INFO("USB Host: Using specialized report decoder");
+                    } else if (event.decoder == USB_HOST_DECODER_DESCRIPTOR) {
+                        LOG_INFO("USB Host: Report descriptor compiled to %d fields", event.num_fields);
+                    } else {
+                        LOG_WARN("USB Host: No usable report descriptor, using fixed layout");
+                    }
+                }
+                if (event.flags & HOST_EVENT_FLAG_BOOT_PROTOCOL) {
+                    LOG_WARN("USB Host: Failed to set report protocol, using boot protocol");
+                }
+                if (event.flags & HOST_EVENT_FLAG_NO_REPORT) {
+                    LOG_ERROR("USB Host: Failed to request HID report");
+                }
+                sched_signal(SCHED_EVENT_HOST_CONNECT);
+                break;
+                
+            case HOST_EVENT_UNMOUNT:
+                LOG_INFO("USB Host: Device unmounted - addr=%d, instance=%d",
+                         device->info.dev_addr, device->info.interface_num);
+                if (device->info.vid != 0 || device->info.pid != 0) {
+                    LOG_DEBUG("USB Host: Disconnected device: %s (VID=0x%04X, PID=0x%04X)", 
+                              get_device_name(device->info.vid, device->info.pid),
+                              device->info.vid, device->info.pid);
+                }
+                
+                memset(device, 0, sizeof(*device));
+                connected_devices &= (uint8_t)~device_bit;
+                updated_devices &= (uint8_t)~device_bit;
+                sched_signal(SCHED_EVENT_HOST_CONNECT);
+                break;
+                
+            case HOST_EVENT_GAMEPAD:
+                if (!device->connected) {
+                    break;
+                }
+                device->gamepad = event.data.gamepad;
+                device->gamepad_valid = true;
+                device->input_us = event.timestamp_us;
+                updated_devices |= device_bit;
+                sched_signal(SCHED_EVENT_HID_INPUT);
+                return;
+                
+            case HOST_EVENT_KEYBOARD:
+                if (!device->connected) {
+                    break;
+                }
+                device->keyboard = event.data.keyboard;
+                device->keyboard_valid = true;
+                device->input_us = event.timestamp_us;
+                
+                // Log keyboard state for debugging
+                if (device->keyboard.num_keys > 0 || device->keyboard.modifiers != 0) {
+                    LOG_DEBUG("Keyboard %d: mod=0x%02X, keys=%d", event.device,
+                              device->keyboard.modifiers, 
+                              device->keyboard.num_keys);
+                }
+                return;
+                
+            default:
+                break;
         }
-        // Keyboard input is handled separately for debug purposes
     }
 }
 
+bool usb_host_task_pending(void) {
+    return __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE) != ring_tail;
+}
+
+void usb_host_stack_task(void) {
+    // Process USB host events via TinyUSB; reports arrive through the callbacks
+    tuh_task();
+}
+
+bool usb_host_stack_pending(void) {
+    return tuh_task_event_ready();
+}
+
+uint32_t usb_host_get_dropped_events(void) {
+    return ring_dropped;
+}
+
+void usb_host_get_decode_stats(usb_host_decode_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&decode_stats_seq, __ATOMIC_ACQUIRE);
+        *stats = decode_stats;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&decode_stats_seq, __ATOMIC_RELAXED));
+    
+    if (decode_stats_reset_request) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+const char* usb_host_get_decoder_name(uint8_t decoder) {
+    switch (decoder) {
+        case USB_HOST_DECODER_DESCRIPTOR:
+            return "descriptor";
+        case USB_HOST_DECODER_SPECIALIZED:
+            return "specialized";
+        default:
+            return "fixed";
+    }
+}
+
+void usb_host_reset_decode_stats(void) {
+    // Core 1 owns the counters and clears them with its next update
+    decode_stats_reset_request = true;
+}
+
 bool usb_host_device_connected(void) {
-    return device_connected;
+    return connected_devices != 0;
+}
+
+uint8_t usb_host_get_connected_devices(void) {
+    return connected_devices;
+}
+
+uint8_t usb_host_take_updated_devices(void) {
+    uint8_t updated = updated_devices;
+    updated_devices = 0;
+    return updated;
 }
 
-bool usb_host_get_gamepad_state(gamepad_state_t *state) {
-    if (!gamepad_state_valid || current_input_type != INPUT_TYPE_GAMEPAD) {
+bool usb_host_get_gamepad_state(uint8_t device, gamepad_state_t *state) {
+    if (device >= USB_HOST_MAX_DEVICES || !state) {
         return false;
     }
     
-    memcpy(state, &current_gamepad_state, sizeof(gamepad_state_t));
+    const host_device_t *dev = &devices[device];
+    if (!dev->gamepad_valid || dev->info.input_type != INPUT_TYPE_GAMEPAD) {
+        return false;
+    }
+    
+    memcpy(state, &dev->gamepad, sizeof(gamepad_state_t));
     return true;
 }
 
-bool usb_host_get_keyboard_state(keyboard_state_t *state) {
-    if (!keyboard_state_valid || current_input_type != INPUT_TYPE_KEYBOARD) {
+bool usb_host_get_keyboard_state(uint8_t device, keyboard_state_t *state) {
+    if (device >= USB_HOST_MAX_DEVICES || !state) {
+        return false;
+    }
+    
+    const host_device_t *dev = &devices[device];
+    if (!dev->keyboard_valid || dev->info.input_type != INPUT_TYPE_KEYBOARD) {
         return false;
     }
     
-    memcpy(state, &current_keyboard_state, sizeof(keyboard_state_t));
+    memcpy(state, &dev->keyboard, sizeof(keyboard_state_t));
     return true;
 }
 
-input_type_t usb_host_get_input_type(void) {
-    return current_input_type;
+uint64_t usb_host_get_input_time(uint8_t device) {
+    if (device >= USB_HOST_MAX_DEVICES || !devices[device].connected) {
+        return 0;
+    }
+    return devices[device].input_us;
 }
 
-bool usb_host_get_device_info(usb_device_info_t *info) {
-    if (!device_connected || !info) {
+input_type_t usb_host_get_input_type(uint8_t device) {
+    if (device >= USB_HOST_MAX_DEVICES || !devices[device].connected) {
+        return INPUT_TYPE_UNKNOWN;
+    }
+    return devices[device].info.input_type;
+}
+
+bool usb_host_get_device_info(uint8_t device, usb_device_info_t *info) {
+    if (device >= USB_HOST_MAX_DEVICES || !info || !devices[device].connected) {
         return false;
     }
     
-    memcpy(info, &device_info, sizeof(usb_device_info_t));
+    memcpy(info, &devices[device].info, sizeof(usb_device_info_t));
     return true;
 }
 
-// TinyUSB HID Host callbacks
+// TinyUSB HID Host callbacks (run on core 1; results go to core 0 as events)
 
 // Callback for when HID device is mounted (called by TinyUSB)
 void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_report, uint16_t desc_len) {
-    (void)desc_report;
-    (void)desc_len;
+    host_event_t *event = &stack_event;
+    memset(event, 0, sizeof(*event));
+    event->type = HOST_EVENT_MOUNT;
+    event->timestamp_us = hal_time_us();
     
-    // Store device address
-    device_info.dev_addr = dev_addr;
-    device_info.interface_num = instance;
+    usb_device_info_t *info = &event->data.info;
+    info->dev_addr = dev_addr;
+    info->interface_num = instance;
     
-    // Log basic mount information
-    LOG_INFO("USB Host: Device mounted - addr=%d, instance=%d", dev_addr, instance);
+    // Without a free slot the device is reported but never polled
+    stack_device_t *device = stack_alloc_device(dev_addr, instance);
+    if (!device) {
+        event->flags |= HOST_EVENT_FLAG_NO_SLOT;
+        ring_push(event);
+        return;
+    }
+    event->device = (uint8_t)(device - stack_devices);
     
     // Get VID/PID from device descriptor using TinyUSB API
-    tuh_vid_pid_get(dev_addr, &device_info.vid, &device_info.pid);
-    
-    // Log detailed device info
-    LOG_DEBUG("USB Host: VID=0x%04X, PID=0x%04X", device_info.vid, device_info.pid);
-    LOG_DEBUG("USB Host: Device name: %s", get_device_name(device_info.vid, device_info.pid));
+    tuh_vid_pid_get(dev_addr, &info->vid, &info->pid);
     
     // Determine input type from interface protocol using TinyUSB API
     uint8_t itf_protocol = tuh_hid_interface_protocol(dev_addr, instance);
+    info->interface_protocol = itf_protocol;
     
     // HID interface protocol values:
     // 0 = None (gamepad/joystick)
     // 1 = Keyboard
     // 2 = Mouse
     if (itf_protocol == HID_ITF_PROTOCOL_KEYBOARD) {
-        current_input_type = INPUT_TYPE_KEYBOARD;
-        LOG_INFO("USB Host: Detected keyboard device");
+        device->input_type = INPUT_TYPE_KEYBOARD;
     } else {
-        current_input_type = INPUT_TYPE_GAMEPAD;
-        LOG_INFO("USB Host: Detected gamepad/HID device");
+        device->input_type = INPUT_TYPE_GAMEPAD;
     }
+    info->input_type = device->input_type;
     
-    device_info.input_type = current_input_type;
-    device_connected = true;
+    // Pick the report decoder once: a specialized decoder for known
+    // controllers, else the compiled report descriptor, else the fixed layout
+    const known_device_t *known = get_known_device(info->vid, info->pid);
+    device->decode = known ? known->decode : NULL;
+    if (device->decode) {
+        device->decoder_kind = USB_HOST_DECODER_SPECIALIZED;
+        // Reports the specialized decoder does not know (e.g. the simple
+        // report a Switch Pro sends before its handshake) go through the
+        // descriptor until the first specialized report arrives
+        device->fallback = device->input_type == INPUT_TYPE_GAMEPAD &&
+                           hid_parser_compile(desc_report, desc_len, &device->decoder);
+    } else if (device->input_type == INPUT_TYPE_GAMEPAD &&
+               hid_parser_compile(desc_report, desc_len, &device->decoder)) {
+        device->decode = decode_descriptor;
+        device->decoder_kind = USB_HOST_DECODER_DESCRIPTOR;
+    } else {
+        device->decode = usb_host_decode_fixed_layout;
+        device->decoder_kind = USB_HOST_DECODER_FIXED;
+    }
+    event->num_fields = device->decoder.num_fields;
+    event->decoder = device->decoder_kind;
     
     // Set protocol to report mode (not boot mode) for full gamepad support
     if (!tuh_hid_set_protocol(dev_addr, instance, HID_PROTOCOL_REPORT)) {
-        LOG_WARN("USB Host: Failed to set report protocol, using boot protocol");
+        event->flags |= HOST_EVENT_FLAG_BOOT_PROTOCOL;
     }
     
     // Request first HID report
     if (!tuh_hid_receive_report(dev_addr, instance)) {
-        LOG_ERROR("USB Host: Failed to request HID report");
+        event->flags |= HOST_EVENT_FLAG_NO_REPORT;
     }
+    
+    if (known && known->switch_usb) {
+        device->switch_command = SWITCH_USB_HANDSHAKE;
+        switch_send_command(device);
+    }
+    
+    ring_push(event);
 }
 
 // Callback for when HID device is unmounted (called by TinyUSB)
 void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance) {
-    LOG_INFO("USB Host: Device unmounted - addr=%d, instance=%d", dev_addr, instance);
-    
-    // Log device info before clearing
-    if (device_info.vid != 0 || device_info.pid != 0) {
-        LOG_DEBUG("USB Host: Disconnected device: %s (VID=0x%04X, PID=0x%04X)", 
-                  get_device_name(device_info.vid, device_info.pid),
-                  device_info.vid, device_info.pid);
+    stack_device_t *device = stack_find_device(dev_addr, instance);
+    if (!device) {
+        return;
     }
     
-    device_connected = false;
-    gamepad_state_valid = false;
-    keyboard_state_valid = false;
-    current_input_type = INPUT_TYPE_UNKNOWN;
-    memset(&current_gamepad_state, 0, sizeof(current_gamepad_state));
-    memset(&current_keyboard_state, 0, sizeof(current_keyboard_state));
-    memset(&device_info, 0, sizeof(device_info));
+    host_event_t *event = &stack_event;
+    memset(event, 0, sizeof(*event));
+    event->type = HOST_EVENT_UNMOUNT;
+    event->device = (uint8_t)(device - stack_devices);
+    event->timestamp_us = hal_time_us();
+    
+    device->in_use = false;
+    ring_push(event);
 }
 
 // Callback for HID report received (called by TinyUSB)
 void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* report, uint16_t len) {
-    if (current_input_type == INPUT_TYPE_KEYBOARD) {
+    // Start of the input-to-output latency measurement
+    uint64_t received_us = hal_time_us();
+    
+    stack_device_t *device = stack_find_device(dev_addr, instance);
+    if (!device) {
+        return;
+    }
+    
+    host_event_t *event = &stack_event;
+    event->device = (uint8_t)(device - stack_devices);
+    counters_inc(COUNTER_REPORTS_RECEIVED);
+    
+    if (device->input_type == INPUT_TYPE_KEYBOARD) {
         // Parse keyboard HID report (standard boot protocol keyboard)
         // Boot protocol keyboard report format (8 bytes):
         // Byte 0: Modifier keys (Ctrl, Shift, Alt, GUI)
         // Byte 1: Reserved
         // Bytes 2-7: Key codes (up to 6 keys)
         if (len >= KEYBOARD_REPORT_SIZE) {
-            current_keyboard_state.modifiers = report[0];
-            current_keyboard_state.num_keys = 0;
+            keyboard_state_t *keyboard = &event->data.keyboard;
+            memset(keyboard, 0, sizeof(*keyboard));
+            keyboard->modifiers = report[0];
             
-            for (int i = KEYBOARD_REPORT_KEY_START; i < KEYBOARD_REPORT_SIZE && current_keyboard_state.num_keys < MAX_KEYBOARD_KEYS; i++) {
+            for (int i = KEYBOARD_REPORT_KEY_START; i < KEYBOARD_REPORT_SIZE && keyboard->num_keys < MAX_KEYBOARD_KEYS; i++) {
                 if (report[i] != 0) {
-                    current_keyboard_state.keys[current_keyboard_state.num_keys++] = report[i];
+                    keyboard->keys[keyboard->num_keys++] = report[i];
                 }
             }
             
-            keyboard_state_valid = true;
-            
-            // Log keyboard state for debugging
-            if (current_keyboard_state.num_keys > 0 || current_keyboard_state.modifiers != 0) {
-                LOG_DEBUG("Keyboard: mod=0x%02X, keys=%d", 
-                          current_keyboard_state.modifiers, 
-                          current_keyboard_state.num_keys);
-            }
+            event->type = HOST_EVENT_KEYBOARD;
+            event->timestamp_us = received_us;
+            counters_inc(COUNTER_REPORTS_DECODED);
+            ring_push(event);
+        } else {
+            counters_inc(COUNTER_REPORTS_UNDECODED);
         }
     } else {
-        // Parse HID report and update gamepad state
-        // This is a simplified parser - actual implementation would need to
-        // handle different gamepad types and report formats
+        // Decode into a copy so reports that are not input reports
+        // leave the last state untouched
+        gamepad_state_t decoded_state = device->gamepad;
+        stack_current = device;
+        uint32_t start = hal_cycle_count();
+        uint8_t decoder_kind = device->decoder_kind;
+        bool decoded = device->decode(report, len, &decoded_state);
+        if (decoded) {
+            device->fallback = false;
+        } else if (device->fallback) {
+            decoded = decode_descriptor(report, len, &decoded_state);
+            decoder_kind = USB_HOST_DECODER_DESCRIPTOR;
+        }
+        uint32_t cycles = hal_cycle_count() - start;
         
-        if (len >= 8) {
-            // Example parsing for standard gamepad report
-            current_gamepad_state.buttons = report[0] | (report[1] << 8);
-            current_gamepad_state.left_x = (int16_t)(report[2] | (report[3] << 8));
-            current_gamepad_state.left_y = (int16_t)(report[4] | (report[5] << 8));
-            
-            if (len >= 12) {
-                current_gamepad_state.right_x = (int16_t)(report[6] | (report[7] << 8));
-                current_gamepad_state.right_y = (int16_t)(report[8] | (report[9] << 8));
-                current_gamepad_state.left_trigger = report[10];
-                current_gamepad_state.right_trigger = report[11];
-            }
-            
-            gamepad_state_valid = true;
+        // Reports without gamepad fields (other report IDs) are ignored
+        if (decoded) {
+            device->gamepad = decoded_state;
+            decode_stats_record(device, decoder_kind, cycles);
+            event->type = HOST_EVENT_GAMEPAD;
+            event->timestamp_us = received_us;
+            event->data.gamepad = device->gamepad;
+            counters_inc(COUNTER_REPORTS_DECODED);
+            ring_push(event);
+        } else {
+            counters_inc(COUNTER_REPORTS_UNDECODED);
         }
     }
     
-    // Request next report from TinyUSB
-    tuh_hid_receive_report(dev_addr, instance);
+    if (device->switch_command) {
+        switch_handle_report(device, report, len);
+    }
+    
+    // Request next report from TinyUSB; if this fails the device stays quiet
+    if (!tuh_hid_receive_report(dev_addr, instance)) {
+        counters_inc(COUNTER_REARM_FAILED);
+    }
 }
@@ -22,6 +22,8 @@
 #define JC_BUTTON_START   (1 << 7)
 #define JC_BUTTON_LS      (1 << 8)
 #define JC_BUTTON_RS      (1 << 9)
+#define JC_BUTTON_HOME    (1 << 10)  // PS / Home / Guide
+#define JC_BUTTON_MISC    (1 << 11)  // Touchpad click / Capture
 
 // Input device types
 typedef enum {
@@ -30,6 +32,14 @@ typedef enum {
     INPUT_TYPE_KEYBOARD
 } input_type_t;
 
+// Maximum number of HID input devices connected at once (one slot per
+// interface, at least CFG_TUH_HID)
+#define USB_HOST_MAX_DEVICES 4
+
+// DMA channel PIO-USB transmits with. PIO-USB claims it outright when the
+// host stack starts on core 1, so nothing may hold it before then.
+#define USB_HOST_PIO_DMA_CHANNEL 0
+
 // Maximum number of keys that can be pressed simultaneously
 #define MAX_KEYBOARD_KEYS 6
 
@@ -65,48 +75,135 @@ typedef struct {
     input_type_t input_type;   // Detected input type
 } usb_device_info_t;
 
+// Report decoder selected at mount
+typedef enum {
+    USB_HOST_DECODER_FIXED = 0,    // Fixed layout, no usable report descriptor
+    USB_HOST_DECODER_DESCRIPTOR,   // Compiled report descriptor
+    USB_HOST_DECODER_SPECIALIZED   // Hand-written decoder for a known controller
+} usb_host_decoder_t;
+
+// Report decode statistics
+typedef struct {
+    uint32_t reports;       // Gamepad reports decoded
+    uint32_t cycles_last;   // Decode cost of the last report (hal_cycle_count units)
+    uint32_t cycles_max;    // Highest decode cost
+    uint64_t cycles_total;  // Sum of decode costs
+    uint8_t num_fields;     // Compiled descriptor fields, 0 = fixed layout
+    uint8_t decoder;        // usb_host_decoder_t
+} usb_host_decode_stats_t;
+
 /**
  * Initialize USB host
+ * Starts the host stack on core 1 and waits for it to come up.
  * @return true on success, false on failure
  */
 bool usb_host_init(void);
 
 /**
- * USB host task - must be called regularly in main loop
+ * USB host task (core 0) - applies input decoded by the host stack
+ * Takes at most one input snapshot per call. New input raises
+ * SCHED_EVENT_HID_INPUT; mount and unmount raise SCHED_EVENT_HOST_CONNECT.
  */
 void usb_host_task(void);
 
 /**
- * Check if a gamepad device is connected
+ * Check if decoded input is waiting for usb_host_task
+ * @return true if usb_host_task has work to do
+ */
+bool usb_host_task_pending(void);
+
+/**
+ * Run the TinyUSB host stack and decode reports
+ * Runs on core 1. Only call this from the main loop on platforms without
+ * a second core (hal_core1_launch returned false).
+ */
+void usb_host_stack_task(void);
+
+/**
+ * Check if the TinyUSB host stack has events waiting
+ * @return true if usb_host_stack_task has work to do
+ */
+bool usb_host_stack_pending(void);
+
+/**
+ * Get the number of input events lost because core 0 fell behind
+ * @return Dropped event count
+ */
+uint32_t usb_host_get_dropped_events(void);
+
+/**
+ * Get report decode statistics
+ * @param stats Pointer to store statistics
+ */
+void usb_host_get_decode_stats(usb_host_decode_stats_t *stats);
+
+/**
+ * Reset report decode statistics
+ */
+void usb_host_reset_decode_stats(void);
+
+/**
+ * Get the name of a report decoder
+ * @param decoder Decoder (usb_host_decoder_t)
+ * @return "fixed", "descriptor" or "specialized"
+ */
+const char* usb_host_get_decoder_name(uint8_t decoder);
+
+/**
+ * Check if any input device is connected
  * @return true if connected, false otherwise
  */
 bool usb_host_device_connected(void);
 
 /**
- * Get current gamepad state
+ * Get the connected device slots
+ * @return Bitmask of connected slots (bit n = device n)
+ */
+uint8_t usb_host_get_connected_devices(void);
+
+/**
+ * Get and clear the slots that received new input since the last call
+ * @return Bitmask of updated slots (bit n = device n)
+ */
+uint8_t usb_host_take_updated_devices(void);
+
+/**
+ * Get the current gamepad state of a device
+ * @param device Device slot (0 to USB_HOST_MAX_DEVICES - 1)
  * @param state Pointer to store gamepad state
  * @return true if state is valid, false otherwise
  */
-bool usb_host_get_gamepad_state(gamepad_state_t *state);
+bool usb_host_get_gamepad_state(uint8_t device, gamepad_state_t *state);
 
 /**
- * Get current keyboard state (for debug input)
+ * Get the current keyboard state of a device (for debug input)
+ * @param device Device slot
  * @param state Pointer to store keyboard state
  * @return true if state is valid, false otherwise
  */
-bool usb_host_get_keyboard_state(keyboard_state_t *state);
+bool usb_host_get_keyboard_state(uint8_t device, keyboard_state_t *state);
+
+/**
+ * Get when the current input state of a device was received
+ * @param device Device slot
+ * @return Receive time of its latest input report in us (hal_time_us),
+ *         0 if the slot is empty or has no input yet
+ */
+uint64_t usb_host_get_input_time(uint8_t device);
 
 /**
- * Get current input device type
- * @return Current input device type
+ * Get the input type of a device
+ * @param device Device slot
+ * @return Input device type, INPUT_TYPE_UNKNOWN if the slot is empty
  */
-input_type_t usb_host_get_input_type(void);
+input_type_t usb_host_get_input_type(uint8_t device);
 
 /**
- * Get connected device info
+ * Get device info
+ * @param device Device slot
  * @param info Pointer to store device info
  * @return true if device is connected, false otherwise
  */
-bool usb_host_get_device_info(usb_device_info_t *info);
+bool usb_host_get_device_info(uint8_t device, usb_device_info_t *info);
 
 #endif // USB_HOST_H
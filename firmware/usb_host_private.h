@@ -0,0 +1,26 @@
+/**
+ * USB Host Module Internals
+ *
+ * Parts of usb_host.c that are not module API but are used by the host
+ * build's benchmarks, so they measure the firmware code itself.
+ */
+
+#ifndef USB_HOST_PRIVATE_H
+#define USB_HOST_PRIVATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "usb_host.h"
+
+/**
+ * Decode the fixed layout used when no report descriptor is available:
+ * buttons in bytes 0-1, sticks in bytes 2-9, triggers in bytes 10-11
+ * Fields not in the report keep their previous value.
+ * @param report Report bytes
+ * @param len Report length (at least 8)
+ * @param gamepad State to update
+ * @return true if the report was long enough
+ */
+bool usb_host_decode_fixed_layout(const uint8_t *report, uint16_t len, gamepad_state_t *gamepad);
+
+#endif // USB_HOST_PRIVATE_H
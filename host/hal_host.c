@@ -0,0 +1,177 @@
+/**
+ * Hardware Abstraction Layer - Host Implementation
+ *
+ * Virtual clock and file-backed flash for running the firmware modules on
+ * Linux. Only the last HOST_FLASH_SECTORS sectors of flash are backed; the
+ * rest reads as erased.
+ */
+
+#include "hal.h"
+#include "host_sim.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Same size as the Pico 2 flash so offsets match the firmware
+#define HOST_FLASH_SIZE (4u * 1024u * 1024u)
+#define HOST_FLASH_BACKED (HOST_FLASH_SECTORS * HAL_FLASH_SECTOR_SIZE)
+#define HOST_FLASH_BASE (HOST_FLASH_SIZE - HOST_FLASH_BACKED)
+
+static uint64_t virtual_time_us = 0;
+
+static uint8_t flash_area[HOST_FLASH_BACKED];
+static uint8_t flash_erased[HAL_FLASH_SECTOR_SIZE];
+static bool flash_initialized = false;
+static const char *flash_path = NULL;
+static int32_t flash_ops_left = -1;  // Calls before flash "loses power", -1 = never
+
+static void flash_init_once(void) {
+    if (!flash_initialized) {
+        memset(flash_area, 0xFF, sizeof(flash_area));
+        memset(flash_erased, 0xFF, sizeof(flash_erased));
+        flash_initialized = true;
+    }
+}
+
+static bool flash_sync(void) {
+    if (!flash_path) {
+        return true;
+    }
+
+    FILE *f = fopen(flash_path, "wb");
+    if (!f) {
+        return false;
+    }
+    size_t written = fwrite(flash_area, 1, sizeof(flash_area), f);
+    fclose(f);
+    return written == sizeof(flash_area);
+}
+
+void host_clock_advance_us(uint64_t us) {
+    virtual_time_us += us;
+}
+
+void host_clock_set_us(uint64_t us) {
+    virtual_time_us = us;
+}
+
+bool host_flash_open(const char *path) {
+    flash_init_once();
+    memset(flash_area, 0xFF, sizeof(flash_area));
+    flash_path = path;
+    flash_ops_left = -1;
+
+    if (!path) {
+        return true;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        // New flash file, start erased
+        return flash_sync();
+    }
+    size_t read = fread(flash_area, 1, sizeof(flash_area), f);
+    fclose(f);
+    (void)read;  // Short files leave the remainder erased
+    return true;
+}
+
+uint32_t hal_time_ms(void) {
+    return (uint32_t)(virtual_time_us / 1000);
+}
+
+uint64_t hal_time_us(void) {
+    return virtual_time_us;
+}
+
+uint32_t hal_cycle_count(void) {
+    // Wall-clock nanoseconds stand in for CPU cycles
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec);
+}
+
+uint32_t hal_cycle_hz(void) {
+    return 1000000000u;
+}
+
+void hal_signal_event(void) {
+    // Single-threaded simulation: nothing sleeps while an event is raised
+}
+
+void hal_wait_for_event(uint64_t deadline_us) {
+    // Sleeping skips the virtual clock ahead to the deadline
+    if (deadline_us != UINT64_MAX && deadline_us > virtual_time_us) {
+        virtual_time_us = deadline_us;
+    }
+}
+
+bool hal_core1_launch(void (*entry)(void)) {
+    // Single-threaded simulation: the driver runs core 1 work itself
+    (void)entry;
+    return false;
+}
+
+uint32_t hal_flash_size(void) {
+    return HOST_FLASH_SIZE;
+}
+
+const uint8_t* hal_flash_read(uint32_t offset) {
+    flash_init_once();
+    if (offset < HOST_FLASH_BASE || offset >= HOST_FLASH_SIZE) {
+        // Unbacked flash reads as erased
+        return flash_erased;
+    }
+    return &flash_area[offset - HOST_FLASH_BASE];
+}
+
+void host_flash_fail_after(int32_t ops) {
+    flash_ops_left = ops;
+}
+
+/**
+ * Count a flash operation against the injected failure
+ * @return true if the operation may go ahead
+ */
+static bool flash_op_allowed(void) {
+    if (flash_ops_left == 0) {
+        return false;
+    }
+    if (flash_ops_left > 0) {
+        flash_ops_left--;
+    }
+    return true;
+}
+
+bool hal_flash_erase(uint32_t offset, uint32_t len) {
+    flash_init_once();
+    if ((offset % HAL_FLASH_SECTOR_SIZE) != 0 || (len % HAL_FLASH_SECTOR_SIZE) != 0 ||
+        offset < HOST_FLASH_BASE || offset + len > HOST_FLASH_SIZE) {
+        return false;
+    }
+    if (!flash_op_allowed()) {
+        return false;
+    }
+
+    memset(&flash_area[offset - HOST_FLASH_BASE], 0xFF, len);
+    return flash_sync();
+}
+
+bool hal_flash_program(uint32_t offset, const void *data, uint32_t len) {
+    flash_init_once();
+    if ((offset % HAL_FLASH_PAGE_SIZE) != 0 ||
+        offset < HOST_FLASH_BASE || offset + len > HOST_FLASH_SIZE) {
+        return false;
+    }
+    if (!flash_op_allowed()) {
+        return false;
+    }
+
+    // NOR flash programming can only clear bits
+    uint8_t *dst = &flash_area[offset - HOST_FLASH_BASE];
+    const uint8_t *src = (const uint8_t *)data;
+    for (uint32_t i = 0; i < len; i++) {
+        dst[i] &= src[i];
+    }
+    return flash_sync();
+}
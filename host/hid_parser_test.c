@@ -0,0 +1,91 @@
+/**
+ * Joystick Converter - HID Report Parser Test
+ *
+ * Compiles a report descriptor that splits a gamepad over two report IDs
+ * and decodes their reports in turn into the same state: each report must
+ * update only the fields of its own ID, button fields only their own bits,
+ * and the hat re-centres only from a report that carries it.
+ *
+ * Usage: hid_parser_test (exit status 0 when every check passes)
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "hid_parser.h"
+
+// Report 1: X, Y, hat and buttons 9-12; report 2: buttons 1-8
+static const uint8_t split_descriptor[] = {
+    0x05, 0x01,        // Usage Page (Generic Desktop)
+    0x09, 0x05,        // Usage (Gamepad)
+    0xA1, 0x01,        // Collection (Application)
+    0x85, 0x01,        //   Report ID (1)
+    0x09, 0x30,        //   Usage (X)
+    0x09, 0x31,        //   Usage (Y)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,  //   Logical Maximum (255)
+    0x75, 0x08,        //   Report Size (8)
+    0x95, 0x02,        //   Report Count (2)
+    0x81, 0x02,        //   Input (Data, Var, Abs)
+    0x09, 0x39,        //   Usage (Hat Switch)
+    0x25, 0x07,        //   Logical Maximum (7)
+    0x75, 0x04,        //   Report Size (4)
+    0x95, 0x01,        //   Report Count (1)
+    0x81, 0x42,        //   Input (Data, Var, Abs, Null State)
+    0x05, 0x09,        //   Usage Page (Button)
+    0x19, 0x09,        //   Usage Minimum (9)
+    0x29, 0x0C,        //   Usage Maximum (12)
+    0x25, 0x01,        //   Logical Maximum (1)
+    0x75, 0x01,        //   Report Size (1)
+    0x95, 0x04,        //   Report Count (4)
+    0x81, 0x02,        //   Input (Data, Var, Abs)
+    0x85, 0x02,        //   Report ID (2)
+    0x19, 0x01,        //   Usage Minimum (1)
+    0x29, 0x08,        //   Usage Maximum (8)
+    0x95, 0x08,        //   Report Count (8)
+    0x81, 0x02,        //   Input (Data, Var, Abs)
+    0xC0,              // End Collection
+};
+
+int main(void) {
+    hid_decoder_t decoder;
+    CHECK(hid_parser_compile(split_descriptor, sizeof(split_descriptor), &decoder));
+    CHECK(decoder.uses_report_ids);
+
+    gamepad_state_t state;
+    memset(&state, 0, sizeof(state));
+
+    // Sticks to the corners, hat up, buttons 9 and 12
+    const uint8_t sticks[] = {0x01, 0xFF, 0x00, 0x90};
+    CHECK(hid_parser_decode(&decoder, sticks, sizeof(sticks), &state));
+    CHECK(state.left_x == 32767 && state.left_y == -32768);
+    CHECK(state.dpad_x == 0 && state.dpad_y == -1);
+    CHECK(state.buttons == 0x0900);
+
+    // Buttons 1 and 3 leave the sticks, hat and buttons 9-12 alone
+    const uint8_t buttons[] = {0x02, 0x05};
+    CHECK(hid_parser_decode(&decoder, buttons, sizeof(buttons), &state));
+    CHECK(state.buttons == 0x0905);
+    CHECK(state.left_x == 32767 && state.left_y == -32768);
+    CHECK(state.dpad_x == 0 && state.dpad_y == -1);
+
+    // Hat released (null state) and button 9 up; buttons 1-8 stay
+    const uint8_t released[] = {0x01, 0xFF, 0x00, 0x88};
+    CHECK(hid_parser_decode(&decoder, released, sizeof(released), &state));
+    CHECK(state.dpad_x == 0 && state.dpad_y == 0);
+    CHECK(state.buttons == 0x0805);
+
+    // Buttons 1-8 released; buttons 9-12 stay
+    const uint8_t none[] = {0x02, 0x00};
+    CHECK(hid_parser_decode(&decoder, none, sizeof(none), &state));
+    CHECK(state.buttons == 0x0800);
+
+    // A report ID without compiled fields changes nothing
+    gamepad_state_t before = state;
+    const uint8_t unknown[] = {0x03, 0xFF, 0xFF};
+    CHECK(!hid_parser_decode(&decoder, unknown, sizeof(unknown), &state));
+    CHECK(memcmp(&before, &state, sizeof(state)) == 0);
+
+    return host_test_result();
+}
@@ -0,0 +1,508 @@
+/**
+ * Joystick Converter - Host Simulation Entry Point
+ *
+ * Runs the firmware input pipeline on Linux against the HAL and TinyUSB
+ * stand-ins. A simulated gamepad produces synthetic reports on a virtual
+ * clock, which are pushed through usb_host -> remapping -> usb_device and
+ * the macro engine by the same event-driven scheduler the firmware uses,
+ * as fast as the host can run them.
+ *
+ * Usage: joystick_converter_host [-n reports] [-i interval_us] [-o output]
+ *                                [-d devices] [-f flash_file] [-t stream_file]
+ *                                [-s seed] [-r] [-v]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hal.h"
+#include "host_sim.h"
+#include "tusb.h"
+#include "usb_host.h"
+#include "usb_device.h"
+#include "config.h"
+#include "remapping.h"
+#include "output.h"
+#include "macro.h"
+#include "logging.h"
+#include "sched.h"
+#include "telemetry.h"
+#include "latency.h"
+#include "counters.h"
+#include "bench.h"
+
+// Simulated controller
+#define SIM_DEV_ADDR   1
+#define SIM_INSTANCE   0
+#define SIM_VID        0x1209
+#define SIM_PID        0xC0DE
+
+// Report descriptor of the simulated controller: 16 buttons, four 16-bit
+// sticks (X, Y, Z, Rz) and two 8-bit triggers (Rx, Ry)
+static const uint8_t sim_report_desc[] = {
+    0x05, 0x01,        // Usage Page (Generic Desktop)
+    0x09, 0x05,        // Usage (Gamepad)
+    0xA1, 0x01,        // Collection (Application)
+    0x05, 0x09,        //   Usage Page (Button)
+    0x19, 0x01,        //   Usage Minimum (1)
+    0x29, 0x10,        //   Usage Maximum (16)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x25, 0x01,        //   Logical Maximum (1)
+    0x75, 0x01,        //   Report Size (1)
+    0x95, 0x10,        //   Report Count (16)
+    0x81, 0x02,        //   Input (Data, Variable, Absolute)
+    0x05, 0x01,        //   Usage Page (Generic Desktop)
+    0x09, 0x30,        //   Usage (X)
+    0x09, 0x31,        //   Usage (Y)
+    0x09, 0x32,        //   Usage (Z)
+    0x09, 0x35,        //   Usage (Rz)
+    0x16, 0x00, 0x80,  //   Logical Minimum (-32768)
+    0x26, 0xFF, 0x7F,  //   Logical Maximum (32767)
+    0x75, 0x10,        //   Report Size (16)
+    0x95, 0x04,        //   Report Count (4)
+    0x81, 0x02,        //   Input (Data, Variable, Absolute)
+    0x09, 0x33,        //   Usage (Rx)
+    0x09, 0x34,        //   Usage (Ry)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,  //   Logical Maximum (255)
+    0x75, 0x08,        //   Report Size (8)
+    0x95, 0x02,        //   Report Count (2)
+    0x81, 0x02,        //   Input (Data, Variable, Absolute)
+    0xC0               // End Collection
+};
+
+// HID keyboard usage codes used by the sample profile
+#define SIM_KEY_A      0x04
+#define SIM_KEY_SPACE  0x2C
+
+typedef struct {
+    uint32_t num_reports;
+    uint32_t interval_us;
+    output_type_t output_type;
+    uint8_t num_devices;
+    const char *flash_path;
+    const char *stream_path;
+    uint32_t seed;
+    bool raw_layout;
+    bool profile;
+    uint32_t bench_reports;
+    bool verbose;
+} sim_options_t;
+
+static uint32_t rng_state = 1;
+
+static uint32_t sim_rand(void) {
+    // xorshift32
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint64_t wall_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool parse_output_type(const char *name, output_type_t *type) {
+    static const struct {
+        const char *name;
+        output_type_t type;
+    } names[] = {
+        {"gamepad", OUTPUT_TYPE_GAMEPAD},
+        {"keyboard", OUTPUT_TYPE_KEYBOARD},
+        {"mouse", OUTPUT_TYPE_MOUSE},
+        {"combo", OUTPUT_TYPE_COMBO},
+    };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(name, names[i].name) == 0) {
+            *type = names[i].type;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-n reports] [-i interval_us] [-o gamepad|keyboard|mouse|combo]\n"
+            "          [-d devices] [-f flash_file] [-t stream_file] [-s seed] [-b reports] [-r] [-p] [-v]\n"
+            "  -d  number of simulated controllers (1-%d), reports go round-robin\n"
+            "  -t  write the 1 kHz telemetry stream (STREAM_START) to a file\n"
+            "  -r  attach without a report descriptor (fixed-layout decoding)\n"
+            "  -b  run the BENCH pipeline benchmark on the sample profile and exit\n"
+            "  -p  print the run time of each scheduler task (PROF)\n",
+            prog, USB_HOST_MAX_DEVICES);
+}
+
+static bool parse_options(int argc, char **argv, sim_options_t *opts) {
+    opts->num_reports = 100000;
+    opts->interval_us = 1000;
+    opts->output_type = OUTPUT_TYPE_COMBO;
+    opts->num_devices = 1;
+    opts->flash_path = NULL;
+    opts->stream_path = NULL;
+    opts->seed = 1;
+    opts->raw_layout = false;
+    opts->profile = false;
+    opts->bench_reports = 0;
+    opts->verbose = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:i:o:d:f:t:s:b:rpvh")) != -1) {
+        switch (c) {
+            case 'n':
+                opts->num_reports = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                opts->interval_us = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                if (!parse_output_type(optarg, &opts->output_type)) {
+                    return false;
+                }
+                break;
+            case 'd':
+                opts->num_devices = (uint8_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                opts->flash_path = optarg;
+                break;
+            case 't':
+                opts->stream_path = optarg;
+                break;
+            case 's':
+                opts->seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                opts->raw_layout = true;
+                break;
+            case 'b':
+                opts->bench_reports = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                opts->profile = true;
+                break;
+            case 'v':
+                opts->verbose = true;
+                break;
+            default:
+                return false;
+        }
+    }
+    return opts->interval_us > 0 &&
+           opts->num_devices >= 1 && opts->num_devices <= USB_HOST_MAX_DEVICES;
+}
+
+/**
+ * Install a sample profile exercising every mapping type
+ */
+static void setup_profile(output_type_t output_type) {
+    config_t *cfg = config_get();
+    cfg->output_type = output_type;
+
+    if (output_type != OUTPUT_TYPE_GAMEPAD) {
+        config_add_mapping(JC_BUTTON_A, MAPPING_TYPE_KEY, SIM_KEY_A, 0);
+        config_add_mapping(JC_BUTTON_B, MAPPING_TYPE_KEY, SIM_KEY_SPACE, 0);
+        config_add_mapping(JC_BUTTON_LB, MAPPING_TYPE_MOUSE_BUTTON, 0x01, 0);
+        config_add_mapping(JC_BUTTON_X, MAPPING_TYPE_MACRO, 0, 0);
+    }
+
+    // Tap A, then move the mouse by (10, -10) (zigzag varints 20 and 19)
+    static const uint8_t macro[] = {
+        MACRO_OP_KEY_DOWN, SIM_KEY_A,
+        MACRO_OP_DELAY, 5,
+        MACRO_OP_KEY_UP, SIM_KEY_A,
+        MACRO_OP_MOUSE_MOVE, 20, 19,
+    };
+    macro_add(0, macro, sizeof(macro));
+
+    usb_device_set_output_type(output_type);
+}
+
+//--------------------------------------------------------------------
+// Scheduler tasks (mirrors the firmware main loop, without serial/LED)
+// plus the core 1 host stack
+//--------------------------------------------------------------------
+
+static int mouse_task_id = -1;
+static bool mouse_ticking = false;
+
+static void usb_device_sched_task(void) {
+    usb_device_task();
+    sched_wake_at(sched_current_task(), usb_device_next_deadline_us());
+}
+
+static void input_task(void) {
+    uint8_t connected = usb_host_get_connected_devices();
+    uint8_t updated = usb_host_take_updated_devices();
+
+    for (uint8_t device = 0; device < USB_HOST_MAX_DEVICES; device++) {
+        uint8_t device_bit = (uint8_t)(1u << device);
+        gamepad_state_t state;
+
+        if (!(connected & device_bit)) {
+            remapping_remove_device(device);
+        } else if ((updated & device_bit) && usb_host_get_gamepad_state(device, &state)) {
+            remapping_process_input(device, &state, usb_host_get_input_time(device));
+        }
+    }
+
+    if (!mouse_ticking && remapping_mouse_active()) {
+        mouse_ticking = true;
+        sched_wake_at(mouse_task_id, hal_time_us());
+    }
+}
+
+static void mouse_task(void) {
+    remapping_mouse_task();
+
+    mouse_ticking = remapping_mouse_active();
+    if (mouse_ticking) {
+        sched_wake_at(sched_current_task(), hal_time_us() + OUTPUT_FRAME_US);
+    }
+}
+
+static void macro_sched_task(void) {
+    macro_task();
+    sched_wake_at(sched_current_task(), macro_next_deadline_us());
+}
+
+static void output_sched_task(void) {
+    output_task();
+    sched_wake_at(sched_current_task(), output_next_deadline_us());
+}
+
+static void telemetry_sched_task(void) {
+    telemetry_task();
+    sched_wake_at(sched_current_task(), telemetry_next_deadline_us());
+}
+
+static void sched_setup(void) {
+    sched_init();
+    sched_add_task("usb_device", usb_device_sched_task, 0, 0, usb_device_task_pending);
+    // No second core here, so the host stack runs as a task of its own
+    sched_add_task("usb_host_stack", usb_host_stack_task, 1, 0, usb_host_stack_pending);
+    sched_add_task("usb_host", usb_host_task, 1, 0, usb_host_task_pending);
+    sched_add_task("input", input_task, 2, SCHED_EVENT_HID_INPUT | SCHED_EVENT_HOST_CONNECT, NULL);
+    mouse_task_id = sched_add_task("mouse", mouse_task, 3, 0, NULL);
+    sched_add_task("macro", macro_sched_task, 4, SCHED_EVENT_MACRO, NULL);
+    sched_add_task("output", output_sched_task, 5, SCHED_EVENT_OUTPUT, NULL);
+    int telemetry_id = sched_add_task("telemetry", telemetry_sched_task, 6, 0, NULL);
+    sched_wake_at(telemetry_id, telemetry_next_deadline_us());
+}
+
+/**
+ * Run the scheduler until the given virtual time, sleeping between deadlines
+ * @return Number of scheduler passes that ran at least one task
+ */
+static uint32_t run_until(uint64_t end_us) {
+    uint32_t passes = 0;
+    while (1) {
+        while (sched_poll()) {
+            passes++;
+        }
+        // Advance to the next USB frame as well, where a transfer may complete
+        uint64_t next = sched_next_deadline();
+        uint64_t frame = (hal_time_us() / OUTPUT_FRAME_US + 1) * OUTPUT_FRAME_US;
+        if (frame < next) {
+            next = frame;
+        }
+        if (next >= end_us) {
+            break;
+        }
+        hal_wait_for_event(next);
+    }
+    hal_wait_for_event(end_us);
+    return passes;
+}
+
+/**
+ * Build a synthetic gamepad report: random buttons, sweeping sticks
+ */
+static uint16_t build_report(uint8_t *report, uint32_t n) {
+    uint16_t buttons = 0;
+    // Change a button roughly every fourth report
+    static uint16_t held = 0;
+    if ((sim_rand() & 3) == 0) {
+        held ^= (uint16_t)(1u << (sim_rand() % 10));
+    }
+    buttons = held;
+
+    int16_t sweep = (int16_t)((n * 64) & 0xFFFF);
+    int16_t lx = sweep;
+    int16_t ly = (int16_t)-sweep;
+    int16_t rx = (int16_t)(sweep / 2);
+    int16_t ry = (int16_t)(-sweep / 2);
+
+    report[0] = (uint8_t)(buttons & 0xFF);
+    report[1] = (uint8_t)(buttons >> 8);
+    report[2] = (uint8_t)(lx & 0xFF);
+    report[3] = (uint8_t)((uint16_t)lx >> 8);
+    report[4] = (uint8_t)(ly & 0xFF);
+    report[5] = (uint8_t)((uint16_t)ly >> 8);
+    report[6] = (uint8_t)(rx & 0xFF);
+    report[7] = (uint8_t)((uint16_t)rx >> 8);
+    report[8] = (uint8_t)(ry & 0xFF);
+    report[9] = (uint8_t)((uint16_t)ry >> 8);
+    report[10] = (uint8_t)(n & 0xFF);
+    report[11] = (uint8_t)(255 - (n & 0xFF));
+    return 12;
+}
+
+int main(int argc, char **argv) {
+    sim_options_t opts;
+    if (!parse_options(argc, argv, &opts)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Module chatter goes to stdout; keep it out of the way unless asked
+    if (!opts.verbose) {
+        fflush(stdout);
+        if (!freopen("/dev/null", "w", stdout)) {
+            fprintf(stderr, "Warning: could not silence module output\n");
+        }
+    }
+
+    rng_state = opts.seed ? opts.seed : 1;
+
+    if (!host_flash_open(opts.flash_path)) {
+        fprintf(stderr, "Failed to open flash file %s\n", opts.flash_path);
+        return 1;
+    }
+
+    logging_init();
+    if (!config_load()) {
+        config_set_defaults();
+    }
+    usb_host_init();
+    usb_device_init();
+    output_init();
+    remapping_init();
+    macro_init();
+    setup_profile(opts.output_type);
+
+    FILE *stream_file = NULL;
+    if (opts.stream_path) {
+        stream_file = fopen(opts.stream_path, "wb");
+        if (!stream_file) {
+            fprintf(stderr, "Failed to open stream file %s\n", opts.stream_path);
+            return 1;
+        }
+        host_cdc_set_output(stream_file);
+        telemetry_start(TELEMETRY_MAX_RATE);
+    }
+
+    sched_setup();
+    for (uint8_t i = 0; i < opts.num_devices; i++) {
+        host_usb_attach(SIM_DEV_ADDR + i, SIM_INSTANCE, SIM_VID, SIM_PID, HID_ITF_PROTOCOL_NONE,
+                        opts.raw_layout ? NULL : sim_report_desc,
+                        opts.raw_layout ? 0 : (uint16_t)sizeof(sim_report_desc));
+    }
+    host_hid_reset_stats();
+
+    if (opts.bench_reports > 0) {
+        bench_result_t bench;
+        if (!bench_run(opts.bench_reports, &bench)) {
+            fprintf(stderr, "Benchmark failed (1-%d reports, needs a free device slot)\n", BENCH_MAX_REPORTS);
+            return 1;
+        }
+        // Host cycles are wall-clock nanoseconds
+        fprintf(stderr, "Bench:             %u reports, %u reports/s, %.0f ns avg, %u ns max, %u macro triggers\n",
+                bench.reports, bench.reports_per_sec,
+                bench.cycles_avg * 1e9 / hal_cycle_hz(),
+                (uint32_t)((uint64_t)bench.cycles_max * 1000000000u / hal_cycle_hz()),
+                bench.macro_triggers);
+        return 0;
+    }
+
+    uint32_t passes = 0;
+    uint64_t start_ns = wall_time_ns();
+    for (uint32_t n = 0; n < opts.num_reports; n++) {
+        uint8_t report[16];
+        uint16_t len = build_report(report, n);
+        host_usb_queue_report((uint8_t)(SIM_DEV_ADDR + n % opts.num_devices), SIM_INSTANCE,
+                              report, len);
+
+        passes += run_until(hal_time_us() + opts.interval_us);
+    }
+    uint64_t elapsed_ns = wall_time_ns() - start_ns;
+
+    const host_hid_stats_t *stats = host_hid_get_stats();
+    double per_report_ns = opts.num_reports ? (double)elapsed_ns / opts.num_reports : 0.0;
+
+    fprintf(stderr, "Reports in:        %u (%.1f s virtual)\n", opts.num_reports,
+            (double)hal_time_us() / 1e6);
+    fprintf(stderr, "Wall time:         %.3f ms (%.0f ns/report)\n",
+            (double)elapsed_ns / 1e6, per_report_ns);
+    fprintf(stderr, "Scheduler passes:  %u\n", passes);
+    fprintf(stderr, "HID reports out:   %u (gamepad %u, keyboard %u, mouse %u)\n",
+            stats->reports_sent, stats->reports_by_id[1],
+            stats->reports_by_id[2], stats->reports_by_id[3]);
+    fprintf(stderr, "HID sends refused: %u (endpoint busy)\n", stats->reports_busy);
+
+    usb_host_decode_stats_t decode_stats;
+    usb_host_get_decode_stats(&decode_stats);
+    fprintf(stderr, "Decode:            %s, %.0f ns/report avg, %u ns max\n",
+            usb_host_get_decoder_name(decode_stats.decoder),
+            decode_stats.reports ? (double)decode_stats.cycles_total / decode_stats.reports : 0.0,
+            decode_stats.cycles_max);
+
+    usb_device_stats_t dev_stats;
+    usb_device_get_stats(&dev_stats);
+    fprintf(stderr, "Suppressed:        %u (gamepad %u, keyboard %u, mouse %u)\n",
+            dev_stats.gamepad.suppressed + dev_stats.keyboard.suppressed + dev_stats.mouse.suppressed,
+            dev_stats.gamepad.suppressed, dev_stats.keyboard.suppressed, dev_stats.mouse.suppressed);
+
+    counters_t counters;
+    counters_snapshot(&counters, false);
+    fprintf(stderr, "Counters:         ");
+    for (uint8_t i = 0; i < COUNTER_COUNT; i++) {
+        fprintf(stderr, " %s=%u", counters_name((counter_id_t)i), counters.values[i]);
+    }
+    fprintf(stderr, "\n");
+
+    latency_stats_t latency;
+    latency_get_stats(&latency);
+    fprintf(stderr, "Latency (virtual): %u samples, min %u us, p50 %u us, p99 %u us, max %u us\n",
+            latency.count, latency.min_us, latency.p50_us, latency.p99_us, latency.max_us);
+
+    if (stream_file) {
+        telemetry_stats_t telemetry_stats;
+        telemetry_get_stats(&telemetry_stats);
+        fprintf(stderr, "Telemetry:         %u frames, %u bytes (%.1f bytes/frame), %u deferred\n",
+                telemetry_stats.frames, telemetry_stats.bytes,
+                telemetry_stats.frames ? (double)telemetry_stats.bytes / telemetry_stats.frames : 0.0,
+                telemetry_stats.deferred);
+    }
+
+    if (opts.profile) {
+        // Host cycles are wall-clock nanoseconds
+        double cycles_per_us = hal_cycle_hz() / 1e6;
+        fprintf(stderr, "%-16s %10s %10s %10s %9s\n", "Task", "Calls", "Avg us", "Max us", "Overruns");
+        const char *name;
+        sched_task_stats_t task_stats;
+        for (uint8_t id = 0; id < sched_task_count(); id++) {
+            sched_get_task_stats(id, &name, NULL, &task_stats);
+            fprintf(stderr, "%-16s %10u %10.2f %10.2f %9u\n", name, task_stats.calls,
+                    task_stats.calls ? task_stats.cycles_total / cycles_per_us / task_stats.calls : 0.0,
+                    task_stats.cycles_max / cycles_per_us, task_stats.overruns);
+        }
+    }
+
+    for (uint8_t i = 0; i < opts.num_devices; i++) {
+        host_usb_detach(SIM_DEV_ADDR + i, SIM_INSTANCE);
+    }
+    if (stream_file) {
+        // Disconnect frames for the detached devices
+        run_until(hal_time_us() + 2 * OUTPUT_FRAME_US);
+        fclose(stream_file);
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+/**
+ * Host Simulation Interface
+ *
+ * Controls for the Linux stand-ins of the hardware abstraction layer and
+ * TinyUSB: a virtual clock, a file-backed flash area, simulated USB host
+ * devices, a simulated HID IN endpoint and a simulated CDC serial port.
+ */
+
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Number of sectors at the end of flash backed by the host flash file
+#define HOST_FLASH_SECTORS 16
+
+// Number of HID report IDs tracked by the simulated IN endpoint
+#define HOST_HID_MAX_REPORT_ID 8
+
+// HID output statistics
+typedef struct {
+    uint32_t reports_sent;                              // Reports accepted by tud_hid_report
+    uint32_t reports_busy;                              // tud_hid_report calls while busy
+    uint32_t reports_by_id[HOST_HID_MAX_REPORT_ID];     // Accepted reports per report ID
+    uint8_t last_report[HOST_HID_MAX_REPORT_ID][64];    // Last report per report ID
+    uint16_t last_len[HOST_HID_MAX_REPORT_ID];          // Length of last report per report ID
+} host_hid_stats_t;
+
+/**
+ * Advance the virtual clock
+ * @param us Microseconds to advance
+ */
+void host_clock_advance_us(uint64_t us);
+
+/**
+ * Set the virtual clock
+ * @param us Absolute time in microseconds
+ */
+void host_clock_set_us(uint64_t us);
+
+/**
+ * Back the flash storage area with a file
+ * The file is loaded if it exists and rewritten on every erase/program.
+ * @param path File path, or NULL for a RAM-only flash
+ * @return true on success, false on I/O error
+ */
+bool host_flash_open(const char *path);
+
+/**
+ * Make flash operations fail, as if power was lost partway through a write
+ * After ops more erase/program calls succeed, every further call returns
+ * false without touching flash.
+ * @param ops Calls that still succeed, or -1 to never fail (default)
+ */
+void host_flash_fail_after(int32_t ops);
+
+/**
+ * Attach a simulated HID device (calls tuh_hid_mount_cb)
+ * @param dev_addr Device address
+ * @param instance HID instance
+ * @param vid Vendor ID
+ * @param pid Product ID
+ * @param itf_protocol HID interface protocol (HID_ITF_PROTOCOL_*)
+ * @param desc_report Report descriptor, or NULL
+ * @param desc_len Report descriptor length
+ * @return true on success, false if no device slot is free
+ */
+bool host_usb_attach(uint8_t dev_addr, uint8_t instance, uint16_t vid, uint16_t pid,
+                     uint8_t itf_protocol, const uint8_t *desc_report, uint16_t desc_len);
+
+/**
+ * Detach a simulated HID device (calls tuh_hid_umount_cb)
+ * @param dev_addr Device address
+ * @param instance HID instance
+ */
+void host_usb_detach(uint8_t dev_addr, uint8_t instance);
+
+/**
+ * Queue an input report from a simulated device
+ * The report is delivered by the next tuh_task() call if the application
+ * has requested a report with tuh_hid_receive_report().
+ * @param dev_addr Device address
+ * @param instance HID instance
+ * @param report Report data
+ * @param len Report length
+ * @return true if queued, false if the device is unknown or report too long
+ */
+bool host_usb_queue_report(uint8_t dev_addr, uint8_t instance, const uint8_t *report, uint16_t len);
+
+/**
+ * Get the last output report the application sent to a simulated device
+ * (tuh_hid_send_report, report ID first when it has one)
+ * @param dev_addr Device address
+ * @param instance HID instance
+ * @param report Buffer for the report
+ * @param size Buffer size
+ * @return Report length, 0 if nothing was sent
+ */
+uint16_t host_usb_get_output(uint8_t dev_addr, uint8_t instance, uint8_t *report, uint16_t size);
+
+/**
+ * Get HID output statistics
+ * @return Pointer to statistics
+ */
+const host_hid_stats_t* host_hid_get_stats(void);
+
+/**
+ * Reset HID output statistics
+ */
+void host_hid_reset_stats(void);
+
+/**
+ * Deliver data from the PC to the CDC RX FIFO
+ * tud_cdc_rx_cb() is invoked by the next tud_task() call.
+ * @param data Received data
+ * @param len Number of bytes
+ * @return Number of bytes accepted (limited by the free RX FIFO space)
+ */
+uint32_t host_cdc_receive(const void *data, uint32_t len);
+
+/**
+ * Set where flushed CDC TX data goes
+ * @param out Output stream, or NULL to discard
+ */
+void host_cdc_set_output(FILE *out);
+
+#endif // HOST_SIM_H
@@ -0,0 +1,35 @@
+/**
+ * Host Test Checks
+ *
+ * Check macros shared by the host tests (the _test.c programs in host/).
+ * A failed check prints its location and expression and the run goes on,
+ * so one run reports every failure; host_test_result() turns the tally
+ * into the exit status CTest reads.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+static int host_test_checks = 0;
+static int host_test_failures = 0;
+
+#define CHECK(cond) do { \
+        host_test_checks++; \
+        if (!(cond)) { \
+            host_test_failures++; \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+/**
+ * Report the tally
+ * @return Exit status: 0 when every check passed
+ */
+static inline int host_test_result(void) {
+    printf("%d checks, %d failed\n", host_test_checks, host_test_failures);
+    return host_test_failures ? 1 : 0;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,19 @@
+/**
+ * Pico-PIO-USB Stand-in for the Host Build
+ */
+
+#ifndef PIO_USB_H
+#define PIO_USB_H
+
+#include <stdint.h>
+
+#define PIO_USB_DMA_TX_DEFAULT 0
+
+typedef struct {
+    uint8_t pin_dp;
+    uint8_t tx_ch;
+} pio_usb_configuration_t;
+
+#define PIO_USB_DEFAULT_CONFIG { PIO_USB_DP_PIN_DEFAULT, PIO_USB_DMA_TX_DEFAULT }
+
+#endif // PIO_USB_H
@@ -0,0 +1,103 @@
+/**
+ * TinyUSB Stand-in for the Host Build
+ *
+ * Declares the subset of the TinyUSB host/device API used by the firmware
+ * modules. The implementation in host/tusb_host.c simulates a single HID
+ * IN endpoint and the CDC FIFOs on the device side and lets the simulation
+ * attach devices and inject reports on the host side (see host_sim.h).
+ */
+
+#ifndef TUSB_H
+#define TUSB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Option values normally provided by tusb_option.h
+#define OPT_MCU_NONE          0
+#define OPT_OS_NONE           1
+#define OPT_OS_PICO           5
+#define OPT_MODE_FULL_SPEED   (1u << 1)
+
+#define CFG_TUSB_MCU          OPT_MCU_NONE
+#define CFG_TUSB_OS           OPT_OS_NONE
+
+#include "tusb_config.h"
+
+#define TU_ATTR_WEAK __attribute__((weak))
+
+//--------------------------------------------------------------------
+// HID common definitions
+//--------------------------------------------------------------------
+
+enum {
+    HID_ITF_PROTOCOL_NONE     = 0,
+    HID_ITF_PROTOCOL_KEYBOARD = 1,
+    HID_ITF_PROTOCOL_MOUSE    = 2
+};
+
+enum {
+    HID_PROTOCOL_BOOT   = 0,
+    HID_PROTOCOL_REPORT = 1
+};
+
+typedef enum {
+    HID_REPORT_TYPE_INVALID = 0,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE
+} hid_report_type_t;
+
+//--------------------------------------------------------------------
+// Host stack
+//--------------------------------------------------------------------
+
+#define TUH_CFGID_RPI_PIO_USB_CONFIGURATION 100
+
+bool tuh_configure(uint8_t rhport, uint32_t cfg_id, const void *cfg_param);
+bool tuh_init(uint8_t rhport);
+void tuh_task(void);
+bool tuh_task_event_ready(void);
+bool tuh_vid_pid_get(uint8_t dev_addr, uint16_t *vid, uint16_t *pid);
+
+uint8_t tuh_hid_interface_protocol(uint8_t dev_addr, uint8_t idx);
+bool tuh_hid_set_protocol(uint8_t dev_addr, uint8_t idx, uint8_t protocol);
+bool tuh_hid_receive_report(uint8_t dev_addr, uint8_t idx);
+bool tuh_hid_send_report(uint8_t dev_addr, uint8_t idx, uint8_t report_id, const void *report, uint16_t len);
+
+// Implemented by the application
+void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t idx, uint8_t const *desc_report, uint16_t desc_len);
+void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t idx);
+void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t idx, uint8_t const *report, uint16_t len);
+
+//--------------------------------------------------------------------
+// Device stack
+//--------------------------------------------------------------------
+
+bool tud_init(uint8_t rhport);
+void tud_task(void);
+bool tud_task_event_ready(void);
+bool tud_mounted(void);
+
+bool tud_hid_ready(void);
+bool tud_hid_report(uint8_t report_id, void const *report, uint16_t len);
+
+// Implemented by the application
+uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id,
+                               hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen);
+void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id,
+                           hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize);
+TU_ATTR_WEAK void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len);
+
+uint32_t tud_cdc_available(void);
+uint32_t tud_cdc_read(void *buffer, uint32_t bufsize);
+uint32_t tud_cdc_write(void const *buffer, uint32_t bufsize);
+uint32_t tud_cdc_write_available(void);
+uint32_t tud_cdc_write_flush(void);
+bool tud_cdc_connected(void);
+
+// Implemented by the application
+TU_ATTR_WEAK void tud_cdc_rx_cb(uint8_t itf);
+
+#endif // TUSB_H
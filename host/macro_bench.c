@@ -0,0 +1,156 @@
+/**
+ * Joystick Converter - Macro Interpreter Benchmark
+ *
+ * Runs a mix of bytecode macros (rapid fire while held, a mouse path,
+ * a key combo and nested loops) in every execution slot on the virtual
+ * clock and times macro_task(), so interpreter changes can be compared
+ * without a board.
+ *
+ * Usage: macro_bench [-n ms]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "hal.h"
+#include "host_sim.h"
+#include "config.h"
+#include "logging.h"
+#include "macro.h"
+#include "macro_store.h"
+#include "output.h"
+#include "usb_device.h"
+
+#define KEY_A     0x04
+#define KEY_SPACE 0x2C
+
+// Rapid fire: tap A every 2 ms while the trigger is held (it never is released)
+static const uint8_t macro_rapid[] = {
+    MACRO_OP_KEY_DOWN, KEY_A,
+    MACRO_OP_DELAY, 1,
+    MACRO_OP_KEY_UP, KEY_A,
+    MACRO_OP_DELAY, 1,
+    MACRO_OP_JUMP_IF_HELD, 0, 0,
+};
+
+// Mouse path: 100 moves of (3, -2), one per frame (zigzag 6 and 3)
+static const uint8_t macro_path[] = {
+    MACRO_OP_LOOP, 100,
+    MACRO_OP_MOUSE_MOVE, 6, 3,
+    MACRO_OP_DELAY, 1,
+    MACRO_OP_NEXT,
+};
+
+// Combo: two keys and a mouse button together, then everything up
+static const uint8_t macro_combo[] = {
+    MACRO_OP_LOOP, 255,
+    MACRO_OP_KEY_DOWN, KEY_A,
+    MACRO_OP_KEY_DOWN, KEY_SPACE,
+    MACRO_OP_BUTTON_DOWN, 0x01,
+    MACRO_OP_DELAY, 1,
+    MACRO_OP_KEY_UP, 0,
+    MACRO_OP_BUTTON_UP, 0,
+    MACRO_OP_DELAY, 1,
+    MACRO_OP_NEXT,
+};
+
+// Nested loops: four single-count moves per frame
+static const uint8_t macro_nested[] = {
+    MACRO_OP_LOOP, 50,
+    MACRO_OP_LOOP, 4,
+    MACRO_OP_MOUSE_MOVE, 2, 2,
+    MACRO_OP_NEXT,
+    MACRO_OP_DELAY, 1,
+    MACRO_OP_NEXT,
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-n ms]\n"
+            "  -n  Virtual milliseconds to run (default 100000)\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    uint32_t duration_ms = 100000;
+    int c;
+
+    while ((c = getopt(argc, argv, "n:h")) != -1) {
+        switch (c) {
+            case 'n':
+                duration_ms = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return c == 'h' ? 0 : 1;
+        }
+    }
+    if (duration_ms == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Module chatter goes to stdout; the results go to stderr
+    fflush(stdout);
+    if (!freopen("/dev/null", "w", stdout)) {
+        fprintf(stderr, "Warning: could not silence module output\n");
+    }
+
+    host_flash_open(NULL);
+    logging_init();
+    config_set_defaults();
+    config_get()->output_type = OUTPUT_TYPE_COMBO;
+    usb_device_init();
+    usb_device_set_output_type(OUTPUT_TYPE_COMBO);
+    output_init();
+    macro_init();
+
+    macro_add(0, macro_rapid, sizeof(macro_rapid));
+    macro_add(1, macro_path, sizeof(macro_path));
+    macro_add(2, macro_combo, sizeof(macro_combo));
+    macro_add(3, macro_nested, sizeof(macro_nested));
+
+    uint64_t cycles_total = 0;
+    uint32_t cycles_max = 0;
+    uint32_t restarts = 0;
+
+    for (uint32_t ms = 0; ms < duration_ms; ms++) {
+        // Keep every slot busy; a restart takes the lowest free slot, so
+        // slot n always runs macro n
+        for (uint8_t id = 0; id < MACRO_SLOTS; id++) {
+            if (!(macro_running_slots() & (1u << id))) {
+                macro_execute(id, id == 0 ? 0x0001 : MACRO_NO_TRIGGER);
+                restarts++;
+            }
+        }
+
+        uint32_t start = hal_cycle_count();
+        macro_task();
+        uint32_t cycles = hal_cycle_count() - start;
+        cycles_total += cycles;
+        if (cycles > cycles_max) {
+            cycles_max = cycles;
+        }
+
+        output_task();
+        usb_device_task();
+        host_clock_advance_us(1000);
+    }
+
+    macro_stats_t stats;
+    macro_get_stats(&stats);
+
+    fprintf(stderr, "Macro benchmark: %lu ms virtual, %d slots, cycle_hz=%lu\n",
+           (unsigned long)duration_ms, MACRO_SLOTS, (unsigned long)hal_cycle_hz());
+    fprintf(stderr, "  bytecode             %8u bytes in %u macros (store capacity %u)\n",
+           macro_store_used(), macro_store_count(), MACRO_STORE_CAPACITY);
+    fprintf(stderr, "  instructions         %8lu (%lu slot runs, %lu starts)\n",
+           (unsigned long)stats.ops, (unsigned long)stats.runs, (unsigned long)restarts);
+    if (stats.ops > 0 && stats.runs > 0) {
+        fprintf(stderr, "  per instruction      %8.1f cycles\n", (double)cycles_total / stats.ops);
+        fprintf(stderr, "  per slot run         %8.1f cycles\n", (double)cycles_total / stats.runs);
+    }
+    fprintf(stderr, "  macro_task max       %8lu cycles\n", (unsigned long)cycles_max);
+    return 0;
+}
@@ -0,0 +1,72 @@
+/**
+ * Joystick Converter - Macro Recorder Test
+ *
+ * Records output changes on the virtual clock and compares the stored
+ * bytecode byte for byte: a run of identical 1 ms mouse moves must become
+ * a single LOOP, a key held until the stop keeps its hold time, and an
+ * empty recording stores nothing.
+ *
+ * Usage: macro_record_test (exit status 0 when every check passes)
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "hal.h"
+#include "host_sim.h"
+#include "host_test.h"
+#include "logging.h"
+#include "macro.h"
+#include "macro_record.h"
+
+static bool stored(uint8_t macro_id, const uint8_t *code, uint16_t len) {
+    uint16_t stored_len = 0;
+    const uint8_t *stored_code = macro_get(macro_id, &stored_len);
+    return stored_code && stored_len == len && memcmp(stored_code, code, len) == 0;
+}
+
+int main(void) {
+    logging_init();
+    host_flash_open(NULL);
+    host_clock_set_us(1000000);
+    macro_init();
+
+    // A held stick: the same move every 1 ms
+    macro_record_start(6);
+    for (int i = 0; i < 200; i++) {
+        macro_record_mouse_move(3, -2);
+        host_clock_advance_us(1000);
+    }
+    macro_record_result_t result;
+    CHECK(macro_record_stop(&result));
+    CHECK(result.events == 200 && result.steps == 2 && result.duration_us == 199000 &&
+          !result.truncated);
+
+    // The first move, then one LOOP for the other 199 (zigzag 6, 3)
+    static const uint8_t moves[] = {
+        MACRO_OP_MOUSE_MOVE, 6, 3,
+        MACRO_OP_LOOP, 199,
+        MACRO_OP_DELAY_US, 0xE8, 0x07,
+        MACRO_OP_MOUSE_MOVE, 6, 3,
+        MACRO_OP_NEXT,
+    };
+    CHECK(stored(6, moves, sizeof(moves)));
+
+    // A key held down until the stop keeps its hold time (25000 us)
+    macro_record_start(7);
+    macro_record_key(4, true);
+    host_clock_advance_us(25000);
+    CHECK(macro_record_stop(&result));
+    static const uint8_t held[] = {
+        MACRO_OP_KEY_DOWN, 4,
+        MACRO_OP_DELAY_US, 0xA8, 0xC3, 0x01,
+    };
+    CHECK(stored(7, held, sizeof(held)));
+
+    // Nothing recorded stores nothing
+    macro_record_start(8);
+    CHECK(!macro_record_stop(&result));
+    CHECK(!macro_get(8, NULL));
+
+    return host_test_result();
+}
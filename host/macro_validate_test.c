@@ -0,0 +1,53 @@
+/**
+ * Joystick Converter - Macro Validator Test
+ *
+ * Checks that macro_validate() accepts well-formed bytecode and rejects
+ * what the interpreter could not run safely: unknown opcodes, operands cut
+ * off by the end of the code, unbalanced or over-deep loops and jumps that
+ * miss an instruction or cross a loop boundary.
+ *
+ * Usage: macro_validate_test (exit status 0 when every check passes)
+ */
+
+#include <stdint.h>
+
+#include "host_test.h"
+#include "macro.h"
+
+#define VALID(...) do { \
+        const uint8_t code[] = {__VA_ARGS__}; \
+        CHECK(macro_validate(code, sizeof(code))); \
+    } while (0)
+
+#define INVALID(...) do { \
+        const uint8_t code[] = {__VA_ARGS__}; \
+        CHECK(!macro_validate(code, sizeof(code))); \
+    } while (0)
+
+int main(void) {
+    VALID(MACRO_OP_KEY_DOWN, 4, MACRO_OP_DELAY, 0xFA, 0x01, MACRO_OP_KEY_UP, 4);
+    VALID(MACRO_OP_LOOP, 2, MACRO_OP_JUMP_IF_HELD, 2, 0, MACRO_OP_NEXT);
+    VALID(MACRO_OP_KEY_DOWN, 4, MACRO_OP_DELAY, 3, MACRO_OP_JUMP_IF_HELD, 0, 0);
+    CHECK(!macro_validate(NULL, 0));
+
+    // Unknown opcode and operands cut off by the end of the code
+    INVALID(MACRO_OP_COUNT);
+    INVALID(MACRO_OP_KEY_DOWN);
+    INVALID(MACRO_OP_DELAY, 0x80);
+    INVALID(MACRO_OP_JUMP_IF_HELD, 0);
+
+    // Unbalanced and over-deep loops
+    INVALID(MACRO_OP_LOOP, 2, MACRO_OP_KEY_DOWN, 4);
+    INVALID(MACRO_OP_KEY_DOWN, 4, MACRO_OP_NEXT);
+    INVALID(MACRO_OP_LOOP, 0, MACRO_OP_NEXT);
+    INVALID(MACRO_OP_LOOP, 2, MACRO_OP_LOOP, 2, MACRO_OP_LOOP, 2, MACRO_OP_LOOP, 2, MACRO_OP_LOOP, 2,
+            MACRO_OP_NEXT, MACRO_OP_NEXT, MACRO_OP_NEXT, MACRO_OP_NEXT, MACRO_OP_NEXT);
+
+    // Jumps past the end, into an operand, and across a loop boundary
+    INVALID(MACRO_OP_JUMP_IF_HELD, 3, 0);
+    INVALID(MACRO_OP_KEY_DOWN, 4, MACRO_OP_JUMP_IF_HELD, 1, 0);
+    INVALID(MACRO_OP_LOOP, 2, MACRO_OP_JUMP_IF_HELD, 6, 0, MACRO_OP_NEXT, MACRO_OP_END);
+    INVALID(MACRO_OP_JUMP_IF_HELD, 5, 0, MACRO_OP_LOOP, 2, MACRO_OP_KEY_DOWN, 4, MACRO_OP_NEXT);
+
+    return host_test_result();
+}
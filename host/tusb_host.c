@@ -0,0 +1,369 @@
+/**
+ * TinyUSB Stand-in Implementation for the Host Build
+ *
+ * Host side: simulated HID devices with a small report queue each. A report
+ * is delivered from tuh_task() only after the application has re-armed the
+ * endpoint with tuh_hid_receive_report(), like the real stack.
+ *
+ * Device side: a single HID IN endpoint that accepts one report per USB
+ * frame (bInterval = 1 ms on the virtual clock). The transfer completes in
+ * the first tud_task() call of a later frame, which then invokes
+ * tud_hid_report_complete_cb().
+ *
+ * CDC: data injected with host_cdc_receive() lands in the RX FIFO and
+ * tud_task() reports it through tud_cdc_rx_cb(); TX data is delivered to
+ * the output stream on every flush.
+ */
+
+#include "tusb.h"
+#include "hal.h"
+#include "host_sim.h"
+#include <string.h>
+
+#define HOST_REPORT_QUEUE_LEN 8
+#define HOST_REPORT_MAX_LEN   CFG_TUH_HID_EPIN_BUFSIZE
+
+typedef struct {
+    bool in_use;
+    uint8_t dev_addr;
+    uint8_t instance;
+    uint16_t vid;
+    uint16_t pid;
+    uint8_t itf_protocol;
+    bool armed;
+    uint8_t queue[HOST_REPORT_QUEUE_LEN][HOST_REPORT_MAX_LEN];
+    uint16_t queue_len[HOST_REPORT_QUEUE_LEN];
+    uint8_t queue_head;
+    uint8_t queue_count;
+    uint8_t output[HOST_REPORT_MAX_LEN];  // Last output report sent to the device
+    uint16_t output_len;
+} host_hid_device_t;
+
+static host_hid_device_t host_devices[CFG_TUH_HID];
+
+// Device-side IN endpoint state
+static bool device_initialized = false;
+static bool in_busy = false;
+static uint64_t in_busy_frame = 0;
+static uint8_t in_buffer[CFG_TUD_HID_EP_BUFSIZE];
+static uint16_t in_len = 0;
+static host_hid_stats_t hid_stats;
+
+// CDC FIFOs; TX data is delivered to cdc_output on flush
+static uint8_t cdc_rx[CFG_TUD_CDC_RX_BUFSIZE];
+static uint32_t cdc_rx_head = 0;
+static uint32_t cdc_rx_count = 0;
+static bool cdc_rx_pending = false;
+static uint8_t cdc_tx[CFG_TUD_CDC_TX_BUFSIZE];
+static uint32_t cdc_tx_count = 0;
+static FILE *cdc_output = NULL;
+
+static host_hid_device_t* find_device(uint8_t dev_addr, uint8_t instance) {
+    for (int i = 0; i < CFG_TUH_HID; i++) {
+        if (host_devices[i].in_use && host_devices[i].dev_addr == dev_addr &&
+            host_devices[i].instance == instance) {
+            return &host_devices[i];
+        }
+    }
+    return NULL;
+}
+
+static host_hid_device_t* find_device_by_addr(uint8_t dev_addr) {
+    for (int i = 0; i < CFG_TUH_HID; i++) {
+        if (host_devices[i].in_use && host_devices[i].dev_addr == dev_addr) {
+            return &host_devices[i];
+        }
+    }
+    return NULL;
+}
+
+static uint64_t current_frame(void) {
+    return hal_time_us() / 1000;
+}
+
+//--------------------------------------------------------------------
+// Simulation controls
+//--------------------------------------------------------------------
+
+bool host_usb_attach(uint8_t dev_addr, uint8_t instance, uint16_t vid, uint16_t pid,
+                     uint8_t itf_protocol, const uint8_t *desc_report, uint16_t desc_len) {
+    if (find_device(dev_addr, instance)) {
+        return false;
+    }
+
+    for (int i = 0; i < CFG_TUH_HID; i++) {
+        host_hid_device_t *dev = &host_devices[i];
+        if (!dev->in_use) {
+            memset(dev, 0, sizeof(*dev));
+            dev->in_use = true;
+            dev->dev_addr = dev_addr;
+            dev->instance = instance;
+            dev->vid = vid;
+            dev->pid = pid;
+            dev->itf_protocol = itf_protocol;
+            tuh_hid_mount_cb(dev_addr, instance, desc_report, desc_len);
+            return true;
+        }
+    }
+    return false;
+}
+
+void host_usb_detach(uint8_t dev_addr, uint8_t instance) {
+    host_hid_device_t *dev = find_device(dev_addr, instance);
+    if (dev) {
+        dev->in_use = false;
+        tuh_hid_umount_cb(dev_addr, instance);
+    }
+}
+
+bool host_usb_queue_report(uint8_t dev_addr, uint8_t instance, const uint8_t *report, uint16_t len) {
+    host_hid_device_t *dev = find_device(dev_addr, instance);
+    if (!dev || len > HOST_REPORT_MAX_LEN) {
+        return false;
+    }
+
+    if (dev->queue_count == HOST_REPORT_QUEUE_LEN) {
+        // Device would NAK; drop the oldest report like a full device FIFO
+        dev->queue_head = (dev->queue_head + 1) % HOST_REPORT_QUEUE_LEN;
+        dev->queue_count--;
+    }
+
+    uint8_t slot = (dev->queue_head + dev->queue_count) % HOST_REPORT_QUEUE_LEN;
+    memcpy(dev->queue[slot], report, len);
+    dev->queue_len[slot] = len;
+    dev->queue_count++;
+    return true;
+}
+
+const host_hid_stats_t* host_hid_get_stats(void) {
+    return &hid_stats;
+}
+
+void host_hid_reset_stats(void) {
+    memset(&hid_stats, 0, sizeof(hid_stats));
+}
+
+//--------------------------------------------------------------------
+// Host stack
+//--------------------------------------------------------------------
+
+bool tuh_configure(uint8_t rhport, uint32_t cfg_id, const void *cfg_param) {
+    (void)rhport;
+    (void)cfg_id;
+    (void)cfg_param;
+    return true;
+}
+
+bool tuh_init(uint8_t rhport) {
+    (void)rhport;
+    memset(host_devices, 0, sizeof(host_devices));
+    return true;
+}
+
+void tuh_task(void) {
+    // Deliver at most one queued report per armed endpoint
+    for (int i = 0; i < CFG_TUH_HID; i++) {
+        host_hid_device_t *dev = &host_devices[i];
+        if (!dev->in_use || !dev->armed || dev->queue_count == 0) {
+            continue;
+        }
+
+        uint8_t report[HOST_REPORT_MAX_LEN];
+        uint16_t len = dev->queue_len[dev->queue_head];
+        memcpy(report, dev->queue[dev->queue_head], len);
+        dev->queue_head = (dev->queue_head + 1) % HOST_REPORT_QUEUE_LEN;
+        dev->queue_count--;
+        dev->armed = false;
+
+        tuh_hid_report_received_cb(dev->dev_addr, dev->instance, report, len);
+    }
+}
+
+bool tuh_task_event_ready(void) {
+    for (int i = 0; i < CFG_TUH_HID; i++) {
+        const host_hid_device_t *dev = &host_devices[i];
+        if (dev->in_use && dev->armed && dev->queue_count > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool tuh_vid_pid_get(uint8_t dev_addr, uint16_t *vid, uint16_t *pid) {
+    host_hid_device_t *dev = find_device_by_addr(dev_addr);
+    if (!dev) {
+        return false;
+    }
+    *vid = dev->vid;
+    *pid = dev->pid;
+    return true;
+}
+
+uint8_t tuh_hid_interface_protocol(uint8_t dev_addr, uint8_t idx) {
+    host_hid_device_t *dev = find_device(dev_addr, idx);
+    return dev ? dev->itf_protocol : HID_ITF_PROTOCOL_NONE;
+}
+
+bool tuh_hid_set_protocol(uint8_t dev_addr, uint8_t idx, uint8_t protocol) {
+    (void)protocol;
+    return find_device(dev_addr, idx) != NULL;
+}
+
+bool tuh_hid_receive_report(uint8_t dev_addr, uint8_t idx) {
+    host_hid_device_t *dev = find_device(dev_addr, idx);
+    if (!dev || dev->armed) {
+        return false;
+    }
+    dev->armed = true;
+    return true;
+}
+
+bool tuh_hid_send_report(uint8_t dev_addr, uint8_t idx, uint8_t report_id, const void *report, uint16_t len) {
+    host_hid_device_t *dev = find_device(dev_addr, idx);
+    uint16_t id_len = report_id ? 1 : 0;
+    if (!dev || len + id_len > sizeof(dev->output)) {
+        return false;
+    }
+    dev->output[0] = report_id;
+    memcpy(&dev->output[id_len], report, len);
+    dev->output_len = (uint16_t)(len + id_len);
+    return true;
+}
+
+uint16_t host_usb_get_output(uint8_t dev_addr, uint8_t instance, uint8_t *report, uint16_t size) {
+    host_hid_device_t *dev = find_device(dev_addr, instance);
+    if (!dev) {
+        return 0;
+    }
+    uint16_t len = dev->output_len < size ? dev->output_len : size;
+    memcpy(report, dev->output, len);
+    return len;
+}
+
+//--------------------------------------------------------------------
+// Device stack
+//--------------------------------------------------------------------
+
+bool tud_init(uint8_t rhport) {
+    (void)rhport;
+    device_initialized = true;
+    in_busy = false;
+    return true;
+}
+
+void tud_task(void) {
+    if (in_busy && current_frame() > in_busy_frame) {
+        in_busy = false;
+        if (tud_hid_report_complete_cb) {
+            tud_hid_report_complete_cb(0, in_buffer, in_len);
+        }
+    }
+    if (cdc_rx_pending) {
+        cdc_rx_pending = false;
+        if (tud_cdc_rx_cb) {
+            tud_cdc_rx_cb(0);
+        }
+    }
+}
+
+bool tud_task_event_ready(void) {
+    return (in_busy && current_frame() > in_busy_frame) || cdc_rx_pending;
+}
+
+bool tud_mounted(void) {
+    return device_initialized;
+}
+
+bool tud_hid_ready(void) {
+    return device_initialized && !in_busy;
+}
+
+bool tud_hid_report(uint8_t report_id, void const *report, uint16_t len) {
+    if (!tud_hid_ready()) {
+        hid_stats.reports_busy++;
+        return false;
+    }
+    if ((uint32_t)len + 1 > sizeof(in_buffer)) {
+        return false;
+    }
+
+    // Report ID is prepended on the wire, as in TinyUSB
+    in_buffer[0] = report_id;
+    memcpy(&in_buffer[1], report, len);
+    in_len = len + 1;
+    in_busy = true;
+    in_busy_frame = current_frame();
+
+    hid_stats.reports_sent++;
+    if (report_id < HOST_HID_MAX_REPORT_ID) {
+        hid_stats.reports_by_id[report_id]++;
+        memcpy(hid_stats.last_report[report_id], report, len);
+        hid_stats.last_len[report_id] = len;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------
+// CDC serial port
+//--------------------------------------------------------------------
+
+uint32_t host_cdc_receive(const void *data, uint32_t len) {
+    uint32_t space = sizeof(cdc_rx) - cdc_rx_count;
+    if (len > space) {
+        len = space;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        cdc_rx[(cdc_rx_head + cdc_rx_count + i) % sizeof(cdc_rx)] = ((const uint8_t *)data)[i];
+    }
+    cdc_rx_count += len;
+    if (len > 0) {
+        cdc_rx_pending = true;
+    }
+    return len;
+}
+
+void host_cdc_set_output(FILE *out) {
+    cdc_output = out;
+}
+
+uint32_t tud_cdc_available(void) {
+    return cdc_rx_count;
+}
+
+uint32_t tud_cdc_read(void *buffer, uint32_t bufsize) {
+    uint32_t len = bufsize < cdc_rx_count ? bufsize : cdc_rx_count;
+    for (uint32_t i = 0; i < len; i++) {
+        ((uint8_t *)buffer)[i] = cdc_rx[cdc_rx_head];
+        cdc_rx_head = (cdc_rx_head + 1) % sizeof(cdc_rx);
+    }
+    cdc_rx_count -= len;
+    return len;
+}
+
+uint32_t tud_cdc_write(void const *buffer, uint32_t bufsize) {
+    uint32_t len = tud_cdc_write_available();
+    if (bufsize < len) {
+        len = bufsize;
+    }
+    memcpy(&cdc_tx[cdc_tx_count], buffer, len);
+    cdc_tx_count += len;
+    return len;
+}
+
+uint32_t tud_cdc_write_available(void) {
+    return sizeof(cdc_tx) - cdc_tx_count;
+}
+
+bool tud_cdc_connected(void) {
+    return true;
+}
+
+uint32_t tud_cdc_write_flush(void) {
+    // The simulated host reads everything at once
+    uint32_t len = cdc_tx_count;
+    if (cdc_output && len > 0) {
+        fwrite(cdc_tx, 1, len, cdc_output);
+    }
+    cdc_tx_count = 0;
+    return len;
+}